@@ -0,0 +1,66 @@
+#!/bin/sh
+# Run the client swarm against fensterchef on a virtual X server for each given
+# number of windows.
+#
+# Usage: run.sh DISPLAY_NUMBER FENSTERCHEF SWARM WINDOWS...
+#
+# Each run starts a fresh X server and fensterchef and prints one line of JSON
+# to standard output:
+# {"fensterchef":VERSION,"windows":N,"cpu_seconds":S,"max_rss_kb":K,
+#  "phases":{...}}
+# where the phases are what the swarm prints.
+
+set -e
+
+if [ $# -lt 4 ] ; then
+    echo "Usage: $0 DISPLAY_NUMBER FENSTERCHEF SWARM WINDOWS..." >&2
+    exit 1
+fi
+
+display=":$1"
+fensterchef="$2"
+swarm="$3"
+shift 3
+
+# use an empty home so the default configuration is used
+home="$(mktemp -d)"
+trap 'rm -rf "$home"' EXIT
+
+version="$("$fensterchef" --version 2>&1 | cut -d ' ' -f 2)"
+ticks_per_second="$(getconf CLK_TCK)"
+
+for windows in "$@" ; do
+    Xvfb "$display" -screen 0 1920x1080x24 +extension RANDR -nolisten tcp \
+        >/dev/null 2>&1 &
+    xvfb=$!
+
+    # wait for the X server to accept connections
+    tries=0
+    while [ ! -S "/tmp/.X11-unix/X${display#:}" ] && [ $tries -lt 50 ] ; do
+        sleep 0.1
+        tries=$((tries + 1))
+    done
+
+    # the swarm waits for fensterchef to come up
+    HOME="$home" DISPLAY="$display" "$fensterchef" -d error \
+        2>"$home/fensterchef.log" &
+    wm=$!
+
+    if phases="$(DISPLAY="$display" "$swarm" "$windows")" ; then
+        # read the usage before fensterchef exits
+        cpu_seconds="$(awk -v tps="$ticks_per_second" \
+            '{ printf "%.2f", ($14 + $15) / tps }' "/proc/$wm/stat")"
+        max_rss="$(awk '/^VmHWM:/ { print $2 }' "/proc/$wm/status")"
+        printf '{"fensterchef":"%s","windows":%s,"cpu_seconds":%s,"max_rss_kb":%s,"phases":%s}\n' \
+            "$version" "$windows" "$cpu_seconds" "$max_rss" "$phases"
+    else
+        echo "swarm with $windows windows failed, fensterchef logged:" >&2
+        cat "$home/fensterchef.log" >&2
+        status=1
+    fi
+
+    kill $wm $xvfb 2>/dev/null || true
+    wait $wm $xvfb 2>/dev/null || true
+done
+
+exit ${status:-0}
@@ -0,0 +1,545 @@
+#include <inttypes.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <xcb/xcb.h>
+
+/* This is a synthetic X client that drives a running window manager with many
+ * windows and prints how quickly the window manager keeps up as JSON to
+ * standard output.
+ *
+ * The window manager handles requests in order, so after each phase a fresh
+ * window is mapped as barrier: once it is mapped, all requests of the phase
+ * are handled.
+ *
+ * A window counts as adopted once it appears in `_NET_CLIENT_LIST`. Being
+ * mapped is no indicator because a tiling window manager only shows the windows
+ * that fit into its frames.
+ */
+
+/* the time in milliseconds a phase may take before it counts as timed out */
+#define PHASE_TIMEOUT 30000
+
+/* the time in milliseconds to wait for the X server and window manager */
+#define STARTUP_TIMEOUT 5000
+
+/* the number of times each window changes its names */
+#define PROPERTY_ROUNDS 10
+
+/* the connection to the X server */
+static xcb_connection_t *connection;
+
+/* the screen the windows are created on */
+static xcb_screen_t *screen;
+
+/* the atoms the swarm uses */
+typedef enum {
+    ATOM_UTF8_STRING,
+    ATOM_NET_WM_NAME,
+    ATOM_NET_WM_STATE,
+    ATOM_NET_WM_STATE_FULLSCREEN,
+    ATOM_NET_MOVERESIZE_WINDOW,
+    ATOM_NET_SUPPORTING_WM_CHECK,
+    ATOM_NET_CLIENT_LIST,
+
+    /* not a real atom */
+    ATOM_MAX,
+} atom_t;
+
+/* the names of the atoms */
+static const char *atom_names[ATOM_MAX] = {
+    [ATOM_UTF8_STRING] = "UTF8_STRING",
+    [ATOM_NET_WM_NAME] = "_NET_WM_NAME",
+    [ATOM_NET_WM_STATE] = "_NET_WM_STATE",
+    [ATOM_NET_WM_STATE_FULLSCREEN] = "_NET_WM_STATE_FULLSCREEN",
+    [ATOM_NET_MOVERESIZE_WINDOW] = "_NET_MOVERESIZE_WINDOW",
+    [ATOM_NET_SUPPORTING_WM_CHECK] = "_NET_SUPPORTING_WM_CHECK",
+    [ATOM_NET_CLIENT_LIST] = "_NET_CLIENT_LIST",
+};
+
+/* the interned atoms */
+static xcb_atom_t atoms[ATOM_MAX];
+
+/* a window of the swarm */
+typedef struct swarm_window {
+    /* the X window */
+    xcb_window_t id;
+    /* when the window was requested to be mapped */
+    uint64_t map_time;
+    /* when the window first appeared in the client list */
+    uint64_t adopted_time;
+    /* if a map notification was received */
+    bool is_mapped;
+} SwarmWindow;
+
+/* all windows of the swarm */
+static SwarmWindow *windows;
+
+/* the windows of the swarm sorted by their id */
+static SwarmWindow **sorted_windows;
+
+/* the number of windows */
+static uint32_t number_of_windows;
+
+/* the number of windows that appeared in the client list */
+static uint32_t number_of_adopted;
+
+/* the window used to wait for the window manager */
+static SwarmWindow barrier;
+
+/* Get the current time of the monotonic clock in nanoseconds. */
+static uint64_t get_time(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Get the swarm window of @id.
+ *
+ * @return NULL if the window is not part of the swarm.
+ */
+static SwarmWindow *get_swarm_window(xcb_window_t id)
+{
+    uint32_t low, high, middle;
+
+    if (id == barrier.id) {
+        return &barrier;
+    }
+
+    /* binary search, the client list is read many times */
+    low = 0;
+    high = number_of_windows;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (sorted_windows[middle]->id < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == number_of_windows || sorted_windows[low]->id != id) {
+        return NULL;
+    }
+    return sorted_windows[low];
+}
+
+/* Compare two windows by their id for sorting. */
+static int compare_windows(const void *a, const void *b)
+{
+    const xcb_window_t id_a = (*(SwarmWindow* const*) a)->id;
+    const xcb_window_t id_b = (*(SwarmWindow* const*) b)->id;
+
+    return id_a < id_b ? -1 : id_a > id_b;
+}
+
+/* Read the client list of the window manager and take all windows in it as
+ * adopted.
+ */
+static void read_client_list(void)
+{
+    xcb_get_property_cookie_t cookie;
+    xcb_get_property_reply_t *reply;
+    xcb_window_t *ids;
+    int length;
+    SwarmWindow *window;
+    uint64_t now;
+
+    /* the barrier might also be in the list */
+    cookie = xcb_get_property(connection, false, screen->root,
+            atoms[ATOM_NET_CLIENT_LIST], XCB_ATOM_WINDOW, 0,
+            number_of_windows + 1);
+    reply = xcb_get_property_reply(connection, cookie, NULL);
+    if (reply == NULL) {
+        return;
+    }
+
+    now = get_time();
+    ids = xcb_get_property_value(reply);
+    length = xcb_get_property_value_length(reply) / sizeof(*ids);
+    for (int i = 0; i < length; i++) {
+        window = get_swarm_window(ids[i]);
+        if (window != NULL && window != &barrier &&
+                window->adopted_time == 0) {
+            window->adopted_time = now;
+            number_of_adopted++;
+        }
+    }
+    free(reply);
+}
+
+/* Handle all events that arrive within @timeout milliseconds. */
+static void handle_events(int timeout)
+{
+    struct pollfd poll_file_descriptor;
+    xcb_generic_event_t *event;
+
+    event = xcb_poll_for_event(connection);
+    if (event == NULL) {
+        poll_file_descriptor.fd = xcb_get_file_descriptor(connection);
+        poll_file_descriptor.events = POLLIN;
+        if (poll(&poll_file_descriptor, 1, timeout) <= 0) {
+            return;
+        }
+        event = xcb_poll_for_event(connection);
+    }
+
+    for (; event != NULL; event = xcb_poll_for_event(connection)) {
+        switch (event->response_type & ~0x80) {
+        case XCB_MAP_NOTIFY: {
+            SwarmWindow *const window = get_swarm_window(
+                    ((xcb_map_notify_event_t*) event)->window);
+            if (window != NULL) {
+                window->is_mapped = true;
+            }
+            break;
+        }
+
+        /* the window manager changed the client list */
+        case XCB_PROPERTY_NOTIFY: {
+            xcb_property_notify_event_t *const property_notify =
+                (xcb_property_notify_event_t*) event;
+            if (property_notify->window == screen->root &&
+                    property_notify->atom == atoms[ATOM_NET_CLIENT_LIST]) {
+                read_client_list();
+            }
+            break;
+        }
+        }
+        free(event);
+    }
+}
+
+/* Create a window of size 1x1 that reports its structure changes. */
+static xcb_window_t create_swarm_window(void)
+{
+    xcb_window_t window;
+    uint32_t values[1];
+
+    window = xcb_generate_id(connection);
+    values[0] = XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+    xcb_create_window(connection, XCB_COPY_FROM_PARENT, window, screen->root,
+            0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+            XCB_COPY_FROM_PARENT, XCB_CW_EVENT_MASK, values);
+    return window;
+}
+
+/* Wait until the window manager handled all requests sent so far.
+ *
+ * @return false if the window manager did not respond in time.
+ */
+static bool wait_for_window_manager(void)
+{
+    uint64_t deadline;
+
+    barrier.id = create_swarm_window();
+    barrier.is_mapped = false;
+    xcb_map_window(connection, barrier.id);
+    xcb_flush(connection);
+
+    deadline = get_time() + (uint64_t) PHASE_TIMEOUT * 1000000;
+    while (!barrier.is_mapped && get_time() < deadline) {
+        handle_events(100);
+    }
+
+    xcb_destroy_window(connection, barrier.id);
+    xcb_flush(connection);
+    return barrier.is_mapped;
+}
+
+/* Send a client message to the root window like pagers do. */
+static void send_root_message(xcb_window_t window, xcb_atom_t type,
+        const uint32_t data[5])
+{
+    xcb_client_message_event_t event;
+
+    memset(&event, 0, sizeof(event));
+    event.response_type = XCB_CLIENT_MESSAGE;
+    event.format = 32;
+    event.window = window;
+    event.type = type;
+    memcpy(event.data.data32, data, sizeof(event.data.data32));
+    xcb_send_event(connection, false, screen->root,
+            XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT |
+                XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY,
+            (const char*) &event);
+}
+
+/* Compare two durations for sorting. */
+static int compare_durations(const void *a, const void *b)
+{
+    const uint64_t duration_a = *(const uint64_t*) a;
+    const uint64_t duration_b = *(const uint64_t*) b;
+
+    return duration_a < duration_b ? -1 : duration_a > duration_b;
+}
+
+/* Wait for the window manager to handle the phase that began at @start and
+ * print its measurements as JSON member.
+ */
+static void finish_phase(const char *name, uint64_t start, uint64_t events)
+{
+    bool has_timed_out;
+    double seconds;
+
+    has_timed_out = !wait_for_window_manager();
+    seconds = (get_time() - start) / 1e9;
+
+    printf("\"%s\":{\"events\":%" PRIu64 ",\"seconds\":%.6f,"
+                "\"events_per_second\":%.1f,\"timed_out\":%s}",
+            name, events, seconds, events / seconds,
+            has_timed_out ? "true" : "false");
+}
+
+/* Map all windows and measure how long it takes until they are adopted. */
+static void run_map_phase(void)
+{
+    uint64_t start, deadline, end;
+    uint64_t *latencies;
+    uint32_t count = 0;
+    bool has_timed_out;
+
+    start = get_time();
+    for (uint32_t i = 0; i < number_of_windows; i++) {
+        windows[i].map_time = get_time();
+        xcb_map_window(connection, windows[i].id);
+    }
+    xcb_flush(connection);
+
+    deadline = start + (uint64_t) PHASE_TIMEOUT * 1000000;
+    while (number_of_adopted < number_of_windows &&
+            get_time() < deadline) {
+        handle_events(100);
+    }
+    end = get_time();
+    has_timed_out = number_of_adopted < number_of_windows;
+
+    latencies = malloc(sizeof(*latencies) * number_of_windows);
+    for (uint32_t i = 0; i < number_of_windows; i++) {
+        if (windows[i].adopted_time != 0) {
+            latencies[count++] =
+                windows[i].adopted_time - windows[i].map_time;
+        }
+    }
+    qsort(latencies, count, sizeof(*latencies), compare_durations);
+
+    printf("\"map\":{\"events\":%" PRIu32 ",\"seconds\":%.6f,"
+                "\"events_per_second\":%.1f,\"adopted\":%" PRIu32 ","
+                "\"latency_us\":{\"p50\":%" PRIu64 ",\"p99\":%" PRIu64 ","
+                "\"max\":%" PRIu64 "},\"timed_out\":%s}",
+            number_of_windows, (end - start) / 1e9,
+            number_of_adopted / ((end - start) / 1e9), count,
+            count == 0 ? 0 : latencies[count / 2] / 1000,
+            count == 0 ? 0 : latencies[count * 99 / 100] / 1000,
+            count == 0 ? 0 : latencies[count - 1] / 1000,
+            has_timed_out ? "true" : "false");
+    free(latencies);
+}
+
+/* Change the names of all windows many times. */
+static void run_property_phase(void)
+{
+    uint64_t start;
+    char name[64];
+    int length;
+
+    start = get_time();
+    for (uint32_t round = 0; round < PROPERTY_ROUNDS; round++) {
+        for (uint32_t i = 0; i < number_of_windows; i++) {
+            length = snprintf(name, sizeof(name), "swarm %" PRIu32 " round %"
+                    PRIu32, i, round);
+            xcb_change_property(connection, XCB_PROP_MODE_REPLACE,
+                    windows[i].id, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8,
+                    length, name);
+            xcb_change_property(connection, XCB_PROP_MODE_REPLACE,
+                    windows[i].id, atoms[ATOM_NET_WM_NAME],
+                    atoms[ATOM_UTF8_STRING], 8, length, name);
+        }
+    }
+    finish_phase("properties", start,
+            (uint64_t) PROPERTY_ROUNDS * number_of_windows * 2);
+}
+
+/* Put each window into fullscreen and out of it again. */
+static void run_state_phase(void)
+{
+    uint64_t start;
+    uint32_t data[5];
+
+    start = get_time();
+    for (uint32_t i = 0; i < number_of_windows; i++) {
+        for (uint32_t action = 1; action <= 2; action++) {
+            /* 1 adds the state and 0 removes it */
+            data[0] = action % 2;
+            data[1] = atoms[ATOM_NET_WM_STATE_FULLSCREEN];
+            data[2] = XCB_NONE;
+            /* the source is a pager */
+            data[3] = 2;
+            data[4] = 0;
+            send_root_message(windows[i].id, atoms[ATOM_NET_WM_STATE],
+                    data);
+        }
+    }
+    finish_phase("state", start, (uint64_t) number_of_windows * 2);
+}
+
+/* Move and resize each window through the window manager. */
+static void run_move_resize_phase(void)
+{
+    uint64_t start;
+    uint32_t data[5];
+
+    start = get_time();
+    for (uint32_t i = 0; i < number_of_windows; i++) {
+        /* static gravity, x, y, width and height are set and the source is a
+         * pager
+         */
+        data[0] = XCB_GRAVITY_STATIC | (0xf << 8) | (2 << 12);
+        data[1] = i % 200;
+        data[2] = i % 100;
+        data[3] = 200 + i % 300;
+        data[4] = 100 + i % 200;
+        send_root_message(windows[i].id,
+                atoms[ATOM_NET_MOVERESIZE_WINDOW], data);
+    }
+    finish_phase("move_resize", start, number_of_windows);
+}
+
+/* Unmap all windows. */
+static void run_unmap_phase(void)
+{
+    uint64_t start;
+
+    start = get_time();
+    for (uint32_t i = 0; i < number_of_windows; i++) {
+        xcb_unmap_window(connection, windows[i].id);
+    }
+    finish_phase("unmap", start, number_of_windows);
+}
+
+/* Destroy all windows. */
+static void run_destroy_phase(void)
+{
+    uint64_t start;
+
+    start = get_time();
+    for (uint32_t i = 0; i < number_of_windows; i++) {
+        xcb_destroy_window(connection, windows[i].id);
+    }
+    finish_phase("destroy", start, number_of_windows);
+}
+
+/* Connect to the X server and wait until a window manager is running.
+ *
+ * @return false if either does not come up in time.
+ */
+static bool connect_to_window_manager(void)
+{
+    xcb_intern_atom_cookie_t cookies[ATOM_MAX];
+    xcb_intern_atom_reply_t *atom;
+    xcb_get_property_cookie_t property_cookie;
+    xcb_get_property_reply_t *property;
+    bool is_running = false;
+    const uint64_t deadline = get_time() +
+        (uint64_t) STARTUP_TIMEOUT * 1000000;
+    const struct timespec pause = { 0, 10000000 };
+
+    /* the X server might still be starting */
+    while (connection = xcb_connect(NULL, NULL),
+            xcb_connection_has_error(connection) > 0) {
+        xcb_disconnect(connection);
+        if (get_time() >= deadline) {
+            fprintf(stderr, "could not connect to the X server\n");
+            return false;
+        }
+        nanosleep(&pause, NULL);
+    }
+    screen = xcb_setup_roots_iterator(xcb_get_setup(connection)).data;
+
+    for (atom_t i = 0; i < ATOM_MAX; i++) {
+        cookies[i] = xcb_intern_atom(connection, false,
+                strlen(atom_names[i]), atom_names[i]);
+    }
+    for (atom_t i = 0; i < ATOM_MAX; i++) {
+        atom = xcb_intern_atom_reply(connection, cookies[i], NULL);
+        if (atom == NULL) {
+            fprintf(stderr, "could not intern %s\n", atom_names[i]);
+            return false;
+        }
+        atoms[i] = atom->atom;
+        free(atom);
+    }
+
+    /* the window manager sets the check window once it is ready */
+    while (!is_running && get_time() < deadline) {
+        property_cookie = xcb_get_property(connection, false, screen->root,
+                atoms[ATOM_NET_SUPPORTING_WM_CHECK], XCB_ATOM_WINDOW,
+                0, 1);
+        property = xcb_get_property_reply(connection, property_cookie, NULL);
+        is_running = property != NULL &&
+            xcb_get_property_value_length(property) > 0;
+        free(property);
+        if (!is_running) {
+            nanosleep(&pause, NULL);
+        }
+    }
+    if (!is_running) {
+        fprintf(stderr, "no window manager is running\n");
+    }
+    return is_running;
+}
+
+/* Run all phases with the number of windows given as argument. */
+int main(int argc, char **argv)
+{
+    uint32_t values[1];
+
+    if (argc != 2 || atoi(argv[1]) <= 0) {
+        fprintf(stderr, "Usage: %s WINDOWS\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    number_of_windows = atoi(argv[1]);
+
+    if (!connect_to_window_manager()) {
+        return EXIT_FAILURE;
+    }
+
+    /* get notified when the client list changes */
+    values[0] = XCB_EVENT_MASK_PROPERTY_CHANGE;
+    xcb_change_window_attributes(connection, screen->root, XCB_CW_EVENT_MASK,
+            values);
+
+    windows = calloc(number_of_windows, sizeof(*windows));
+    sorted_windows = malloc(sizeof(*sorted_windows) * number_of_windows);
+    for (uint32_t i = 0; i < number_of_windows; i++) {
+        windows[i].id = create_swarm_window();
+        sorted_windows[i] = &windows[i];
+    }
+    qsort(sorted_windows, number_of_windows, sizeof(*sorted_windows),
+            compare_windows);
+    xcb_flush(connection);
+
+    printf("{");
+    run_map_phase();
+    printf(",");
+    run_property_phase();
+    printf(",");
+    run_state_phase();
+    printf(",");
+    run_move_resize_phase();
+    printf(",");
+    run_unmap_phase();
+    printf(",");
+    run_destroy_phase();
+    printf("}\n");
+
+    free(sorted_windows);
+    free(windows);
+    xcb_disconnect(connection);
+    return EXIT_SUCCESS;
+}
@@ -80,6 +80,12 @@ typedef enum {
     ACTION_RESIZE_BY,
     /* quit fensterchef */
     ACTION_QUIT,
+    /* write the flight recorder to its dump file */
+    ACTION_DUMP_FLIGHT_RECORDER,
+    /* show the latency statistics */
+    ACTION_SHOW_STATS,
+    /* clear the latency statistics */
+    ACTION_RESET_STATS,
 
     /* not a real action */
     ACTION_MAX,
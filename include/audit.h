@@ -0,0 +1,103 @@
+#ifndef AUDIT_H
+#define AUDIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <xcb/xcb.h>
+
+#include "statistics.h"
+
+/* the time in milliseconds between two reports of the round trips */
+#define AUDIT_REPORT_INTERVAL 10000
+
+/* the number of call sites a report lists at most */
+#define AUDIT_REPORT_SITES 8
+
+/* if the time spent waiting for replies is measured, this is set by the
+ * `--audit-round-trips` program option
+ */
+extern bool is_auditing;
+
+/* when the reply wait that is measured right now started */
+extern uint64_t audit_start;
+
+/* Evaluate @wait which waits for a reply or error of the server and note how
+ * long it blocked and where it was called from.
+ *
+ * @wait must evaluate to a pointer, the macro evaluates to the same pointer.
+ */
+#define AUDIT(wait) \
+    (begin_audit(), end_audit(__FILE__, __LINE__, (wait)))
+
+/* Like `AUDIT()` but for waiting on the reply to the request with @sequence
+ * that was sent through the X backend.
+ *
+ * If the reply is already there, @wait is not evaluated and the wait is counted
+ * as pipelined instead of as round trip.
+ */
+#define AUDIT_REPLY(sequence, wait) \
+    (is_auditing && poll_audit_reply(sequence) ? \
+        note_pipelined_audit(__FILE__, __LINE__) : AUDIT(wait))
+
+/* Like `AUDIT_REPLY()` but for the xcb reply functions that take @cookie and
+ * @error.
+ */
+#define AUDIT_XCB_REPLY(cookie, error, wait) \
+    (is_auditing && poll_audit_xcb_reply((cookie).sequence, (error)) ? \
+        note_pipelined_audit(__FILE__, __LINE__) : AUDIT(wait))
+
+/* Note the end of a reply wait that started with the last `begin_audit()`. */
+void note_audit(const char *file, int line);
+
+/* Check if the reply to the request with @sequence sent through the X backend
+ * is already there.
+ *
+ * @return true if the reply was taken, `note_pipelined_audit()` returns it.
+ */
+bool poll_audit_reply(uint32_t sequence);
+
+/* Check if the reply to the xcb request with @sequence is already there.
+ *
+ * @error is set like the xcb reply functions do it.
+ *
+ * @return true if the reply was taken, `note_pipelined_audit()` returns it.
+ */
+bool poll_audit_xcb_reply(uint32_t sequence, xcb_generic_error_t **error);
+
+/* Note that the call site at @file and @line did not need to wait because the
+ * reply was already there.
+ *
+ * @return the reply taken by the last poll.
+ */
+void *note_pipelined_audit(const char *file, int line);
+
+/* Start measuring a reply wait. */
+static inline void begin_audit(void)
+{
+    if (is_auditing) {
+        audit_start = get_latency_time();
+    }
+}
+
+/* End measuring a reply wait of the call site at @file and @line.
+ *
+ * @return @result.
+ */
+static inline void *end_audit(const char *file, int line, void *result)
+{
+    if (is_auditing) {
+        note_audit(file, line);
+    }
+    return result;
+}
+
+/* Start the timer that periodically reports the round trips if auditing is
+ * enabled.
+ */
+int initialize_audit(void);
+
+/* Note that an event cycle ended, this counts the round trips per cycle. */
+void end_audit_cycle(void);
+
+#endif
@@ -1,7 +1,19 @@
 #ifndef WINDOW_TYPE_H
 #define WINDOW_TYPE_H
 
+#include <stdint.h>
+
 struct window;
 typedef struct window Window;
 
+/* A handle refers to a window without pointing to it directly, it stays safe
+ * to use after the window is destroyed, see `get_window_of_handle()`.
+ */
+typedef struct window_handle {
+    /* the number of the window, 0 for no window */
+    uint32_t number;
+    /* how often the number was given out before */
+    uint32_t generation;
+} WindowHandle;
+
 #endif
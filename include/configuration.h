@@ -180,6 +180,17 @@ struct configuration_button *find_configured_button(
         struct configuration *configuration,
         uint16_t modifiers, xcb_button_t button_index, uint16_t flags);
 
+/* Get the button binding for a button event with @modifiers (the event state)
+ * and @flags.
+ *
+ * This uses a table that is rebuilt by `grab_configured_buttons()`. Note that
+ * this ignores BINDING_FLAG_TRANSPARENT.
+ *
+ * @return NULL if no button binding matches.
+ */
+struct configuration_button *get_button_binding(xcb_button_t button_index,
+        uint16_t modifiers, uint16_t flags);
+
 /* Grab the mousebindings so we receive the ButtonPress events for them. */
 void grab_configured_buttons(void);
 
@@ -191,9 +202,35 @@ struct configuration_key *find_configured_key(
         struct configuration *configuration,
         uint16_t modifiers, xcb_keysym_t key_symbol, uint16_t flags);
 
+/* Get the key binding for a key event with @modifiers (the event state) and
+ * @flags.
+ *
+ * This goes straight from the keycode to the binding without translating it to
+ * a key symbol, using a table that is rebuilt by `grab_configured_keys()`. Note
+ * that this ignores BINDING_FLAG_TRANSPARENT.
+ *
+ * @return NULL if no key binding matches.
+ */
+struct configuration_key *get_key_binding(xcb_keycode_t keycode,
+        uint16_t modifiers, uint16_t flags);
+
 /* Grab the keybindings so we receive the KeyPress events for them. */
 void grab_configured_keys(void);
 
+/* Check if the button grab for an event with @button_index and @modifiers
+ * (the event state) freezes the pointer until events are allowed again.
+ *
+ * Only buttons with a transparent binding are grabbed that way.
+ */
+bool is_button_grab_synchronous(xcb_button_t button_index, uint16_t modifiers);
+
+/* Check if the key grab for an event with @keycode and @modifiers (the event
+ * state) freezes the keyboard until events are allowed again.
+ *
+ * Only keys with a transparent binding are grabbed that way.
+ */
+bool is_key_grab_synchronous(xcb_keycode_t keycode, uint16_t modifiers);
+
 /* Compare the current configuration with the new configuration and set it. */
 void set_configuration(struct configuration *configuration);
 
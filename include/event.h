@@ -3,6 +3,7 @@
 
 #include "bits/window_typedef.h"
 
+#include "reactor.h"
 #include "x11_management.h"
 
 /* this is the first index of a randr event */
@@ -16,8 +17,13 @@ extern bool is_reload_requested;
  */
 extern bool has_client_list_changed;
 
-/* Create a signal handler for `SIGALRM`. */
-int initialize_signal_handlers(void);
+/* the timer that hides the notification window */
+extern ReactorTimer *notification_timer;
+
+/* Register the X connection, the termination signals and the notification
+ * timer in the reactor.
+ */
+int initialize_event_sources(void);
 
 /* Set the client list root property. */
 void synchronize_client_list(void);
@@ -25,13 +31,42 @@ void synchronize_client_list(void);
 /* Synchronize the local data with the X server. */
 void synchronize_with_server(void);
 
-/* Runs the next cycle of the event loop. This handles signals and all events
- * that are currently queued.
+/* Runs the next cycle of the event loop. This waits for any source of the
+ * reactor and then handles all events that are currently queued.
  *
  * It also delegates events to the window list if it is mapped.
  */
 int next_cycle(void);
 
+/* Handle all events the backend has queued and send the resulting changes,
+ * this is done by `next_cycle()` once a source is ready.
+ *
+ * @old_focus_window is the focused window before the cycle started.
+ */
+void run_cycle(Window *old_focus_window);
+
+/* Put @event into the event buffer and coalesce it with earlier events, this is
+ * done by `run_cycle()` for each received event.
+ *
+ * @event must be allocated, it is freed once it is dispatched or coalesced.
+ */
+void buffer_event(xcb_generic_event_t *event);
+
+/* Pass all events in the event buffer to the handlers and empty it. */
+void dispatch_buffered_events(void);
+
+/* Pass @event to all handlers of events, this is done by
+ * `dispatch_buffered_events()` for each buffered event.
+ */
+void dispatch_event(xcb_generic_event_t *event);
+
+/* Send all changes made while handling the events of a cycle to the server,
+ * this is done by `run_cycle()` after all events are handled.
+ *
+ * @old_focus_window is the focused window before the cycle started.
+ */
+void finish_cycle(Window *old_focus_window);
+
 /* Start resizing a window using the mouse. */
 void initiate_window_move_resize(Window *window,
         wm_move_resize_direction_t direction,
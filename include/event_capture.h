@@ -0,0 +1,124 @@
+#ifndef EVENT_CAPTURE_H
+#define EVENT_CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <xcb/xcb.h>
+
+#include "x11_management.h"
+
+/* An event capture stores the events fensterchef receives and the replies of
+ * window adoptions so they can be replayed without a server. The events are
+ * captured before they are coalesced, a replay coalesces them again.
+ *
+ * The file starts with an `EventCaptureHeader`, followed by the `ATOM_MAX`
+ * atom values, the key symbols of the keyboard mapping and then the records. Each record starts with a byte of
+ * `capture_record_type_t`:
+ * - `CAPTURE_RECORD_EVENT` is followed by the 32 bytes of the event.
+ * - `CAPTURE_RECORD_DISPATCH` has no data, it marks where the buffered events
+ *   are dispatched.
+ * - `CAPTURE_RECORD_CYCLE` has no data, it marks the end of a cycle.
+ * - `CAPTURE_RECORD_ADOPTION` is followed by a `CaptureAdoption` and the
+ *   attributes, geometry and property replies. Each reply is stored as 32 bit
+ *   size followed by the reply, the size is 0 for missing replies.
+ */
+
+/* the magic bytes at the start of an event capture */
+#define EVENT_CAPTURE_MAGIC "FCEV"
+
+/* the version of the capture format */
+#define EVENT_CAPTURE_VERSION 3
+
+/* the kind of a capture record */
+typedef enum {
+    /* an event passed to `buffer_event()` */
+    CAPTURE_RECORD_EVENT = 1,
+    /* the end of a cycle, see `finish_cycle()` */
+    CAPTURE_RECORD_CYCLE,
+    /* the replies a window was adopted with */
+    CAPTURE_RECORD_ADOPTION,
+    /* the buffered events are dispatched, see `dispatch_buffered_events()` */
+    CAPTURE_RECORD_DISPATCH,
+} capture_record_type_t;
+
+/* the header at the start of an event capture */
+typedef struct event_capture_header {
+    /* `EVENT_CAPTURE_MAGIC` without null terminator */
+    char magic[4];
+    /* `EVENT_CAPTURE_VERSION` */
+    uint32_t version;
+    /* the number of atoms following the header, this is `ATOM_MAX` */
+    uint32_t number_of_atoms;
+    /* the first event code of the randr extension */
+    uint32_t randr_event_base;
+    /* the screen the events were captured on */
+    xcb_window_t root;
+    xcb_visualid_t root_visual;
+    uint16_t width;
+    uint16_t height;
+    uint8_t root_depth;
+    /* the keyboard mapping, the key symbols follow the atoms */
+    uint8_t min_keycode;
+    uint8_t keysyms_per_keycode;
+    /* always zero */
+    uint8_t reserved;
+    uint32_t number_of_keysyms;
+} EventCaptureHeader;
+
+/* the data of an adoption record */
+typedef struct capture_adoption {
+    /* the adopted window */
+    xcb_window_t window;
+    /* if the window was requested to be mapped */
+    uint8_t is_map_requested;
+    /* always zero */
+    uint8_t reserved[3];
+    /* the properties whose replies follow */
+    uint32_t properties;
+} CaptureAdoption;
+
+/* the file to capture events into, set by `--capture-events` */
+extern const char *event_capture_path;
+
+/* the file to replay events from, set by `--replay-events` */
+extern const char *event_replay_path;
+
+/* if events are being replayed right now */
+extern bool is_replaying_events;
+
+/* Open the capture file and write the header if a capture was requested.
+ *
+ * This must be called after the atoms and monitors are initialized.
+ *
+ * @return ERROR if the file could not be opened.
+ */
+int initialize_event_capture(void);
+
+/* Add @event to the capture. */
+void capture_event(const xcb_generic_event_t *event);
+
+/* Mark that the buffered events are dispatched in the capture. */
+void capture_dispatch(void);
+
+/* Mark the end of a cycle in the capture. */
+void capture_cycle_end(void);
+
+/* Add the replies @xcb_window is adopted with to the capture. */
+void capture_adoption(xcb_window_t xcb_window, bool is_map_requested,
+        const xcb_get_window_attributes_reply_t *attributes,
+        const xcb_get_geometry_reply_t *geometry, const PropertyWave *wave);
+
+/* Replay the capture at @path through the event handlers as fast as possible
+ * and log how long it took.
+ *
+ * This sets up fensterchef without a server: all requests are dropped and all
+ * replies are missing, only the keyboard mapping and the adoption replies come
+ * from the capture. The default configuration is used so the replay does not
+ * depend on the user configuration.
+ *
+ * @return ERROR if the capture could not be read.
+ */
+int replay_events(const char *path);
+
+#endif
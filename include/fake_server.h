@@ -0,0 +1,72 @@
+#ifndef FAKE_SERVER_H
+#define FAKE_SERVER_H
+
+#include <stdint.h>
+
+#include <xcb/xcb.h>
+
+#include "x11_management.h"
+
+/* The fake server is an in-process model of an X server that only knows the
+ * root window and its children. It keeps their geometry, attributes,
+ * properties, stacking order and the input focus and answers all requests of
+ * `fake_backend` right away. Events are generated like a real server would
+ * generate them for the selected event masks.
+ *
+ * The clients of the fake server live in the same process and use the
+ * `*_fake_client()` functions, for example `map_fake_client()` sends a
+ * MapRequest to fensterchef like a real client would.
+ */
+
+/* the identifier of the root window of the fake server, all identifiers given
+ * out come after it
+ */
+#define FAKE_ROOT_WINDOW 0x100
+
+/* the first atom the fake server interns, the atoms before are predefined */
+#define FAKE_FIRST_ATOM 0x100
+
+/* the backend answering from the fake server */
+extern const XBackend fake_backend;
+
+/* Set up the fake server with a screen of @width x @height and use it as
+ * backend.
+ *
+ * This also sets up `connection` in error state so that all requests which
+ * do not go through the backend (rendering, grabs, ...) are dropped.
+ */
+void initialize_fake_server(uint32_t width, uint32_t height);
+
+/* Create an unmapped window of a new client. */
+xcb_window_t create_fake_client(int32_t x, int32_t y, uint32_t width,
+        uint32_t height);
+
+/* Replace @property of the client window @window, this notifies fensterchef if
+ * it selected property changes.
+ */
+void set_fake_client_property(xcb_window_t window, xcb_atom_t property,
+        xcb_atom_t type, uint8_t format, uint32_t length, const void *data);
+
+/* Ask for the client window @window to be shown. */
+void map_fake_client(xcb_window_t window);
+
+/* Hide the client window @window. */
+void unmap_fake_client(xcb_window_t window);
+
+/* Ask for the client window @window to get a new geometry. */
+void configure_fake_client(xcb_window_t window, int32_t x, int32_t y,
+        uint32_t width, uint32_t height);
+
+/* Destroy the client window @window. */
+void destroy_fake_client(xcb_window_t window);
+
+/* Check if the client window @window still exists. */
+bool does_fake_client_exist(xcb_window_t window);
+
+/* Get the number of requests fensterchef sent to the fake server. */
+uint64_t get_number_of_fake_requests(void);
+
+/* Log how many requests of each kind fensterchef sent to the fake server. */
+void log_fake_server_statistics(void);
+
+#endif
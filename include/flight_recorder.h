@@ -0,0 +1,135 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <xcb/xcb.h>
+
+#include <stdint.h>
+
+#include "action.h"
+#include "x11_management.h"
+
+/* the number of records the flight recorder keeps, this is a power of two */
+#define FLIGHT_RECORDER_SIZE 4096
+
+/* the magic bytes at the start of a flight recorder dump */
+#define FLIGHT_RECORDER_MAGIC "FCFR"
+
+/* the version of the dump format */
+#define FLIGHT_RECORDER_VERSION 2
+
+/* the kind of a flight record */
+typedef enum {
+    /* an event handled by `handle_event()` */
+    FLIGHT_RECORD_EVENT = 1,
+    /* an action done by `do_action()` */
+    FLIGHT_RECORD_ACTION,
+    /* the changes of a client sent by `commit_client()` */
+    FLIGHT_RECORD_COMMIT,
+} flight_record_type_t;
+
+/* A single entry of the flight recorder, it is 44 bytes large: 8 bytes for the
+ * time and type and 36 bytes for the data which is as large as the event.
+ */
+typedef struct flight_record {
+    /* the milliseconds since the start of fensterchef */
+    uint32_t time;
+    /* the kind of record, see `flight_record_type_t` */
+    uint8_t type;
+    /* always zero */
+    uint8_t reserved[3];
+    /* the data of the record depending on `type` */
+    union {
+        /* the event as received from the server */
+        xcb_generic_event_t event;
+        /* an action */
+        struct {
+            /* the code of the action */
+            uint32_t code;
+            /* the window the action was done on */
+            xcb_window_t window;
+            /* the integer parameters of the action */
+            int32_t parameters[4];
+        } action;
+        /* the state of a client after it was committed */
+        struct {
+            /* the X window of the client */
+            xcb_window_t window;
+            /* the geometry of the client */
+            int32_t x;
+            int32_t y;
+            uint32_t width;
+            uint32_t height;
+            uint32_t border_width;
+            /* if the client is mapped */
+            uint32_t is_mapped;
+        } commit;
+    } data;
+} FlightRecord;
+
+/* dumps are decoded as raw records, so the size must not change by accident,
+ * this is a C99 replacement for `_Static_assert()`
+ */
+typedef char flight_record_size_check[sizeof(FlightRecord) == 44 ? 1 : -1];
+
+/* the header at the start of a flight recorder dump, the `ATOM_MAX` atom
+ * values follow and then the records from oldest to newest
+ */
+typedef struct flight_recorder_header {
+    /* `FLIGHT_RECORDER_MAGIC` without null terminator */
+    char magic[4];
+    /* `FLIGHT_RECORDER_VERSION` */
+    uint32_t version;
+    /* the size of a single record */
+    uint32_t record_size;
+    /* the number of records in the dump */
+    uint32_t number_of_records;
+    /* the first event code of the randr extension */
+    uint32_t randr_event_base;
+    /* the number of atoms following the header, this is `ATOM_MAX` */
+    uint32_t number_of_atoms;
+    /* the root window and the utility windows so they can be named */
+    xcb_window_t root;
+    xcb_window_t check_window;
+    xcb_window_t window_list;
+    xcb_window_t notification;
+} FlightRecorderHeader;
+
+/* Choose the dump file and install the dump handlers for SIGSEGV, SIGABRT and
+ * SIGUSR1.
+ *
+ * @return ERROR if SIGUSR1 could not be registered.
+ */
+int initialize_flight_recorder(void);
+
+/* Take the current time for all records until the next tick, this is done
+ * once per cycle.
+ */
+void tick_flight_recorder(void);
+
+/* Record an event that is about to be handled. */
+void record_event(const xcb_generic_event_t *event);
+
+/* Record an action that is about to be done on @window. */
+void record_action(const Action *action, const Window *window);
+
+/* Record the state of @client after it was committed. */
+void record_commit(const XClient *client);
+
+/* Write all records to the dump file, this is async-signal-safe.
+ *
+ * @return ERROR if the file could not be written.
+ */
+int dump_flight_recorder(void);
+
+/* Get the path of the file the records are dumped into. */
+const char *get_flight_recorder_path(void);
+
+/* Print the records within the dump at @path in the log format.
+ *
+ * This runs without a server, the atoms and windows are taken from the dump.
+ *
+ * @return ERROR if the file is not a flight recorder dump.
+ */
+int decode_flight_recorder_dump(const char *path);
+
+#endif
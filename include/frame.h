@@ -38,6 +38,10 @@ typedef enum {
 struct frame {
     /* the window inside the frame, may be NULL */
     Window *window;
+    /* the window inside a stashed frame, `window` is only set again once the
+     * frame is popped from the stash
+     */
+    WindowHandle stashed_window;
 
     /* coordinates and size of the frame */
     int32_t x;
@@ -63,6 +67,15 @@ struct frame {
 /* the currently selected/focused frame */
 extern Frame *focus_frame;
 
+/* Allocate a zeroed frame from the frame pool. */
+Frame *create_frame(void);
+
+/* Give @frame back to the frame pool, @frame may be NULL.
+ *
+ * This does not touch the child frames or the inner window.
+ */
+void destroy_frame(Frame *frame);
+
 /* Check if the given point is within the given frame.
  *
  * @return if the point is inside the frame.
@@ -85,6 +98,18 @@ void resize_frame(Frame *frame, int32_t x, int32_t y,
  */
 void replace_frame(Frame *frame, Frame *with);
 
+/* Point all windows within @frame and its children to the frame they are in.
+ *
+ * Call this when @frame becomes part of the frame tree of a monitor.
+ */
+void attach_inner_windows(Frame *frame);
+
+/* Set the frame of all windows within @frame and its children to NULL.
+ *
+ * Call this when @frame is taken out of the frame tree of a monitor.
+ */
+void detach_inner_windows(Frame *frame);
+
 /* Get the gaps the frame applies to its inner window. */
 void get_frame_gaps(Frame *frame, Extents *gaps);
 
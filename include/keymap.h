@@ -7,6 +7,14 @@
 /* Initializes the key symbol table so the below functions can be used. */
 int initialize_keymap(void);
 
+/* Use the given keyboard mapping instead of asking the server.
+ *
+ * This is how replaying captured events resolves keys, @keysyms has
+ * @keysyms_per_keycode entries for each keycode starting at @min_keycode.
+ */
+void set_keymap(xcb_keycode_t min_keycode, uint8_t keysyms_per_keycode,
+        const xcb_keysym_t *keysyms, uint32_t number_of_keysyms);
+
 /* Refresh the keymap if a mapping notify event arrives. */
 void refresh_keymap(xcb_mapping_notify_event_t *event);
 
@@ -43,6 +43,14 @@ extern log_severity_t log_severity;
 
 #endif
 
+/* Start the thread that writes out the log lines.
+ *
+ * Before this is called, lines are written directly. Afterwards the main thread
+ * only formats lines into a ring buffer and lines that do not fit are dropped
+ * and counted.
+ */
+void initialize_logging(void);
+
 /* wrappers around `log_formatted` for different severities */
 #define LOG_VERBOSE(...) \
     log_formatted(LOG_SEVERITY_ALL, __FILE__, __LINE__, __VA_ARGS__)
@@ -24,6 +24,11 @@ typedef struct monitor {
     /* root frame */
     Frame *frame;
 
+    /* if the root frame needs to be resized because the monitor size or strut
+     * changed
+     */
+    bool is_dirty;
+
     /* next monitor in the linked list */
     struct monitor *next;
 } Monitor;
@@ -31,6 +36,11 @@ typedef struct monitor {
 /* the first monitor in the monitor linked list */
 extern Monitor *first_monitor;
 
+/* if the struts of the monitors need to be recomputed, this is the case when
+ * a window with strut changed or the monitors changed
+ */
+extern bool are_monitor_struts_dirty;
+
 /* Try to initialize randr and the internal monitor linked list. */
 void initialize_monitors(void);
 
@@ -0,0 +1,77 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+/* The reactor is what the event loop waits on. Any part of fensterchef can
+ * register file descriptors, timers and signals along with a callback that is
+ * run when the source becomes ready.
+ *
+ * Signals registered in the reactor are blocked and received through a signal
+ * file descriptor, so they are handled like any other source and never
+ * interrupt the program in the middle of something.
+ */
+
+/* A callback for a file descriptor, @events are the ready events
+ * (`EPOLLIN`, `EPOLLOUT`, ...).
+ */
+typedef void (*reactor_callback_t)(int file_descriptor, uint32_t events,
+        void *data);
+
+/* A callback for an expired timer. */
+typedef void (*timer_callback_t)(void *data);
+
+/* A callback for a received signal. */
+typedef void (*signal_callback_t)(int signal);
+
+/* a timer that runs a callback after some time */
+typedef struct reactor_timer ReactorTimer;
+
+/* Create the epoll instance and signal file descriptor. */
+int initialize_reactor(void);
+
+/* Start watching @file_descriptor for @events.
+ *
+ * @callback may be NULL, then the reactor only wakes up.
+ */
+int register_file_descriptor(int file_descriptor, uint32_t events,
+        reactor_callback_t callback, void *data);
+
+/* Stop watching @file_descriptor. This does not close it. */
+void unregister_file_descriptor(int file_descriptor);
+
+/* Create a timer that runs @callback once it expires.
+ *
+ * The timer is disarmed initially, use `set_timer()` to arm it.
+ *
+ * @return NULL if the timer could not be created.
+ */
+ReactorTimer *create_timer(timer_callback_t callback, void *data);
+
+/* Arm @timer to expire in @milliseconds, this replaces any previous
+ * expiration. A value of 0 disarms the timer.
+ */
+void set_timer(ReactorTimer *timer, uint32_t milliseconds);
+
+/* Destroy a timer created by `create_timer()`. */
+void destroy_timer(ReactorTimer *timer);
+
+/* Block @signal and run @callback whenever it is received. */
+int register_signal(int signal, signal_callback_t callback);
+
+/* Restore the signal mask that was active before signals were registered.
+ *
+ * Blocked signals are inherited by child processes, so this must be called in
+ * a child before executing another program.
+ */
+void restore_signal_mask(void);
+
+/* Wait until a source is ready and run the callbacks of all ready sources.
+ *
+ * @timeout is the maximum time to wait in milliseconds, -1 waits indefinitely
+ *          and 0 does not wait at all.
+ */
+int wait_for_sources(int timeout);
+
+#endif
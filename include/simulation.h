@@ -0,0 +1,20 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stdint.h>
+
+/* the number of windows to simulate, set by `--simulate` */
+extern uint32_t number_of_simulated_windows;
+
+/* Run fensterchef against the fake server and let @number_of_windows clients
+ * go through their life cycle: each window is mapped, renamed, configured,
+ * unmapped, mapped again and finally closed. Each step is its own cycle.
+ *
+ * The time and the number of requests of each phase are logged, followed by
+ * the requests by kind and the latency statistics.
+ *
+ * @return ERROR if fensterchef could not be set up or a window is left over.
+ */
+int run_simulation(uint32_t number_of_windows);
+
+#endif
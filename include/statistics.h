@@ -0,0 +1,84 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <stdint.h>
+
+/* the number of sub buckets within each power of two of a histogram, values
+ * are recorded with a precision of 1/8th
+ */
+#define LATENCY_SUB_BUCKET_BITS 3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+
+/* durations at or above 2^36 nanoseconds (about a minute) all land in the last
+ * bucket
+ */
+#define LATENCY_MAXIMUM_EXPONENT 36
+
+/* the number of buckets of a histogram */
+#define LATENCY_BUCKETS \
+    ((LATENCY_MAXIMUM_EXPONENT - LATENCY_SUB_BUCKET_BITS + 1) * \
+        LATENCY_SUB_BUCKETS)
+
+/* the number of event types, the most significant bit of a response type is
+ * not part of the type
+ */
+#define LATENCY_EVENT_TYPES 128
+
+/* what a latency histogram measures */
+typedef enum {
+    /* a full cycle of `run_cycle()` */
+    LATENCY_CYCLE,
+    /* a call to `synchronize_with_server()` */
+    LATENCY_SYNCHRONIZE_WITH_SERVER,
+    /* a call to `synchronize_client_list()` */
+    LATENCY_SYNCHRONIZE_CLIENT_LIST,
+    /* a call to `xcb_flush()` at the end of a cycle */
+    LATENCY_FLUSH,
+    /* handling an event, the event type is added to this */
+    LATENCY_EVENT,
+
+    /* not a real latency */
+    LATENCY_MAX = LATENCY_EVENT + LATENCY_EVENT_TYPES,
+} latency_t;
+
+/* Log-linear histogram of durations in nanoseconds. */
+typedef struct latency_histogram {
+    /* the number of recorded durations */
+    uint64_t count;
+    /* the longest recorded duration */
+    uint64_t maximum;
+    /* the number of durations within each bucket */
+    uint32_t buckets[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+/* Get the current time of the monotonic clock in nanoseconds. */
+uint64_t get_latency_time(void);
+
+/* Add the duration since @start to the histogram of @latency.
+ *
+ * @start is a value returned by `get_latency_time()`.
+ */
+void record_latency(latency_t latency, uint64_t start);
+
+/* Get the smallest duration that is larger than @percentile percent of all
+ * durations in @histogram, the result is the upper bound of a bucket.
+ */
+uint64_t get_latency_percentile(const LatencyHistogram *histogram,
+        uint32_t percentile);
+
+/* Log all non empty histograms.
+ *
+ * @return the event type with the highest 99th percentile or `LATENCY_MAX` if
+ *         no event was handled.
+ */
+latency_t log_latency_statistics(void);
+
+/* Log all non empty histograms and show a short summary in the notification
+ * window.
+ */
+void show_latency_statistics(void);
+
+/* Clear all histograms. */
+void reset_latency_statistics(void);
+
+#endif
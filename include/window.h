@@ -24,6 +24,21 @@
 /* the number the first window gets assigned */
 #define FIRST_WINDOW_NUMBER 1
 
+/* a handle that refers to no window */
+#define NULL_WINDOW_HANDLE ((WindowHandle) { 0, 0 })
+
+/* the position or size of the window changed */
+#define WINDOW_DIRTY_GEOMETRY (1 << 0)
+/* the window was shown or hidden */
+#define WINDOW_DIRTY_VISIBILITY (1 << 1)
+/* the strut of the window changed */
+#define WINDOW_DIRTY_STRUT (1 << 2)
+/* the border size or color of the window changed */
+#define WINDOW_DIRTY_BORDER (1 << 3)
+/* all dirty flags */
+#define WINDOW_DIRTY_ALL (WINDOW_DIRTY_GEOMETRY | WINDOW_DIRTY_VISIBILITY | \
+        WINDOW_DIRTY_STRUT | WINDOW_DIRTY_BORDER)
+
 /* A window is a wrapper around an X window, it is always part of a few global
  * linked list and has a unique id (number).
  */
@@ -47,7 +62,10 @@ struct window {
     xcb_window_t transient_for;
 
     /* the protocols the window supports */
-    xcb_atom_t *protocols;
+    AtomSet protocols;
+
+    /* the types of the window, only the types known to fensterchef */
+    AtomSet types;
 
     /* the region the window should appear at as fullscreen window */
     Extents fullscreen_monitors;
@@ -55,8 +73,14 @@ struct window {
     /* the motif window manager hints */
     motif_wm_hints_t motif_wm_hints;
 
-    /* the window states */
-    xcb_atom_t *states;
+    /* the window states known to fensterchef */
+    AtomSet states;
+    /* the window states not known to fensterchef, they are kept so they are
+     * written back together with the known states
+     */
+    xcb_atom_t *unknown_states;
+    /* the number of unknown states */
+    uint32_t number_of_unknown_states;
 
     /* the window state */
     WindowState state;
@@ -77,6 +101,18 @@ struct window {
     /* the id of this window */
     uint32_t number;
 
+    /* the frame the window is in, this is only set while the window is within
+     * the frame tree of a monitor
+     */
+    Frame *frame;
+
+    /* what changed since the last synchronization with the server, see
+     * `WINDOW_DIRTY_*`
+     */
+    uint32_t dirty;
+    /* the next window in the dirty linked list */
+    Window *next_dirty;
+
     /* All windows are part of the Z ordered linked list even when they are
      * hidden now.
      *
@@ -88,10 +124,14 @@ struct window {
     Window *above;
 
     /* The age linked list stores the windows in creation time order. */
+    /* a window older than this one */
+    Window *older;
     /* a window newer than this one */
     Window *newer;
 
     /* The number linked list stores the windows sorted by their number. */
+    /* the previous window in the linked list */
+    Window *previous;
     /* the next window in the linked list */
     Window *next;
 };
@@ -99,6 +139,9 @@ struct window {
 /* the window that was created before any other */
 extern Window *oldest_window;
 
+/* the window that was created last */
+extern Window *newest_window;
+
 /* the window at the bottom of the Z stack */
 extern Window *bottom_window;
 
@@ -111,8 +154,29 @@ extern Window *first_window;
 /* the currently focused window */
 extern Window *focus_window;
 
-/* Create a window struct and add it to the window list. */
-Window *create_window(xcb_window_t xcb);
+/* the first window that needs to be synchronized with the server */
+extern Window *first_dirty_window;
+
+/* Create a window struct and add it to the window list.
+ *
+ * @attributes and @geometry are the replies received for the X window and
+ * @wave must contain all window properties, see `adopt_window()`.
+ */
+Window *create_window(xcb_window_t xcb_window,
+        const xcb_get_window_attributes_reply_t *attributes,
+        const xcb_get_geometry_reply_t *geometry, PropertyWave *wave);
+
+/* Create window structs for many X windows and add them to the window list in
+ * one go.
+ *
+ * This works like `create_window()` for each X window but links all windows
+ * into the window lists in a single pass. The created windows are stored in
+ * @windows.
+ */
+void create_windows(uint32_t count, const xcb_window_t *xcb_windows,
+        xcb_get_window_attributes_reply_t *const *attributes,
+        xcb_get_geometry_reply_t *const *geometries, PropertyWave *waves,
+        Window **windows);
 
 /* time in seconds to wait for a second close */
 #define REQUEST_CLOSE_MAX_DURATION 3
@@ -128,6 +192,11 @@ void close_window(Window *window);
  */
 void destroy_window(Window *window);
 
+/* Mark that @window changed in a way that needs to be synchronized with the
+ * server, @flags is a combination of `WINDOW_DIRTY_*`.
+ */
+void mark_window_dirty(Window *window, uint32_t flags);
+
 /* Adjust given @x and @y such that it follows the @window_gravity. */
 void adjust_for_window_gravity(Monitor *monitor, int32_t *x, int32_t *y,
         uint32_t width, uint32_t height, uint32_t window_gravity);
@@ -158,12 +227,36 @@ void update_window_layer(Window *window);
  */
 Window *get_window_of_xcb_window(xcb_window_t xcb_window);
 
+/* Get a handle that refers to @window, @window may be NULL. */
+WindowHandle get_window_handle(const Window *window);
+
+/* Get the window @handle refers to.
+ *
+ * This is a constant time check of the window number and its generation.
+ *
+ * @return NULL if the window no longer exists or the handle is not set.
+ */
+Window *get_window_of_handle(WindowHandle handle);
+
+/* Check if @handle was set to a window, the window might no longer exist. */
+static inline bool is_window_handle_set(WindowHandle handle)
+{
+    return handle.number != 0;
+}
+
 /* Get the frame this window is contained in.
  *
  * @return NULL when the window is not in any frame.
  */
 Frame *get_frame_of_window(const Window *window);
 
+#ifdef DEBUG
+/* Check that the frame of each window matches the frame trees of the monitors
+ * and log an error for each mismatch.
+ */
+void check_window_frames(void);
+#endif
+
 /* Check if the window accepts input focus. */
 bool does_window_accept_focus(Window *window);
 
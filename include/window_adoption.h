@@ -0,0 +1,50 @@
+#ifndef WINDOW_ADOPTION_H
+#define WINDOW_ADOPTION_H
+
+#include "x11_management.h"
+
+/* the number of windows that are currently being adopted */
+extern uint32_t number_of_adoptions;
+
+/* Start adopting the X window @xcb_window without blocking.
+ *
+ * This sends the requests needed to manage the window and puts it into the
+ * pending adoption queue. The window is created once all replies arrived, see
+ * `process_pending_adoptions()`.
+ *
+ * @is_map_requested is true if the window should be shown once it is adopted,
+ *                   windows that are already mapped are always shown.
+ */
+void adopt_window(xcb_window_t xcb_window, bool is_map_requested);
+
+/* Adopt all given X windows at once and wait until they are adopted.
+ *
+ * This is used when fensterchef starts to manage the already existing windows.
+ * Instead of waiting for each window separately, the requests of all windows
+ * are sent in two waves: the attributes and geometry to filter out windows
+ * that should not be managed, then the properties of the remaining windows.
+ * Windows that are already mapped are shown.
+ */
+void adopt_windows_now(const xcb_window_t *xcb_windows, uint32_t count);
+
+/* Create the window of @xcb_window from the received replies and show it if
+ * needed.
+ *
+ * This is the last step of an adoption, it is also used to recreate the
+ * windows of captured events when replaying them.
+ *
+ * @is_map_requested is true if the window should be shown and focused.
+ */
+void finish_window_adoption(xcb_window_t xcb_window, bool is_map_requested,
+        const xcb_get_window_attributes_reply_t *attributes,
+        const xcb_get_geometry_reply_t *geometry, PropertyWave *wave);
+
+/* Handle an incoming event for the windows that are being adopted. */
+void handle_adoption_event(xcb_generic_event_t *event);
+
+/* Check for replies of the pending adoptions without blocking and finish all
+ * adoptions that received all their replies.
+ */
+void process_pending_adoptions(void);
+
+#endif
@@ -44,12 +44,16 @@ window_mode_t predict_window_mode(Window *window);
 /* Check if @window has a visible border currently. */
 bool has_window_border(Window *window);
 
-/* Add window states to the window's properties. */
-void add_window_states(Window *window, xcb_atom_t *states,
+/* Add window states to the window's properties, @states are atom constants
+ * like `_NET_WM_STATE_HIDDEN`.
+ */
+void add_window_states(Window *window, const uint32_t *states,
         uint32_t number_of_states);
 
-/* Remove window states from the window's properties. */
-void remove_window_states(Window *window, xcb_atom_t *states,
+/* Remove window states from the window's properties, @states are atom
+ * constants like `_NET_WM_STATE_HIDDEN`.
+ */
+void remove_window_states(Window *window, const uint32_t *states,
         uint32_t number_of_states);
 
 /* Change the mode to given value and reconfigures the window if it is visible.
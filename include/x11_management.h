@@ -210,6 +210,35 @@ extern struct x_atoms {
     xcb_atom_t atom;
 } x_atoms[ATOM_MAX];
 
+/* the number of words an atom set needs to have a bit for every atom */
+#define ATOM_SET_WORDS ((ATOM_MAX + 63) / 64)
+
+/* A set of atoms out of `DEFINE_ALL_ATOMS`, each atom is the bit at the index
+ * of its constant, for example `_NET_WM_STATE_HIDDEN`.
+ */
+typedef struct atom_set {
+    /* the bits of the atoms */
+    uint64_t bits[ATOM_SET_WORDS];
+} AtomSet;
+
+/* Check if the atom constant @id is within @set. */
+static inline bool is_in_atom_set(const AtomSet *set, uint32_t id)
+{
+    return (set->bits[id / 64] & (UINT64_C(1) << (id % 64))) != 0;
+}
+
+/* Add the atom constant @id to @set. */
+static inline void add_to_atom_set(AtomSet *set, uint32_t id)
+{
+    set->bits[id / 64] |= UINT64_C(1) << (id % 64);
+}
+
+/* Remove the atom constant @id from @set. */
+static inline void remove_from_atom_set(AtomSet *set, uint32_t id)
+{
+    set->bits[id / 64] &= ~(UINT64_C(1) << (id % 64));
+}
+
 /* needed for `_NET_WM_STRUT_PARTIAL`/`_NET_WM_STRUT` */
 typedef struct wm_strut_partial {
     /* reserved space on the border of the screen */
@@ -302,8 +331,164 @@ typedef struct x_client {
     uint32_t border_width;
     /* the color of the border */
     uint32_t border_color;
+
+    /* The fields above are the state fensterchef wants the client to have.
+     * They are only sent to the server when the client is committed, see
+     * `commit_client()`.
+     */
+    /* the state that was last sent to the server */
+    struct {
+        bool is_mapped;
+        int32_t x;
+        int32_t y;
+        uint32_t width;
+        uint32_t height;
+        uint32_t border_width;
+        uint32_t border_color;
+    } committed;
+    /* if the client is in the pending client list */
+    bool is_pending;
+    /* the next client with changes that are not committed yet */
+    struct x_client *next_pending;
 } XClient;
 
+/* the window properties cached by fensterchef */
+typedef enum window_property {
+    /* `_NET_WM_NAME` */
+    WINDOW_PROPERTY_NET_WM_NAME,
+    /* `WM_NAME`, the fallback for `_NET_WM_NAME` */
+    WINDOW_PROPERTY_WM_NAME,
+    /* `WM_NORMAL_HINTS` */
+    WINDOW_PROPERTY_WM_NORMAL_HINTS,
+    /* `WM_HINTS` */
+    WINDOW_PROPERTY_WM_HINTS,
+    /* `_NET_WM_STRUT_PARTIAL` */
+    WINDOW_PROPERTY_NET_WM_STRUT_PARTIAL,
+    /* `_NET_WM_STRUT`, the fallback for `_NET_WM_STRUT_PARTIAL` */
+    WINDOW_PROPERTY_NET_WM_STRUT,
+    /* `WM_TRANSIENT_FOR` */
+    WINDOW_PROPERTY_WM_TRANSIENT_FOR,
+    /* `WM_PROTOCOLS` */
+    WINDOW_PROPERTY_WM_PROTOCOLS,
+    /* `_NET_WM_FULLSCREEN_MONITORS` */
+    WINDOW_PROPERTY_NET_WM_FULLSCREEN_MONITORS,
+    /* `_MOTIF_WM_HINTS` */
+    WINDOW_PROPERTY_MOTIF_WM_HINTS,
+    /* `_NET_WM_STATE` */
+    WINDOW_PROPERTY_NET_WM_STATE,
+    /* `_NET_WM_WINDOW_TYPE`, only used to guess the initial window mode */
+    WINDOW_PROPERTY_NET_WM_WINDOW_TYPE,
+    /* the number of window properties */
+    WINDOW_PROPERTY_MAX
+} window_property_t;
+
+/* get the bit of a window property within a property mask */
+#define WINDOW_PROPERTY_BIT(property) (UINT32_C(1) << (property))
+
+/* mask of all window properties */
+#define WINDOW_PROPERTY_ALL (WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_MAX) - 1)
+
+/* A wave of property requests. All requests are sent at once and only then
+ * the replies are collected, this way fetching any number of properties only
+ * costs a single round trip.
+ */
+typedef struct property_wave {
+    /* the window the properties belong to */
+    xcb_window_t window;
+    /* mask of the requested properties */
+    uint32_t properties;
+    /* mask of the properties whose reply was received */
+    uint32_t received;
+    /* the sequence numbers of the sent requests */
+    uint32_t sequences[WINDOW_PROPERTY_MAX];
+    /* the replies, NULL if not received yet or on error */
+    xcb_get_property_reply_t *replies[WINDOW_PROPERTY_MAX];
+} PropertyWave;
+
+/* The requests, replies and events fensterchef manages windows with. All of
+ * them go through `x_backend` so the window management can also run against
+ * the in-process fake server of `fake_server.h`.
+ *
+ * Requests with a reply return their sequence number which is then passed to
+ * `poll_for_reply()`, `wait_for_reply()` or `discard_reply()`. Rendering,
+ * grabs, randr and the keymap still use `connection` directly.
+ */
+typedef struct x_backend {
+    /* Get an identifier for a new resource. */
+    uint32_t (*generate_id)(void);
+    /* Create the child @window of the root and wait until it is created.
+     *
+     * @return the error or NULL if the window was created.
+     */
+    xcb_generic_error_t *(*create_window_checked)(xcb_window_t window,
+            int32_t x, int32_t y, uint32_t width, uint32_t height,
+            uint16_t window_class, uint32_t value_mask,
+            const uint32_t *values);
+    /* Change the attributes within @value_mask of @window. */
+    void (*change_window_attributes)(xcb_window_t window,
+            uint32_t value_mask, const uint32_t *values);
+    /* Change the attributes within @value_mask of @window and wait until they
+     * are changed.
+     *
+     * @return the error or NULL if the attributes were changed.
+     */
+    xcb_generic_error_t *(*change_window_attributes_checked)(
+            xcb_window_t window, uint32_t value_mask, const uint32_t *values);
+    /* Change the geometry or stacking within @value_mask of @window. */
+    void (*configure_window)(xcb_window_t window, uint16_t value_mask,
+            const uint32_t *values);
+    /* Show @window. */
+    void (*map_window)(xcb_window_t window);
+    /* Hide @window. */
+    void (*unmap_window)(xcb_window_t window);
+    /* Replace @property of @window, @length is the number of elements of
+     * size @format.
+     */
+    void (*change_property)(xcb_window_t window, xcb_atom_t property,
+            xcb_atom_t type, uint8_t format, uint32_t length,
+            const void *data);
+    /* Give the input focus to @window, it reverts to the pointer root. */
+    void (*set_input_focus)(xcb_window_t window);
+    /* Send the 32 bytes of @event to @window. */
+    void (*send_event)(xcb_window_t window, const char *event);
+    /* Destroy all resources of the client owning @window. */
+    void (*kill_client)(xcb_window_t window);
+    /* Request the attributes of @window. */
+    uint32_t (*get_window_attributes)(xcb_window_t window);
+    /* Request the geometry of @window. */
+    uint32_t (*get_geometry)(xcb_window_t window);
+    /* Request @length 32 bit units of @property of @window. */
+    uint32_t (*get_property)(xcb_window_t window, xcb_atom_t property,
+            xcb_atom_t type, uint32_t length);
+    /* Request the children of @window in bottom to top stacking order. */
+    uint32_t (*query_tree)(xcb_window_t window);
+    /* Check for the reply of the request with @sequence without blocking.
+     *
+     * @return true if the request is done, @reply is NULL on error.
+     */
+    bool (*poll_for_reply)(uint32_t sequence, void **reply);
+    /* Wait for the reply of the request with @sequence.
+     *
+     * @return NULL on error.
+     */
+    void *(*wait_for_reply)(uint32_t sequence);
+    /* Drop the reply of the request with @sequence once it arrives. */
+    void (*discard_reply)(uint32_t sequence);
+    /* Get the next event without blocking.
+     *
+     * @return NULL if there is no event.
+     */
+    xcb_generic_event_t *(*poll_for_event)(void);
+    /* Send all buffered requests. */
+    void (*flush)(void);
+} XBackend;
+
+/* the backend talking to the X server over `connection` */
+extern const XBackend server_backend;
+
+/* the backend all window management requests go through */
+extern const XBackend *x_backend;
+
 /* connection to the X server */
 extern xcb_connection_t *connection;
 
@@ -322,6 +507,16 @@ extern xcb_window_t wm_check_window;
 /* user notification window */
 extern XClient notification;
 
+/* the number of requests that were not sent because a later change of the
+ * same client replaced them before committing
+ */
+extern uint64_t number_of_suppressed_requests;
+
+/* the number of property changes that were not sent because the server
+ * already had the value, see `set_property()`
+ */
+extern uint64_t number_of_suppressed_properties;
+
 /* Check if given strut has any reserved space. */
 static inline bool is_strut_empty(wm_strut_partial_t *strut)
 {
@@ -351,33 +546,134 @@ void initialize_root_properties(void);
 /* Set the input focus to @window. This window may be `NULL`. */
 void set_input_focus(Window *window);
 
-/* Show the client on the X server. */
+/* Take the current state of @client as the state the server already has. */
+void mark_client_committed(XClient *client);
+
+/* Show the client on the X server once it is committed. */
 void map_client(XClient *client);
 
-/* Hide the client on the X server. */
+/* Hide the client on the X server once it is committed. */
 void unmap_client(XClient *client);
 
-/* Set the size of a window associated to the X server. */
+/* Set the size of a window associated to the X server once it is committed. */
 void configure_client(XClient *client, int32_t x, int32_t y, uint32_t width,
         uint32_t height, uint32_t border_width);
 
-/* Set the border color of @client. */
+/* Set the border color of @client once it is committed. */
 void change_client_attributes(XClient *client, uint32_t border_color);
 
-/* Initialize all properties within @window.
+/* Send the changes of @client to the server right away.
+ *
+ * This sends at most one request of each kind: ConfigureWindow with only the
+ * changed values, ChangeWindowAttributes and MapWindow or UnmapWindow. Use
+ * this before drawing on the client or focusing it.
+ */
+void commit_client(XClient *client);
+
+/* Drop the changes of @client without sending anything to the server.
+ *
+ * This is for clients whose window is already destroyed, any request would
+ * only cause a BadWindow error.
+ */
+void drop_client(XClient *client);
+
+/* Commit all clients with changes, this is done once per cycle. */
+void commit_clients(void);
+
+/* Set @property of @window to given value once the properties are flushed.
+ *
+ * The last value sent for each window and property is remembered and the
+ * property is only changed on the server when the bytes differ. @length is the
+ * number of elements of size @format.
+ */
+void set_property(xcb_window_t window, xcb_atom_t property, xcb_atom_t type,
+        uint8_t format, uint32_t length, const void *data);
+
+/* Remember that @property of @window has given value on the server.
+ *
+ * Use this when the value was read from the server so that the next
+ * `set_property()` is compared against it.
+ */
+void note_property(xcb_window_t window, xcb_atom_t property, xcb_atom_t type,
+        uint8_t format, uint32_t length, const void *data);
+
+/* Take note that @property of @window changed on the server.
+ *
+ * Call this for each PropertyNotify event before it is coalesced. The changes
+ * sent by fensterchef itself are told apart by counting them, any other change
+ * makes the remembered value stale so the next `set_property()` is sent again.
+ */
+void notice_property_change(xcb_window_t window, xcb_atom_t property);
+
+/* Forget all properties remembered for @window.
+ *
+ * Call this when @window is destroyed, this also drops unsent values.
+ */
+void forget_properties(xcb_window_t window);
+
+/* Send all properties whose value differs from the last sent value, this is
+ * done once per cycle.
+ */
+void flush_properties(void);
+
+/* Send the requests for all properties within @properties without waiting for
+ * any reply. Replies of these properties that are already within @wave are
+ * dropped.
+ *
+ * @wave must be zero initialized before it is used the first time.
+ */
+void request_window_properties(PropertyWave *wave, xcb_window_t window,
+        uint32_t properties);
+
+/* Check for replies of @wave without blocking.
+ *
+ * @return true when all replies were received.
+ */
+bool poll_window_properties(PropertyWave *wave);
+
+/* Wait for the replies of all requests within @wave. */
+void collect_window_properties(PropertyWave *wave);
+
+/* Free all replies within @wave and discard the replies that were not yet
+ * received.
+ */
+void clear_property_wave(PropertyWave *wave);
+
+/* Get the properties that need to be fetched again when @atom changes.
+ *
+ * @return 0 if the atom is not a property cached by fensterchef.
+ */
+uint32_t get_properties_of_atom(xcb_atom_t atom);
+
+/* Initialize all properties within @window using the replies within @wave,
+ * @wave must contain all window properties and is cleared afterwards.
  *
  * @return the mode the window should be in initially.
  */
-window_mode_t initialize_window_properties(Window *window);
+window_mode_t initialize_window_properties(Window *window, PropertyWave *wave);
 
 /* Update the property with @properties corresponding to given atom. */
 bool cache_window_property(Window *window, xcb_atom_t atom);
 
-/* Check if @properties includes @protocol. */
-bool supports_protocol(Window *window, xcb_atom_t protocol);
+/* Use @atoms as values of the X atoms instead of interning them, this is used
+ * to replay captured events with the atoms of the server they were captured
+ * on.
+ *
+ * @atoms has `ATOM_MAX` elements.
+ */
+void set_atoms(const xcb_atom_t *atoms);
+
+/* Get the atom constant of @atom, for example `WM_TAKE_FOCUS`.
+ *
+ * @return `ATOM_MAX` if the atom is not within `DEFINE_ALL_ATOMS`.
+ */
+uint32_t get_atom_id(xcb_atom_t atom);
+
+/* Check if @window supports the protocol with the atom constant @protocol. */
+bool supports_protocol(const Window *window, uint32_t protocol);
 
-/* Check if @properties includes @state. */
-bool has_state(Window *window, xcb_atom_t state);
+/* Check if @window has the state with the atom constant @state. */
+bool has_state(const Window *window, uint32_t state);
 
 /* Translate a string to a key symbol.
  *
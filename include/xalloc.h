@@ -3,6 +3,37 @@
 
 #include <stdlib.h>
 
+/* A pool of objects that all have the same size.
+ *
+ * The objects live in contiguous slabs that are never given back to the
+ * system, freed objects are put into a free list and handed out again by the
+ * next allocation.
+ */
+struct object_pool {
+    /* the name of the pool shown in the log */
+    const char *name;
+    /* the size of a single object */
+    size_t object_size;
+    /* how many objects a single slab holds */
+    size_t objects_per_slab;
+    /* the slabs of the pool */
+    char **slabs;
+    /* the number of slabs */
+    size_t number_of_slabs;
+    /* the number of objects currently in use */
+    size_t number_of_used_objects;
+    /* the first free object, the first bytes of each free object point to the
+     * next free object
+     */
+    void *first_free_object;
+};
+
+/* Initialize an object pool for objects of @type with a given @name. */
+#define OBJECT_POOL(name, type, objects_per_slab) { \
+    (name), sizeof(type) < sizeof(void*) ? sizeof(void*) : sizeof(type), \
+    (objects_per_slab), NULL, 0, 0, NULL \
+}
+
 /* Like `malloc()` but exit when the allocation fails. */
 void *xmalloc(size_t size);
 
@@ -27,5 +58,14 @@ char *xstrndup(const char *s, size_t n);
 /* Like `asprintf()` but exit on failure. */
 char *xasprintf(const char *fmt, ...);
 
+/* Get a zeroed object from @pool, this adds a new slab if the pool is full. */
+void *allocate_pool_object(struct object_pool *pool);
+
+/* Put @object back into @pool, @object may be NULL. */
+void free_pool_object(struct object_pool *pool, void *object);
+
+/* Log the occupancy of @pool. */
+void log_object_pool(const struct object_pool *pool);
+
 #endif
 
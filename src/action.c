@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <unistd.h>
 #include <string.h> // strcmp()
 #include <sys/wait.h> // wait()
@@ -6,10 +7,13 @@
 #include "configuration.h"
 #include "event.h"
 #include "fensterchef.h"
+#include "flight_recorder.h"
 #include "frame.h"
 #include "log.h"
 #include "monitor.h"
+#include "reactor.h"
 #include "stash_frame.h"
+#include "statistics.h"
 #include "tiling.h"
 #include "utility.h"
 #include "window_list.h"
@@ -55,6 +59,9 @@ static const struct {
     [ACTION_SHOW_MESSAGE_RUN] = { "SHOW-MESSAGE-RUN", PARSER_DATA_TYPE_STRING },
     [ACTION_RESIZE_BY] = { "RESIZE-BY", PARSER_DATA_TYPE_QUAD },
     [ACTION_QUIT] = { "QUIT", PARSER_DATA_TYPE_VOID },
+    [ACTION_DUMP_FLIGHT_RECORDER] = { "DUMP-FLIGHT-RECORDER", PARSER_DATA_TYPE_VOID },
+    [ACTION_SHOW_STATS] = { "SHOW-STATS", PARSER_DATA_TYPE_VOID },
+    [ACTION_RESET_STATS] = { "RESET-STATS", PARSER_DATA_TYPE_VOID },
 };
 
 /* Get the data type the action expects as parameter. */
@@ -124,12 +131,16 @@ static void run_shell(const char *shell)
             /* make a new session */
             if (setsid() == -1) {
                 /* TODO: when does this happen? */
-                exit(EXIT_FAILURE);
+                _exit(EXIT_FAILURE);
             }
             /* this code is executed in the grandchild process */
+            /* the signals blocked for the reactor would stay blocked */
+            restore_signal_mask();
             (void) execl("/bin/sh", "sh", "-c", shell, (char*) NULL);
-            /* this point is only reached if `execl()` failed */
-            exit(EXIT_FAILURE);
+            /* this point is only reached if `execl()` failed, `_exit()` skips
+             * the exit handlers of the parent like stopping the log writer
+             */
+            _exit(EXIT_FAILURE);
         } else {
             /* exit the child process */
             _exit(0);
@@ -143,12 +154,42 @@ static void run_shell(const char *shell)
 /* Run a shell and get the output. */
 static char *run_shell_and_get_output(const char *shell)
 {
+    int pipe_descriptors[2];
+    int child_process_id;
     FILE *process;
     char *line;
     size_t length, capacity;
 
-    process = popen(shell, "r");
+    /* this is `popen()` but with the signal mask restored in the child */
+    if (pipe(pipe_descriptors) == -1) {
+        return NULL;
+    }
+
+    child_process_id = fork();
+    if (child_process_id == -1) {
+        close(pipe_descriptors[0]);
+        close(pipe_descriptors[1]);
+        return NULL;
+    }
+
+    if (child_process_id == 0) {
+        /* this code is executed in the child */
+        restore_signal_mask();
+        close(pipe_descriptors[0]);
+        if (pipe_descriptors[1] != STDOUT_FILENO) {
+            (void) dup2(pipe_descriptors[1], STDOUT_FILENO);
+            close(pipe_descriptors[1]);
+        }
+        (void) execl("/bin/sh", "sh", "-c", shell, (char*) NULL);
+        /* this point is only reached if `execl()` failed */
+        _exit(EXIT_FAILURE);
+    }
+
+    close(pipe_descriptors[1]);
+    process = fdopen(pipe_descriptors[0], "r");
     if (process == NULL) {
+        close(pipe_descriptors[0]);
+        (void) waitpid(child_process_id, NULL, 0);
         return NULL;
     }
 
@@ -165,7 +206,9 @@ static char *run_shell_and_get_output(const char *shell)
         line[length++] = c;
     }
     line[length] = '\0';
-    pclose(process);
+    fclose(process);
+    /* wait until the child process exits */
+    (void) waitpid(child_process_id, NULL, 0);
     return line;
 }
 
@@ -290,7 +333,7 @@ static void move_to_frame(Frame *from, Frame *to, Monitor *monitor,
         replace_frame(from, to);
         if (saved_frame != NULL) {
             replace_frame(to, saved_frame);
-            free(saved_frame);
+            destroy_frame(saved_frame);
         }
     } else if (monitor != NULL) {
         Window *const window = get_window_covering_monitor(monitor);
@@ -486,6 +529,8 @@ void do_action(const Action *action, Window *window)
 {
     char *shell;
 
+    record_action(action, window);
+
     switch (action->code) {
     /* invalid action value */
     case ACTION_NULL:
@@ -697,6 +742,27 @@ void do_action(const Action *action, Window *window)
                 action->parameter.quad[3]);
         break;
 
+    /* write the flight recorder to its dump file */
+    case ACTION_DUMP_FLIGHT_RECORDER:
+        if (dump_flight_recorder() == OK) {
+            LOG("dumped flight recorder to %s\n",
+                    get_flight_recorder_path());
+        } else {
+            LOG_ERROR("could not dump flight recorder to %s: %s\n",
+                    get_flight_recorder_path(), strerror(errno));
+        }
+        break;
+
+    /* show how long handling events took */
+    case ACTION_SHOW_STATS:
+        show_latency_statistics();
+        break;
+
+    /* start measuring from scratch */
+    case ACTION_RESET_STATS:
+        reset_latency_statistics();
+        break;
+
     /* not a real action */
     case ACTION_MAX:
         break;
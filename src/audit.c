@@ -0,0 +1,228 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <xcb/xcbext.h> // xcb_poll_for_reply
+
+#include "audit.h"
+#include "log.h"
+#include "reactor.h"
+#include "utility.h"
+#include "x11_management.h"
+#include "xalloc.h"
+
+/* if the time spent waiting for replies is measured */
+bool is_auditing;
+
+/* when the reply wait that is measured right now started */
+uint64_t audit_start;
+
+/* the reply that was already there when it was polled */
+static void *audit_reply;
+
+/* a place in the code that waits for replies */
+typedef struct audit_site {
+    /* the source file and line of the wait */
+    const char *file;
+    int line;
+    /* the number of round trips since the last report */
+    uint64_t count;
+    /* the time blocked in nanoseconds since the last report */
+    uint64_t blocked;
+    /* the longest time blocked in a single round trip */
+    uint64_t maximum;
+    /* the number of replies that were already there */
+    uint64_t pipelined;
+} AuditSite;
+
+/* the collected round trips since the last report */
+static struct {
+    /* all call sites that waited for a reply */
+    AuditSite *sites;
+    /* the number of call sites */
+    uint32_t number_of_sites;
+
+    /* the round trips and time blocked within the current cycle */
+    uint32_t cycle_round_trips;
+    uint64_t cycle_blocked;
+
+    /* the number of cycles and how many of them waited for replies */
+    uint64_t cycles;
+    uint64_t blocked_cycles;
+    /* the round trips of all cycles */
+    uint64_t round_trips;
+    /* the waits that did not block because the reply was already there */
+    uint64_t pipelined;
+    /* the most round trips and time blocked within a single cycle */
+    uint32_t maximum_cycle_round_trips;
+    uint64_t maximum_cycle_blocked;
+
+    /* the timer that runs the report */
+    ReactorTimer *timer;
+} audit;
+
+/* Get the site of @file and @line, it is created if it does not exist yet. */
+static AuditSite *get_audit_site(const char *file, int line)
+{
+    AuditSite *site;
+
+    /* `__FILE__` is the same string for all sites in a file */
+    for (uint32_t i = 0; i < audit.number_of_sites; i++) {
+        site = &audit.sites[i];
+        if (site->line == line && site->file == file) {
+            return site;
+        }
+    }
+
+    audit.sites = xreallocarray(audit.sites, audit.number_of_sites + 1,
+            sizeof(*audit.sites));
+    site = &audit.sites[audit.number_of_sites++];
+    site->file = file;
+    site->line = line;
+    site->count = 0;
+    site->blocked = 0;
+    site->maximum = 0;
+    site->pipelined = 0;
+    return site;
+}
+
+/* Note the end of a reply wait that started with the last `begin_audit()`. */
+void note_audit(const char *file, int line)
+{
+    AuditSite *site;
+    uint64_t duration;
+
+    duration = get_latency_time() - audit_start;
+
+    site = get_audit_site(file, line);
+    site->count++;
+    site->blocked += duration;
+    site->maximum = MAX(site->maximum, duration);
+
+    audit.cycle_round_trips++;
+    audit.cycle_blocked += duration;
+}
+
+/* Check if the reply to the request with @sequence is already there. */
+bool poll_audit_reply(uint32_t sequence)
+{
+    return x_backend->poll_for_reply(sequence, &audit_reply);
+}
+
+/* Check if the reply to the xcb request with @sequence is already there. */
+bool poll_audit_xcb_reply(uint32_t sequence, xcb_generic_error_t **error)
+{
+    return xcb_poll_for_reply(connection, sequence, &audit_reply, error) != 0;
+}
+
+/* Note that the call site at @file and @line did not need to wait. */
+void *note_pipelined_audit(const char *file, int line)
+{
+    void *reply;
+
+    get_audit_site(file, line)->pipelined++;
+    audit.pipelined++;
+
+    reply = audit_reply;
+    audit_reply = NULL;
+    return reply;
+}
+
+/* Note that an event cycle ended. */
+void end_audit_cycle(void)
+{
+    if (!is_auditing) {
+        return;
+    }
+
+    audit.cycles++;
+    if (audit.cycle_round_trips > 0) {
+        audit.blocked_cycles++;
+        audit.round_trips += audit.cycle_round_trips;
+        audit.maximum_cycle_round_trips = MAX(audit.maximum_cycle_round_trips,
+                audit.cycle_round_trips);
+        audit.maximum_cycle_blocked = MAX(audit.maximum_cycle_blocked,
+                audit.cycle_blocked);
+    }
+    audit.cycle_round_trips = 0;
+    audit.cycle_blocked = 0;
+}
+
+/* Compare two sites by the time they blocked, the longer comes first. */
+static int compare_audit_sites(const void *a, const void *b)
+{
+    const AuditSite *const site_a = a;
+    const AuditSite *const site_b = b;
+
+    if (site_a->blocked != site_b->blocked) {
+        return site_a->blocked < site_b->blocked ? 1 : -1;
+    }
+    if (site_a->pipelined != site_b->pipelined) {
+        return site_a->pipelined < site_b->pipelined ? 1 : -1;
+    }
+    return 0;
+}
+
+/* Log the call sites that blocked the longest since the last report. */
+static void report_audit(void *data)
+{
+    uint32_t count;
+
+    (void) data;
+
+    set_timer(audit.timer, AUDIT_REPORT_INTERVAL);
+
+    if (audit.round_trips == 0 && audit.pipelined == 0) {
+        return;
+    }
+
+    LOG("%" PRIu64 " round trips in %" PRIu64 " of %" PRIu64 " cycles,"
+            " at most %" PRIu32 " taking %" PRIu64 "us in one cycle,"
+            " %" PRIu64 " replies were already there\n",
+            audit.round_trips, audit.blocked_cycles, audit.cycles,
+            audit.maximum_cycle_round_trips,
+            audit.maximum_cycle_blocked / 1000, audit.pipelined);
+
+    qsort(audit.sites, audit.number_of_sites, sizeof(*audit.sites),
+            compare_audit_sites);
+    count = MIN(audit.number_of_sites, (uint32_t) AUDIT_REPORT_SITES);
+    for (uint32_t i = 0; i < count; i++) {
+        if (audit.sites[i].count == 0 && audit.sites[i].pipelined == 0) {
+            break;
+        }
+        LOG("  %s:%d: %" PRIu64 " round trips blocking %" PRIu64 "us,"
+                " at most %" PRIu64 "us, %" PRIu64 " pipelined\n",
+                audit.sites[i].file, audit.sites[i].line,
+                audit.sites[i].count, audit.sites[i].blocked / 1000,
+                audit.sites[i].maximum / 1000, audit.sites[i].pipelined);
+    }
+
+    /* start the next interval from scratch but keep the sites */
+    for (uint32_t i = 0; i < audit.number_of_sites; i++) {
+        audit.sites[i].count = 0;
+        audit.sites[i].blocked = 0;
+        audit.sites[i].maximum = 0;
+        audit.sites[i].pipelined = 0;
+    }
+    audit.cycles = 0;
+    audit.blocked_cycles = 0;
+    audit.round_trips = 0;
+    audit.pipelined = 0;
+    audit.maximum_cycle_round_trips = 0;
+    audit.maximum_cycle_blocked = 0;
+}
+
+/* Start the timer that periodically reports the round trips. */
+int initialize_audit(void)
+{
+    if (!is_auditing) {
+        return OK;
+    }
+
+    audit.timer = create_timer(report_audit, NULL);
+    if (audit.timer == NULL) {
+        return ERROR;
+    }
+    set_timer(audit.timer, AUDIT_REPORT_INTERVAL);
+    return OK;
+}
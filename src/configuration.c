@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -106,6 +107,286 @@ void reload_user_configuration(void)
     free(path);
 }
 
+/* a passive grab of a key or button on the root window */
+struct grab {
+    /* the keycode or button index */
+    uint8_t code;
+    /* the modifiers the grab is for */
+    uint16_t modifiers;
+    /* the events to report for a button grab (unused for keys) */
+    uint16_t event_mask;
+    /* if the device is frozen until events are allowed again, this is only
+     * needed for transparent bindings which replay the event
+     */
+    bool is_synchronous;
+};
+
+/* a list of grabs sorted by code and modifiers */
+struct grab_list {
+    /* the grabs */
+    struct grab *grabs;
+    /* the number of grabs */
+    uint32_t length;
+    /* the number of allocated grabs */
+    uint32_t capacity;
+};
+
+/* the keys that are currently grabbed */
+static struct grab_list grabbed_keys;
+
+/* the buttons that are currently grabbed */
+static struct grab_list grabbed_buttons;
+
+/* a binding within a dispatch table */
+struct dispatch_entry {
+    /* the modifiers of the binding */
+    uint16_t modifiers;
+    /* the flags of the binding without `BINDING_FLAG_TRANSPARENT` */
+    uint16_t flags;
+    /* the index of the binding within the configuration */
+    uint32_t index;
+};
+
+/* bindings indexed by keycode or button index */
+struct dispatch_table {
+    /* the bindings of the code `c` are `entries[starts[c]]` up to
+     * `entries[starts[c + 1]]` in the order of the configuration
+     */
+    uint32_t starts[UINT8_MAX + 2];
+    /* all bindings sorted by their code */
+    struct dispatch_entry *entries;
+};
+
+/* the key bindings by keycode */
+static struct dispatch_table key_table;
+
+/* the button bindings by button index */
+static struct dispatch_table button_table;
+
+/* Fill @table with the @count given @entries, each entry belongs to the code
+ * at the same index in @codes.
+ */
+static void fill_dispatch_table(struct dispatch_table *table,
+        const uint8_t *codes, const struct dispatch_entry *entries,
+        uint32_t count)
+{
+    uint32_t positions[UINT8_MAX + 1];
+
+    /* count the bindings of each code */
+    memset(table->starts, 0, sizeof(table->starts));
+    for (uint32_t i = 0; i < count; i++) {
+        table->starts[codes[i] + 1]++;
+    }
+    for (uint32_t i = 1; i < SIZE(table->starts); i++) {
+        table->starts[i] += table->starts[i - 1];
+    }
+
+    /* put the entries in their place keeping their order */
+    memcpy(positions, table->starts, sizeof(positions));
+    RESIZE(table->entries, count);
+    for (uint32_t i = 0; i < count; i++) {
+        table->entries[positions[codes[i]]++] = entries[i];
+    }
+}
+
+/* Find the entry within @table for @code with @modifiers and @flags.
+ *
+ * @return NULL if there is no binding.
+ */
+static struct dispatch_entry *find_dispatch_entry(struct dispatch_table *table,
+        uint8_t code, uint16_t modifiers, uint16_t flags)
+{
+    struct dispatch_entry *entry;
+
+    flags &= ~BINDING_FLAG_TRANSPARENT;
+    for (uint32_t i = table->starts[code]; i < table->starts[code + 1]; i++) {
+        entry = &table->entries[i];
+        if (entry->modifiers == modifiers && entry->flags == flags) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Add a grab to the end of @list. */
+static void add_grab(struct grab_list *list, uint8_t code, uint16_t modifiers,
+        uint16_t event_mask, bool is_synchronous)
+{
+    struct grab *grab;
+
+    if (list->length == list->capacity) {
+        list->capacity = MAX(list->capacity * 2, 16);
+        RESIZE(list->grabs, list->capacity);
+    }
+    grab = &list->grabs[list->length++];
+    grab->code = code;
+    grab->modifiers = modifiers;
+    grab->event_mask = event_mask;
+    grab->is_synchronous = is_synchronous;
+}
+
+/* Add a grab to @list for @modifiers combined with every subset of
+ * @ignore_modifiers.
+ *
+ * This is done so that when the user has CAPS LOCK for example, it does not
+ * mess with the bindings.
+ */
+static void add_grabs_with_ignored(struct grab_list *list, uint8_t code,
+        uint16_t modifiers, uint16_t ignore_modifiers, uint16_t event_mask,
+        bool is_synchronous)
+{
+    uint16_t subset;
+
+    /* only the 8 real modifiers can be ignored */
+    ignore_modifiers &= 0xff;
+
+    /* go through all subsets by counting down within the bits of the mask */
+    subset = ignore_modifiers;
+    while (true) {
+        add_grab(list, code, (modifiers | subset), event_mask,
+                is_synchronous);
+        if (subset == 0) {
+            break;
+        }
+        subset = (subset - 1) & ignore_modifiers;
+    }
+}
+
+/* Compare two grabs by code and modifiers, used for sorting. */
+static int compare_grabs(const void *a, const void *b)
+{
+    const struct grab *const grab_a = a, *const grab_b = b;
+
+    if (grab_a->code != grab_b->code) {
+        return grab_a->code < grab_b->code ? -1 : 1;
+    }
+    if (grab_a->modifiers != grab_b->modifiers) {
+        return grab_a->modifiers < grab_b->modifiers ? -1 : 1;
+    }
+    return 0;
+}
+
+/* Sort @list and merge grabs with equal code and modifiers. */
+static void sort_grabs(struct grab_list *list)
+{
+    uint32_t length = 0;
+
+    if (list->length == 0) {
+        return;
+    }
+
+    qsort(list->grabs, list->length, sizeof(*list->grabs), compare_grabs);
+
+    for (uint32_t i = 1; i < list->length; i++) {
+        if (compare_grabs(&list->grabs[length], &list->grabs[i]) == 0) {
+            list->grabs[length].event_mask |= list->grabs[i].event_mask;
+            list->grabs[length].is_synchronous |= list->grabs[i].is_synchronous;
+        } else {
+            list->grabs[++length] = list->grabs[i];
+        }
+    }
+    list->length = length + 1;
+}
+
+/* Grab a button on the root window. */
+static void grab_button(const struct grab *grab)
+{
+    xcb_grab_button(connection,
+            1, /* 1 means we specify a window for grabbing */
+            screen->root, /* this is the window we grab the button for */
+            grab->event_mask,
+            /* SYNC means that pointer (mouse) events will be frozen until we
+             * issue a AllowEvents request, this is needed to replay the event
+             */
+            grab->is_synchronous ? XCB_GRAB_MODE_SYNC : XCB_GRAB_MODE_ASYNC,
+            /* do not freeze keyboard events */
+            XCB_GRAB_MODE_ASYNC,
+            XCB_NONE, /* no confinement of the pointer */
+            XCB_NONE, /* no change of cursor */
+            grab->code, grab->modifiers);
+}
+
+/* Release a button grab on the root window. */
+static void ungrab_button(const struct grab *grab)
+{
+    xcb_ungrab_button(connection, grab->code, screen->root, grab->modifiers);
+}
+
+/* Grab a key on the root window. */
+static void grab_key(const struct grab *grab)
+{
+    xcb_grab_key(connection,
+            1, /* 1 means we specify a window for grabbing */
+            screen->root, /* this is the window we grab the key for */
+            grab->modifiers, grab->code,
+            /* do not freeze pointer (mouse) events */
+            XCB_GRAB_MODE_ASYNC,
+            /* SYNC means that keyboard events will be frozen until we issue a
+             * AllowEvents request, this is needed to replay the event
+             */
+            grab->is_synchronous ? XCB_GRAB_MODE_SYNC : XCB_GRAB_MODE_ASYNC);
+}
+
+/* Release a key grab on the root window. */
+static void ungrab_key(const struct grab *grab)
+{
+    xcb_ungrab_key(connection, grab->code, screen->root, grab->modifiers);
+}
+
+/* Send the requests to get from the grabs in @current to the grabs in
+ * @wanted, both must be sorted. @current is then replaced by @wanted.
+ *
+ * @name is used for logging.
+ */
+static void update_grabs(struct grab_list *current, struct grab_list *wanted,
+        void (*grab)(const struct grab *grab),
+        void (*ungrab)(const struct grab *grab), const char *name)
+{
+    uint32_t i = 0, j = 0;
+    int comparison;
+    uint32_t grab_count = 0, ungrab_count = 0;
+
+    while (i < current->length || j < wanted->length) {
+        if (i == current->length) {
+            comparison = 1;
+        } else if (j == wanted->length) {
+            comparison = -1;
+        } else {
+            comparison = compare_grabs(&current->grabs[i], &wanted->grabs[j]);
+        }
+
+        if (comparison < 0) {
+            /* the grab is no longer wanted */
+            ungrab(&current->grabs[i]);
+            ungrab_count++;
+            i++;
+        } else if (comparison > 0) {
+            /* the grab is new */
+            grab(&wanted->grabs[j]);
+            grab_count++;
+            j++;
+        } else {
+            /* grabbing again replaces the existing grab */
+            if (current->grabs[i].event_mask != wanted->grabs[j].event_mask ||
+                    current->grabs[i].is_synchronous !=
+                        wanted->grabs[j].is_synchronous) {
+                grab(&wanted->grabs[j]);
+                grab_count++;
+            }
+            i++;
+            j++;
+        }
+    }
+
+    if (grab_count > 0 || ungrab_count > 0) {
+        LOG("grabbed %" PRIu32 " and ungrabbed %" PRIu32 " %s\n",
+                grab_count, ungrab_count, name);
+    }
+
+    free(current->grabs);
+    *current = *wanted;
+}
+
 /* Get a key from button modifiers and a button index. */
 struct configuration_button *find_configured_button(
         struct configuration *configuration,
@@ -131,48 +412,96 @@ struct configuration_button *find_configured_button(
     return NULL;
 }
 
+/* Check if the grab in @list for @code and @modifiers freezes the device.
+ *
+ * If there is no such grab, this returns true as the device might still be
+ * frozen.
+ */
+static bool is_grab_synchronous(const struct grab_list *list, uint8_t code,
+        uint16_t modifiers)
+{
+    struct grab key;
+    const struct grab *grab;
+
+    key.code = code;
+    key.modifiers = (modifiers & 0xff);
+    if (list->length == 0) {
+        return true;
+    }
+    grab = bsearch(&key, list->grabs, list->length, sizeof(*list->grabs),
+            compare_grabs);
+    return grab == NULL || grab->is_synchronous;
+}
+
+/* Check if the button grab for an event freezes the pointer. */
+bool is_button_grab_synchronous(xcb_button_t button_index, uint16_t modifiers)
+{
+    return is_grab_synchronous(&grabbed_buttons, button_index, modifiers);
+}
+
+/* Check if the key grab for an event freezes the keyboard. */
+bool is_key_grab_synchronous(xcb_keycode_t keycode, uint16_t modifiers)
+{
+    return is_grab_synchronous(&grabbed_keys, keycode, modifiers);
+}
+
+/* Get the button binding for a button event. */
+struct configuration_button *get_button_binding(xcb_button_t button_index,
+        uint16_t modifiers, uint16_t flags)
+{
+    struct dispatch_entry *entry;
+
+    /* remove the ignored modifiers but also ~0xff which is all the mouse button
+     * masks
+     */
+    modifiers &= ~(configuration.mouse.ignore_modifiers | ~0xff);
+    entry = find_dispatch_entry(&button_table, button_index, modifiers, flags);
+    if (entry == NULL) {
+        return NULL;
+    }
+    return &configuration.mouse.buttons[entry->index];
+}
+
 /* Grab the mousebindings so we receive MousePress/MouseRelease events for
  * them.
  */
 void grab_configured_buttons(void)
 {
-    xcb_window_t root;
+    struct grab_list wanted;
     struct configuration_button *button;
+    uint8_t *codes;
+    struct dispatch_entry *entries;
 
-    root = screen->root;
-
-    /* remove all previously grabbed buttons so that we can overwrite them */
-    xcb_ungrab_button(connection, XCB_GRAB_ANY, root, XCB_MOD_MASK_ANY);
+    codes = xreallocarray(NULL, configuration.mouse.number_of_buttons,
+            sizeof(*codes));
+    entries = xreallocarray(NULL, configuration.mouse.number_of_buttons,
+            sizeof(*entries));
 
+    memset(&wanted, 0, sizeof(wanted));
     for (uint32_t i = 0; i < configuration.mouse.number_of_buttons; i++) {
         button = &configuration.mouse.buttons[i];
-        /* use every possible combination of modifiers we do not care about
-         * so that when the user has CAPS LOCK for example, it does not mess
-         * with mousebindings
-         */
-        for (uint32_t j = 0; j < (uint32_t) (1 << 8); j++) {
-            /* check if @j has any outside modifiers */
-            if ((j | configuration.mouse.ignore_modifiers) !=
-                    configuration.mouse.ignore_modifiers) {
-                continue;
-            }
-
-            xcb_grab_button(connection,
-                    1, /* 1 means we specify a window for grabbing */
-                    root, /* this is the window we grab the button for */
-                    (button->flags & BINDING_FLAG_RELEASE) ?
-                    XCB_EVENT_MASK_BUTTON_RELEASE : XCB_EVENT_MASK_BUTTON_PRESS,
-                    /* SYNC means that pointer (mouse) events will be frozen
-                     * until we issue a AllowEvents request
-                     */
-                    XCB_GRAB_MODE_SYNC,
-                    /* do not freeze keyboard events */
-                    XCB_GRAB_MODE_ASYNC,
-                    XCB_NONE, /* no confinement of the pointer */
-                    XCB_NONE, /* no change of cursor */
-                    button->index, (j | button->modifiers));
-        }
+        add_grabs_with_ignored(&wanted, button->index, button->modifiers,
+                configuration.mouse.ignore_modifiers,
+                (button->flags & BINDING_FLAG_RELEASE) ?
+                XCB_EVENT_MASK_BUTTON_RELEASE : XCB_EVENT_MASK_BUTTON_PRESS,
+                (button->flags & BINDING_FLAG_TRANSPARENT));
+
+        codes[i] = button->index;
+        entries[i].modifiers = button->modifiers;
+        entries[i].flags = (button->flags & ~BINDING_FLAG_TRANSPARENT);
+        entries[i].index = i;
     }
+    sort_grabs(&wanted);
+
+    /* rebuild the table used to look up the button of an event */
+    fill_dispatch_table(&button_table, codes, entries,
+            configuration.mouse.number_of_buttons);
+    free(entries);
+    free(codes);
+
+    /* only send the grabs that changed */
+    update_grabs(&grabbed_buttons, &wanted, grab_button, ungrab_button,
+            "buttons");
 }
 
 /* Get a key from key modifiers and a key symbol. */
@@ -196,55 +525,74 @@ struct configuration_key *find_configured_key(
     return NULL;
 }
 
+/* Get the key binding for a key event. */
+struct configuration_key *get_key_binding(xcb_keycode_t keycode,
+        uint16_t modifiers, uint16_t flags)
+{
+    struct dispatch_entry *entry;
+
+    modifiers &= ~configuration.keyboard.ignore_modifiers;
+    entry = find_dispatch_entry(&key_table, keycode, modifiers, flags);
+    if (entry == NULL) {
+        return NULL;
+    }
+    return &configuration.keyboard.keys[entry->index];
+}
+
 /* Grab the keybindings so we receive the KeyPress/KeyRelease events for them.
  */
 void grab_configured_keys(void)
 {
-    xcb_window_t root;
+    struct grab_list wanted;
+    struct configuration_key *key;
     xcb_keycode_t *keycodes;
-    uint16_t modifiers;
-
-    root = screen->root;
-
-    /* remove all previously grabbed keys so that we can overwrite them */
-    xcb_ungrab_key(connection, XCB_GRAB_ANY, root, XCB_MOD_MASK_ANY);
+    uint8_t *codes = NULL;
+    struct dispatch_entry *entries = NULL;
+    uint32_t count = 0, capacity = 0;
 
+    memset(&wanted, 0, sizeof(wanted));
     for (uint32_t i = 0; i < configuration.keyboard.number_of_keys; i++) {
+        key = &configuration.keyboard.keys[i];
         /* go over all keycodes of a specific key symbol and grab them with
          * needed modifiers
          */
-        keycodes = get_keycodes(configuration.keyboard.keys[i].key_symbol);
+        keycodes = get_keycodes(key->key_symbol);
         if (keycodes == NULL) {
             continue;
         }
         for (uint32_t j = 0; keycodes[j] != XCB_NO_SYMBOL; j++) {
-            /* use every possible combination of modifiers we do not care about
-             * so that when the user has CAPS LOCK for example, it does not mess
-             * with keybindings.
-             */
-            for (uint32_t k = 0; k < (uint32_t) (1 << 8); k++) {
-                /* check if @k has any outside modifiers */
-                if ((k | configuration.keyboard.ignore_modifiers) !=
-                        configuration.keyboard.ignore_modifiers) {
-                    continue;
-                }
+            add_grabs_with_ignored(&wanted, keycodes[j], key->modifiers,
+                    configuration.keyboard.ignore_modifiers, 0,
+                    (key->flags & BINDING_FLAG_TRANSPARENT));
 
-                modifiers = (k | configuration.keyboard.keys[i].modifiers);
-
-                xcb_grab_key(connection,
-                        1, /* 1 means we specify a window for grabbing */
-                        root, /* this is the window we grab the key for */
-                        modifiers, keycodes[j],
-                        /* do not freeze pointer (mouse) events */
-                        XCB_GRAB_MODE_ASYNC,
-                        /* SYNC means that keyboard events will be frozen until
-                         * we issue a AllowEvents request
-                         */
-                        XCB_GRAB_MODE_SYNC);
+            /* the key symbol is only matched without any shift level, so only
+             * keycodes that produce it directly trigger the binding
+             */
+            if (get_keysym(keycodes[j]) != key->key_symbol) {
+                continue;
             }
+            if (count == capacity) {
+                capacity = MAX(capacity * 2, 16);
+                RESIZE(codes, capacity);
+                RESIZE(entries, capacity);
+            }
+            codes[count] = keycodes[j];
+            entries[count].modifiers = key->modifiers;
+            entries[count].flags = (key->flags & ~BINDING_FLAG_TRANSPARENT);
+            entries[count].index = i;
+            count++;
         }
         free(keycodes);
     }
+    sort_grabs(&wanted);
+
+    /* rebuild the table used to look up the key of an event */
+    fill_dispatch_table(&key_table, codes, entries, count);
+    free(entries);
+    free(codes);
+
+    /* only send the grabs that changed */
+    update_grabs(&grabbed_keys, &wanted, grab_key, ungrab_key, "keys");
 }
 
 /* Compare the current configuration with the new configuration and set it. */
@@ -269,6 +617,7 @@ void set_configuration(struct configuration *new_configuration)
             window->border_color = configuration.border.color;
         }
         window->border_size = configuration.border.size;
+        mark_window_dirty(window, WINDOW_DIRTY_BORDER);
     }
 
     /* reload all frames */
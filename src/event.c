@@ -1,21 +1,26 @@
 #include <inttypes.h>
 #include <signal.h>
 #include <string.h>
-#include <sys/select.h>
 #include <unistd.h>
 
 #include <xcb/randr.h>
 
+#include "audit.h"
 #include "configuration.h"
 #include "event.h"
+#include "event_capture.h"
 #include "fensterchef.h"
+#include "flight_recorder.h"
 #include "frame.h"
 #include "keymap.h"
 #include "log.h"
 #include "monitor.h"
+#include "reactor.h"
+#include "statistics.h"
 #include "tiling.h"
 #include "utility.h"
 #include "window.h"
+#include "window_adoption.h"
 #include "window_list.h"
 
 /* This file handles all kinds of X events.
@@ -31,8 +36,8 @@
 /* this is the first index of a randr event */
 uint8_t randr_event_base;
 
-/* signals whether the alarm signal was received */
-volatile sig_atomic_t has_timer_expired;
+/* the timer that hides the notification window */
+ReactorTimer *notification_timer;
 
 /* if the user requested to reload the configuration */
 bool is_reload_requested;
@@ -45,7 +50,7 @@ bool has_client_list_changed;
 /* this is used for moving/resizing a floating window */
 static struct {
     /* the window that is being moved */
-    Window *window;
+    WindowHandle window;
     /* how to move or resize the window */
     wm_move_resize_direction_t direction;
     /* initial position and size of the window */
@@ -54,26 +59,42 @@ static struct {
     Point start;
 } move_resize;
 
-/* Handle an incoming alarm. */
-static void alarm_handler(int signal)
+/* Hide the notification window once its time is over. */
+static void hide_notification(void *data)
 {
-    (void) signal;
-    has_timer_expired = true;
+    (void) data;
+    unmap_client(&notification);
 }
 
-/* Create a signal handler for `SIGALRM`. */
-int initialize_signal_handlers(void)
+/* Stop fensterchef gracefully when it is asked to terminate. */
+static void handle_termination_signal(int signal)
 {
-    struct sigaction action;
+    LOG("received signal %d, stopping\n", signal);
+    is_fensterchef_running = false;
+}
 
-    /* install the signal handler for the alarm signal, this is triggered when
-     * the alarm created by `alarm()` expires
+/* Register the X connection, signals and timers in the reactor. */
+int initialize_event_sources(void)
+{
+    if (initialize_reactor() != OK) {
+        return ERROR;
+    }
+
+    /* the events are read by `next_cycle()` after every wait, so no callback
+     * is needed, there is no file descriptor when replaying captured events
      */
-    memset(&action, 0, sizeof(action));
-    action.sa_handler = alarm_handler;
-    sigemptyset(&action.sa_mask);
-    if (sigaction(SIGALRM, &action, NULL) == -1) {
-        LOG_ERROR("could not create alarm handler\n");
+    if (x_file_descriptor >= 0 && register_file_descriptor(x_file_descriptor,
+                EPOLLIN, NULL, NULL) != OK) {
+        return ERROR;
+    }
+
+    if (register_signal(SIGINT, handle_termination_signal) != OK ||
+            register_signal(SIGTERM, handle_termination_signal) != OK) {
+        return ERROR;
+    }
+
+    notification_timer = create_timer(hide_notification, NULL);
+    if (notification_timer == NULL) {
         return ERROR;
     }
     return OK;
@@ -109,8 +130,7 @@ void synchronize_client_list(void)
         index++;
     }
     /* set the `_NET_CLIENT_LIST` property */
-    xcb_change_property(connection, XCB_PROP_MODE_REPLACE, screen->root,
-            ATOM(_NET_CLIENT_LIST), XCB_ATOM_WINDOW, 32,
+    set_property(screen->root, ATOM(_NET_CLIENT_LIST), XCB_ATOM_WINDOW, 32,
             number_of_windows, client_list.ids);
 
     index = 0;
@@ -120,34 +140,25 @@ void synchronize_client_list(void)
         index++;
     }
     /* set the `_NET_CLIENT_LIST_STACKING` property */
-    xcb_change_property(connection, XCB_PROP_MODE_REPLACE, screen->root,
-            ATOM(_NET_CLIENT_LIST_STACKING), XCB_ATOM_WINDOW, 32,
-            number_of_windows, client_list.ids);
+    set_property(screen->root, ATOM(_NET_CLIENT_LIST_STACKING),
+            XCB_ATOM_WINDOW, 32, number_of_windows, client_list.ids);
 }
 
-/* Synchronize the local data with the X server. */
-void synchronize_with_server(void)
+/* Recompute the struts of all monitors and the work area. Monitors whose strut
+ * changed are marked dirty.
+ */
+static void update_monitor_struts(void)
 {
-    /* the old work area */
-    static Rectangle workarea;
-
     Monitor *monitor;
+    uint32_t number_of_monitors = 0;
+    Extents *struts;
+    uint32_t index;
     Rectangle rectangle;
 
-    xcb_atom_t state_atom;
-
-    /**
-     * since the strut of a monitor might have changed because a window with
-     * strut got hidden or shown, we need to recompute those
-     **/
-
-    /* reset all struts before recomputing */
     for (monitor = first_monitor; monitor != NULL; monitor = monitor->next) {
-        monitor->strut.left = 0;
-        monitor->strut.top = 0;
-        monitor->strut.right = 0;
-        monitor->strut.bottom = 0;
+        number_of_monitors++;
     }
+    struts = xcalloc(number_of_monitors, sizeof(*struts));
 
     rectangle.x = 0;
     rectangle.y = 0;
@@ -155,16 +166,21 @@ void synchronize_with_server(void)
     rectangle.height = 0;
     /* recompute all struts */
     for (Window *window = first_window; window != NULL; window = window->next) {
-        if (!window->state.is_visible) {
+        if (!window->state.is_visible || is_strut_empty(&window->strut)) {
             continue;
         }
         monitor = get_monitor_from_rectangle_or_primary(window->x,
                 window->y, window->width, window->height);
 
-        monitor->strut.left += window->strut.reserved.left;
-        monitor->strut.top += window->strut.reserved.top;
-        monitor->strut.right += window->strut.reserved.right;
-        monitor->strut.bottom += window->strut.reserved.bottom;
+        index = 0;
+        for (Monitor *other = first_monitor; other != monitor;
+                other = other->next) {
+            index++;
+        }
+        struts[index].left += window->strut.reserved.left;
+        struts[index].top += window->strut.reserved.top;
+        struts[index].right += window->strut.reserved.right;
+        struts[index].bottom += window->strut.reserved.bottom;
 
         rectangle.x += window->strut.reserved.left;
         rectangle.y += window->strut.reserved.top;
@@ -172,21 +188,46 @@ void synchronize_with_server(void)
         rectangle.height += window->strut.reserved.bottom;
     }
 
-    /* set the work area if it changed */
+    /* set the struts of the monitors that changed */
+    index = 0;
+    for (monitor = first_monitor; monitor != NULL; monitor = monitor->next) {
+        if (memcmp(&monitor->strut, &struts[index],
+                    sizeof(monitor->strut)) != 0) {
+            monitor->strut = struts[index];
+            monitor->is_dirty = true;
+        }
+        index++;
+    }
+    free(struts);
+
+    /* set the work area, it is only sent if it changed */
     rectangle.width = screen->width_in_pixels - rectangle.x - rectangle.width;
     rectangle.height = screen->height_in_pixels - rectangle.y -
         rectangle.height;
-    if (rectangle.x != workarea.x ||
-            rectangle.y != workarea.y ||
-            rectangle.width != workarea.width ||
-            rectangle.height != workarea.height) {
-        workarea = rectangle;
-        xcb_change_property(connection, XCB_PROP_MODE_REPLACE, screen->root,
-                ATOM(_NET_WORKAREA), XCB_ATOM_CARDINAL, 32, 4, &workarea);
+    set_property(screen->root, ATOM(_NET_WORKAREA), XCB_ATOM_CARDINAL, 32, 4,
+            &rectangle);
+}
+
+/* Synchronize the local data with the X server. */
+void synchronize_with_server(void)
+{
+    Monitor *monitor;
+    Window *window;
+    uint32_t state;
+
+    /* since the strut of a monitor might have changed because a window with
+     * strut got hidden, shown or moved, we need to recompute those
+     */
+    if (are_monitor_struts_dirty) {
+        update_monitor_struts();
+        are_monitor_struts_dirty = false;
     }
 
-    /* resize all frames to their according size */
+    /* resize the frames of the monitors whose size or strut changed */
     for (monitor = first_monitor; monitor != NULL; monitor = monitor->next) {
+        if (!monitor->is_dirty) {
+            continue;
+        }
         resize_frame(monitor->frame,
                 monitor->x + monitor->strut.left,
                 monitor->y + monitor->strut.top,
@@ -194,94 +235,384 @@ void synchronize_with_server(void)
                     monitor->strut.left,
                 monitor->height - monitor->strut.bottom -
                     monitor->strut.top);
+        monitor->is_dirty = false;
     }
 
-    /* configure all visible windows and map them */
-    for (Window *window = top_window; window != NULL; window = window->below) {
-        if (!window->state.is_visible) {
-            continue;
-        }
-        place_window_in_bounds(window);
-        configure_client(&window->client, window->x, window->y,
-                window->width, window->height, window->border_size);
-        change_client_attributes(&window->client, window->border_color);
-        state_atom = ATOM(_NET_WM_STATE_HIDDEN);
-        remove_window_states(window, &state_atom, 1);
-        map_client(&window->client);
-    }
-
-    /* unmap all invisible windows */
-    for (Window *window = bottom_window; window != NULL;
-            window = window->above) {
-        if (!window->state.is_visible) {
-            state_atom = ATOM(_NET_WM_STATE_HIDDEN);
-            add_window_states(window, &state_atom, 1);
+    /* configure and map or unmap only the windows that changed */
+    while (first_dirty_window != NULL) {
+        window = first_dirty_window;
+        first_dirty_window = window->next_dirty;
+        window->next_dirty = NULL;
+        window->dirty = 0;
+
+        state = _NET_WM_STATE_HIDDEN;
+        if (window->state.is_visible) {
+            place_window_in_bounds(window);
+            configure_client(&window->client, window->x, window->y,
+                    window->width, window->height, window->border_size);
+            change_client_attributes(&window->client, window->border_color);
+            remove_window_states(window, &state, 1);
+            map_client(&window->client);
+        } else {
+            add_window_states(window, &state, 1);
             unmap_client(&window->client);
         }
     }
 }
 
-/* Run the next cycle of the event loop. */
-int next_cycle(void)
+/* the maximum number of events to look back at when coalescing an event */
+#define COALESCE_DISTANCE 64
+
+/* the events received within a single cycle */
+static struct {
+    /* the received events, coalesced events are set to NULL */
+    xcb_generic_event_t **events;
+    /* the number of events in `events` */
+    uint32_t length;
+    /* the number of allocated events */
+    uint32_t capacity;
+    /* the index after the last barrier, no event is coalesced across a
+     * barrier
+     */
+    uint32_t barrier;
+} event_buffer;
+
+/* Get the window an event is about.
+ *
+ * @return XCB_NONE if the event is not about a specific window.
+ */
+static xcb_window_t get_event_window(xcb_generic_event_t *event)
 {
-    int connection_error;
-    Window *old_focus_window;
+    switch (event->response_type & ~0x80) {
+    case XCB_UNMAP_NOTIFY:
+        return ((xcb_unmap_notify_event_t*) event)->window;
+    case XCB_MAP_REQUEST:
+        return ((xcb_map_request_event_t*) event)->window;
+    case XCB_DESTROY_NOTIFY:
+        return ((xcb_destroy_notify_event_t*) event)->window;
+    case XCB_PROPERTY_NOTIFY:
+        return ((xcb_property_notify_event_t*) event)->window;
+    case XCB_CONFIGURE_REQUEST:
+        return ((xcb_configure_request_event_t*) event)->window;
+    case XCB_CLIENT_MESSAGE:
+        return ((xcb_client_message_event_t*) event)->window;
+    }
+    return XCB_NONE;
+}
+
+/* Drop the event at given index within the event buffer. */
+static void drop_buffered_event(uint32_t index)
+{
+    free(event_buffer.events[index]);
+    event_buffer.events[index] = NULL;
+}
+
+/* Find the last event in the buffer that is about @window.
+ *
+ * When @skip_property is true, property notifications about other atoms than
+ * @atom are skipped over.
+ *
+ * @return the index of the event or `event_buffer.length` if there is none.
+ */
+static uint32_t find_buffered_window_event(xcb_window_t window,
+        bool skip_property, xcb_atom_t atom)
+{
+    uint32_t end;
     xcb_generic_event_t *event;
-    fd_set set;
 
-    connection_error = xcb_connection_has_error(connection);
-    if (!is_fensterchef_running || connection_error > 0) {
-        if (connection_error > 0) {
-            LOG_ERROR("connection error: %X\n", connection_error);
+    if (event_buffer.length - event_buffer.barrier > COALESCE_DISTANCE) {
+        end = event_buffer.length - COALESCE_DISTANCE;
+    } else {
+        end = event_buffer.barrier;
+    }
+
+    for (uint32_t i = event_buffer.length; i > end; i--) {
+        event = event_buffer.events[i - 1];
+        if (event == NULL || get_event_window(event) != window) {
+            continue;
         }
-        return ERROR;
+        if (skip_property &&
+                (event->response_type & ~0x80) == XCB_PROPERTY_NOTIFY &&
+                ((xcb_property_notify_event_t*) event)->atom != atom) {
+            continue;
+        }
+        return i - 1;
     }
+    return event_buffer.length;
+}
 
-    old_focus_window = focus_window;
+/* Merge the configure request @newer into @older.
+ *
+ * The values of @newer take precedence but @older keeps its position so the
+ * events are still handled in server order.
+ */
+static void merge_configure_requests(xcb_configure_request_event_t *older,
+        const xcb_configure_request_event_t *newer)
+{
+    const uint16_t mask = newer->value_mask;
 
-    /* prepare `set` for `select()` */
-    FD_ZERO(&set);
-    FD_SET(x_file_descriptor, &set);
+    if ((mask & XCB_CONFIG_WINDOW_X)) {
+        older->x = newer->x;
+    }
+    if ((mask & XCB_CONFIG_WINDOW_Y)) {
+        older->y = newer->y;
+    }
+    if ((mask & XCB_CONFIG_WINDOW_WIDTH)) {
+        older->width = newer->width;
+    }
+    if ((mask & XCB_CONFIG_WINDOW_HEIGHT)) {
+        older->height = newer->height;
+    }
+    if ((mask & XCB_CONFIG_WINDOW_BORDER_WIDTH)) {
+        older->border_width = newer->border_width;
+    }
+    if ((mask & XCB_CONFIG_WINDOW_SIBLING)) {
+        older->sibling = newer->sibling;
+    }
+    if ((mask & XCB_CONFIG_WINDOW_STACK_MODE)) {
+        older->stack_mode = newer->stack_mode;
+    }
+    older->value_mask |= mask;
+}
 
-    /* using select here is key: select will block until data on the file
-     * descriptor for the X connection arrives; when a signal is received,
-     * `select()` will however also unblock and return -1
-     */
-    if (select(x_file_descriptor + 1, &set, NULL, NULL, NULL) > 0) {
-        /* handle all received events */
-        while (event = xcb_poll_for_event(connection), event != NULL) {
-            handle_window_list_event(event);
+/* Put an event into the event buffer and coalesce it with earlier events.
+ *
+ * Only the last motion notification is kept, consecutive configure requests of
+ * the same window are merged and property notifications of the same window
+ * and atom are deduplicated. Key and button events are barriers, nothing is
+ * coalesced across them.
+ */
+void buffer_event(xcb_generic_event_t *event)
+{
+    uint8_t type;
+    uint32_t index;
+    xcb_configure_request_event_t *configure_request;
+    xcb_property_notify_event_t *property_notify;
 
-            handle_event(event);
+    /* capture the events as received so a replay also runs the coalescing */
+    capture_event(event);
+
+    type = (event->response_type & ~0x80);
 
-            if (is_reload_requested) {
-                reload_user_configuration();
-                is_reload_requested = false;
+    switch (type) {
+    /* only the last pointer position is relevant */
+    case XCB_MOTION_NOTIFY:
+        for (uint32_t i = event_buffer.length; i > event_buffer.barrier; i--) {
+            if (event_buffer.events[i - 1] != NULL &&
+                    (event_buffer.events[i - 1]->response_type & ~0x80) ==
+                        XCB_MOTION_NOTIFY) {
+                drop_buffered_event(i - 1);
+                break;
             }
+        }
+        break;
 
+    /* merge with the previous request if nothing else happened in between */
+    case XCB_CONFIGURE_REQUEST:
+        configure_request = (xcb_configure_request_event_t*) event;
+        index = find_buffered_window_event(configure_request->window,
+                false, XCB_NONE);
+        if (index < event_buffer.length &&
+                (event_buffer.events[index]->response_type & ~0x80) ==
+                    XCB_CONFIGURE_REQUEST) {
+            merge_configure_requests(
+                    (xcb_configure_request_event_t*) event_buffer.events[index],
+                    configure_request);
             free(event);
+            return;
         }
+        break;
 
-        synchronize_with_server();
-        /* update the client list properties */
-        if (has_client_list_changed) {
-            synchronize_client_list();
-            has_client_list_changed = false;
+    /* the property only needs to be read once */
+    case XCB_PROPERTY_NOTIFY:
+        property_notify = (xcb_property_notify_event_t*) event;
+        /* the client might have changed a property fensterchef also sets,
+         * this must see every change and not just the deduplicated ones
+         */
+        notice_property_change(property_notify->window,
+                property_notify->atom);
+        index = find_buffered_window_event(property_notify->window,
+                true, property_notify->atom);
+        if (index < event_buffer.length &&
+                (event_buffer.events[index]->response_type & ~0x80) ==
+                    XCB_PROPERTY_NOTIFY) {
+            drop_buffered_event(index);
         }
+        break;
+    }
+
+    if (event_buffer.length == event_buffer.capacity) {
+        event_buffer.capacity = MAX(event_buffer.capacity * 2, 32);
+        RESIZE(event_buffer.events, event_buffer.capacity);
+    }
+    event_buffer.events[event_buffer.length++] = event;
+
+    switch (type) {
+    case XCB_KEY_PRESS:
+    case XCB_KEY_RELEASE:
+    case XCB_BUTTON_PRESS:
+    case XCB_BUTTON_RELEASE:
+        event_buffer.barrier = event_buffer.length;
+        break;
+    }
+}
 
-        if (old_focus_window != focus_window) {
-            set_input_focus(focus_window);
+/* Take all queued events from the X connection and put them into the event
+ * buffer.
+ *
+ * @return the number of events in the event buffer.
+ */
+static uint32_t drain_events(void)
+{
+    xcb_generic_event_t *event;
+
+    while (event = x_backend->poll_for_event(), event != NULL) {
+        buffer_event(event);
+    }
+    return event_buffer.length;
+}
+
+/* Pass @event to all handlers of events. */
+void dispatch_event(xcb_generic_event_t *event)
+{
+    uint64_t start;
+
+    handle_window_list_event(event);
+    handle_adoption_event(event);
+
+    start = get_latency_time();
+    handle_event(event);
+    record_latency(LATENCY_EVENT + (event->response_type & ~0x80), start);
+
+    if (is_reload_requested) {
+        /* a replay must not depend on the configuration of the user */
+        if (!is_replaying_events) {
+            reload_user_configuration();
         }
+        is_reload_requested = false;
     }
+}
 
-    if (has_timer_expired) {
-        unmap_client(&notification);
-        has_timer_expired = false;
+/* Send all changes made while handling the events of a cycle to the server. */
+void finish_cycle(Window *old_focus_window)
+{
+    uint64_t start;
+
+    /* create the windows whose replies all arrived */
+    process_pending_adoptions();
+
+    start = get_latency_time();
+    synchronize_with_server();
+    record_latency(LATENCY_SYNCHRONIZE_WITH_SERVER, start);
+    /* update the client list properties */
+    if (has_client_list_changed) {
+        start = get_latency_time();
+        synchronize_client_list();
+        record_latency(LATENCY_SYNCHRONIZE_CLIENT_LIST, start);
+        has_client_list_changed = false;
+    }
+
+    /* send the geometry and visibility changes of all clients */
+    commit_clients();
+
+    if (old_focus_window != focus_window) {
+        set_input_focus(focus_window);
     }
 
+    /* send the properties that changed within this cycle */
+    flush_properties();
+
+#ifdef DEBUG
+    check_window_frames();
+#endif
+
+    capture_cycle_end();
+
     /* flush after every series of events so all changes are reflected */
-    xcb_flush(connection);
+    start = get_latency_time();
+    x_backend->flush();
+    record_latency(LATENCY_FLUSH, start);
+}
+
+/* Pass all events in the event buffer to the handlers and empty it. */
+void dispatch_buffered_events(void)
+{
+    xcb_generic_event_t *event;
+
+    capture_dispatch();
+
+    for (uint32_t i = 0; i < event_buffer.length; i++) {
+        event = event_buffer.events[i];
+        /* the event was coalesced into a later one */
+        if (event == NULL) {
+            continue;
+        }
+
+        dispatch_event(event);
+        free(event);
+    }
+    event_buffer.length = 0;
+    event_buffer.barrier = 0;
+}
+
+/* Handle all events the backend has queued and finish the cycle. */
+void run_cycle(Window *old_focus_window)
+{
+    uint64_t cycle_start;
+
+    /* all records of this cycle get the same time */
+    tick_flight_recorder();
+
+    /* the time spent waiting is not part of the cycle */
+    cycle_start = get_latency_time();
+
+    /* handle all received events, handling them might cause more events to
+     * be read from the connection, so repeat until none are left
+     */
+    while (drain_events() > 0) {
+        dispatch_buffered_events();
+    }
+
+    finish_cycle(old_focus_window);
 
+    record_latency(LATENCY_CYCLE, cycle_start);
+    end_audit_cycle();
+}
+
+/* Run the next cycle of the event loop. */
+int next_cycle(void)
+{
+    int connection_error;
+    Window *old_focus_window;
+    xcb_generic_event_t *event;
+
+    connection_error = xcb_connection_has_error(connection);
+    if (!is_fensterchef_running || connection_error > 0) {
+        if (connection_error > 0) {
+            LOG_ERROR("connection error: %X\n", connection_error);
+        }
+        return ERROR;
+    }
+
+    old_focus_window = focus_window;
+
+    /* events might have been read from the connection already while waiting
+     * for a reply, the file descriptor would not be readable for them so do
+     * not block in that case
+     */
+    event = xcb_poll_for_queued_event(connection);
+    if (event != NULL) {
+        buffer_event(event);
+    }
+
+    /* wait until the X connection or any other source is ready, this also
+     * runs the callbacks of signals and timers
+     */
+    if (wait_for_sources(event != NULL ? 0 : -1) != OK) {
+        return ERROR;
+    }
+
+    run_cycle(old_focus_window);
     return OK;
 }
 
@@ -297,7 +628,7 @@ void initiate_window_move_resize(Window *window,
     xcb_generic_error_t *error;
 
     /* check if no window is already being moved/resized */
-    if (move_resize.window != NULL) {
+    if (is_window_handle_set(move_resize.window)) {
         return;
     }
 
@@ -306,7 +637,8 @@ void initiate_window_move_resize(Window *window,
     /* get the mouse position if the caller does not supply it */
     if (start_x < 0) {
         query_cookie = xcb_query_pointer(connection, screen->root);
-        query = xcb_query_pointer_reply(connection, query_cookie, &error);
+        query = AUDIT(xcb_query_pointer_reply(connection, query_cookie,
+                    &error));
         if (query == NULL) {
             LOG_ERROR("could not query pointer: %E\n", error);
             free(error);
@@ -354,7 +686,7 @@ void initiate_window_move_resize(Window *window,
         }
     }
 
-    move_resize.window = window;
+    move_resize.window = get_window_handle(window);
     move_resize.direction = direction;
     move_resize.initial_geometry.x = window->x;
     move_resize.initial_geometry.y = window->y;
@@ -369,17 +701,17 @@ void initiate_window_move_resize(Window *window,
                 XCB_EVENT_MASK_BUTTON_MOTION,
             XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC, screen->root,
             XCB_NONE, XCB_CURRENT_TIME);
-    grab = xcb_grab_pointer_reply(connection, grab_cookie, &error);
+    grab = AUDIT(xcb_grab_pointer_reply(connection, grab_cookie, &error));
     if (grab == NULL) {
         LOG_ERROR("could not grab pointer: %E\n", error);
         free(error);
-        move_resize.window = NULL;
+        move_resize.window = NULL_WINDOW_HANDLE;
         return;
     }
     if (grab->status != XCB_GRAB_STATUS_SUCCESS) {
         LOG_ERROR("could not grab pointer\n");
         free(grab);
-        move_resize.window = NULL;
+        move_resize.window = NULL_WINDOW_HANDLE;
         return;
     }
     free(grab);
@@ -388,43 +720,46 @@ void initiate_window_move_resize(Window *window,
 /* Reset the position of the window being moved/resized. */
 static void cancel_window_move_resize(void)
 {
+    Window *window;
     Frame *frame;
 
     /* make sure a window is currently being moved/resized */
-    if (move_resize.window == NULL) {
+    if (!is_window_handle_set(move_resize.window)) {
         return;
     }
 
-    LOG("cancelling move/resize for %W\n", move_resize.window);
-
-    /* restore the old position and size as good as we can */
-    frame = get_frame_of_window(move_resize.window);
-    if (frame != NULL) {
-        bump_frame_edge(frame, FRAME_EDGE_LEFT,
-                move_resize.window->x -
-                    move_resize.initial_geometry.x);
-        bump_frame_edge(frame, FRAME_EDGE_TOP,
-                move_resize.window->y -
-                    move_resize.initial_geometry.y);
-        bump_frame_edge(frame, FRAME_EDGE_RIGHT,
-                (move_resize.initial_geometry.x +
-                 move_resize.initial_geometry.width) -
-                    (move_resize.window->x + move_resize.window->width));
-        bump_frame_edge(frame, FRAME_EDGE_BOTTOM,
-                (move_resize.initial_geometry.y +
-                 move_resize.initial_geometry.height) -
-                    (move_resize.window->y + move_resize.window->height));
-    } else {
-        set_window_size(move_resize.window,
-                move_resize.initial_geometry.x,
-                move_resize.initial_geometry.y,
-                move_resize.initial_geometry.width,
-                move_resize.initial_geometry.height);
+    /* the window might have been destroyed in the meantime */
+    window = get_window_of_handle(move_resize.window);
+    if (window != NULL) {
+        LOG("cancelling move/resize for %W\n", window);
+
+        /* restore the old position and size as good as we can */
+        frame = get_frame_of_window(window);
+        if (frame != NULL) {
+            bump_frame_edge(frame, FRAME_EDGE_LEFT,
+                    window->x - move_resize.initial_geometry.x);
+            bump_frame_edge(frame, FRAME_EDGE_TOP,
+                    window->y - move_resize.initial_geometry.y);
+            bump_frame_edge(frame, FRAME_EDGE_RIGHT,
+                    (move_resize.initial_geometry.x +
+                     move_resize.initial_geometry.width) -
+                        (window->x + window->width));
+            bump_frame_edge(frame, FRAME_EDGE_BOTTOM,
+                    (move_resize.initial_geometry.y +
+                     move_resize.initial_geometry.height) -
+                        (window->y + window->height));
+        } else {
+            set_window_size(window,
+                    move_resize.initial_geometry.x,
+                    move_resize.initial_geometry.y,
+                    move_resize.initial_geometry.width,
+                    move_resize.initial_geometry.height);
+        }
     }
 
     /* release mouse events back to the applications */
     xcb_ungrab_pointer(connection, XCB_CURRENT_TIME);
-    move_resize.window = NULL;
+    move_resize.window = NULL_WINDOW_HANDLE;
 }
 
 /* Key press events are sent when a grabbed key is pressed. */
@@ -432,8 +767,7 @@ static void handle_key_press(xcb_key_press_event_t *event)
 {
     struct configuration_key *key;
 
-    key = find_configured_key(&configuration, event->state,
-            get_keysym(event->detail), 0);
+    key = get_key_binding(event->detail, event->state, 0);
     if (key != NULL) {
         LOG("performing action(s): %A\n", key->number_of_actions,
                 key->actions);
@@ -454,8 +788,7 @@ static void handle_key_release(xcb_key_release_event_t *event)
 {
     struct configuration_key *key;
 
-    key = find_configured_key(&configuration, event->state,
-            get_keysym(event->detail), BINDING_FLAG_RELEASE);
+    key = get_key_binding(event->detail, event->state, BINDING_FLAG_RELEASE);
     if (key != NULL) {
         LOG("performing action(s): %A\n", key->number_of_actions,
                 key->actions);
@@ -477,7 +810,7 @@ static void handle_button_press(xcb_button_press_event_t *event)
     Window *window;
     struct configuration_button *button;
 
-    if (move_resize.window != NULL) {
+    if (is_window_handle_set(move_resize.window)) {
         cancel_window_move_resize();
         return;
     }
@@ -491,8 +824,7 @@ static void handle_button_press(xcb_button_press_event_t *event)
         }
     }
 
-    button = find_configured_button(&configuration, event->state,
-            event->detail, 0);
+    button = get_button_binding(event->detail, event->state, 0);
     if (button != NULL) {
         LOG("performing action(s): %A\n", button->number_of_actions,
                 button->actions);
@@ -522,14 +854,14 @@ static void handle_button_release(xcb_button_release_event_t *event)
         }
     }
 
-    if (move_resize.window != NULL) {
+    if (is_window_handle_set(move_resize.window)) {
         /* release mouse events back to the applications */
         xcb_ungrab_pointer(connection, XCB_CURRENT_TIME);
-        move_resize.window = NULL;
+        move_resize.window = NULL_WINDOW_HANDLE;
     }
 
-    button = find_configured_button(&configuration, event->state,
-            event->detail, BINDING_FLAG_RELEASE);
+    button = get_button_binding(event->detail, event->state,
+            BINDING_FLAG_RELEASE);
     if (button != NULL) {
         LOG("performing action(s): %A\n", button->number_of_actions,
                 button->actions);
@@ -553,17 +885,24 @@ static void handle_motion_notify(xcb_motion_notify_event_t *event)
     Size minimum, maximum;
     int32_t delta_x, delta_y;
     int32_t left_delta, top_delta, right_delta, bottom_delta;
+    Window *window;
     Frame *frame;
 
-    if (move_resize.window == NULL) {
+    if (!is_window_handle_set(move_resize.window)) {
         LOG_ERROR("receiving motion events without a window to move?\n");
         return;
     }
 
+    /* the window might have been destroyed while moving it */
+    window = get_window_of_handle(move_resize.window);
+    if (window == NULL) {
+        return;
+    }
+
     new_geometry = move_resize.initial_geometry;
 
-    get_minimum_window_size(move_resize.window, &minimum);
-    get_maximum_window_size(move_resize.window, &maximum);
+    get_minimum_window_size(window, &minimum);
+    get_maximum_window_size(window, &maximum);
 
     delta_x = move_resize.start.x - event->root_x;
     delta_y = move_resize.start.y - event->root_y;
@@ -663,20 +1002,20 @@ static void handle_motion_notify(xcb_motion_notify_event_t *event)
         break;
     }
 
-    frame = get_frame_of_window(move_resize.window);
+    frame = get_frame_of_window(window);
     if (frame != NULL) {
         bump_frame_edge(frame, FRAME_EDGE_LEFT,
-                move_resize.window->x - new_geometry.x);
+                window->x - new_geometry.x);
         bump_frame_edge(frame, FRAME_EDGE_TOP,
-                move_resize.window->y - new_geometry.y);
+                window->y - new_geometry.y);
         bump_frame_edge(frame, FRAME_EDGE_RIGHT,
                 (new_geometry.x + new_geometry.width) -
-                (move_resize.window->x + move_resize.window->width));
+                (window->x + window->width));
         bump_frame_edge(frame, FRAME_EDGE_BOTTOM,
                 (new_geometry.y + new_geometry.height) -
-                (move_resize.window->y + move_resize.window->height));
+                (window->y + window->height));
     } else {
-        set_window_size(move_resize.window,
+        set_window_size(window,
                 new_geometry.x,
                 new_geometry.y,
                 new_geometry.width,
@@ -696,13 +1035,15 @@ static void handle_unmap_notify(xcb_unmap_notify_event_t *event)
         return;
     }
 
+    /* the window is already hidden on the server */
     window->client.is_mapped = false;
+    window->client.committed.is_mapped = false;
 
     /* if the currently moved window is unmapped */
-    if (window == move_resize.window) {
+    if (window == get_window_of_handle(move_resize.window)) {
         /* release mouse events back to the applications */
         xcb_ungrab_pointer(connection, XCB_CURRENT_TIME);
-        move_resize.window = NULL;
+        move_resize.window = NULL_WINDOW_HANDLE;
     }
 
     hide_window(window);
@@ -717,10 +1058,9 @@ static void handle_map_request(xcb_map_request_event_t *event)
     Window *window;
 
     window = get_window_of_xcb_window(event->window);
+    /* the window gets shown once its adoption is done */
     if (window == NULL) {
-        window = create_window(event->window);
-    }
-    if (window == NULL) {
+        adopt_window(event->window, true);
         return;
     }
 
@@ -787,7 +1127,7 @@ static void handle_configure_request(xcb_configure_request_event_t *event)
     }
     /* ignore border width, stacking etc. */
 
-    xcb_configure_window(connection, event->window, mask, general_values);
+    x_backend->configure_window(event->window, mask, general_values);
 }
 
 /* Client messages are sent by a client to our window manager to request certain
@@ -897,6 +1237,11 @@ static void handle_screen_change(xcb_randr_screen_change_notify_event_t *event)
     screen->width_in_millimeters = event->mwidth;
     screen->height_in_millimeters = event->mheight;
     merge_monitors(query_monitors());
+
+    /* windows might be out of bounds now */
+    for (Window *window = first_window; window != NULL; window = window->next) {
+        mark_window_dirty(window, WINDOW_DIRTY_GEOMETRY);
+    }
 }
 
 /* Handle the given xcb event.
@@ -907,6 +1252,8 @@ void handle_event(xcb_generic_event_t *event)
 {
     uint8_t type;
 
+    record_event(event);
+
     /* remove the most significant bit, this gets the actual event type */
     type = (event->response_type & ~0x80);
 
@@ -931,36 +1278,52 @@ void handle_event(xcb_generic_event_t *event)
     case XCB_KEY_PRESS:
         handle_key_press((xcb_key_press_event_t*) event);
         /* continue processing keyboard events normally, we need to do this
-         * because we use SYNC when grabbing keys/buttons so that we can handle
-         * the events ourself but may also decide to replay it to the client it
-         * was actually meant for, the replaying is done within the handlers
+         * because we use SYNC when grabbing keys/buttons with transparent
+         * bindings so that we can handle the events ourself but may also
+         * decide to replay it to the client it was actually meant for, the
+         * replaying is done within the handlers
          */
-        xcb_allow_events(connection, XCB_ALLOW_ASYNC_KEYBOARD,
-                ((xcb_key_press_event_t*) event)->time);
+        if (is_key_grab_synchronous(((xcb_key_press_event_t*) event)->detail,
+                    ((xcb_key_press_event_t*) event)->state)) {
+            xcb_allow_events(connection, XCB_ALLOW_ASYNC_KEYBOARD,
+                    ((xcb_key_press_event_t*) event)->time);
+        }
         break;
 
     /* a key was released */
     case XCB_KEY_RELEASE:
         handle_key_release((xcb_key_release_event_t*) event);
         /* continue processing keyboard events normally */
-        xcb_allow_events(connection, XCB_ALLOW_ASYNC_KEYBOARD,
-                ((xcb_key_release_event_t*) event)->time);
+        if (is_key_grab_synchronous(
+                    ((xcb_key_release_event_t*) event)->detail,
+                    ((xcb_key_release_event_t*) event)->state)) {
+            xcb_allow_events(connection, XCB_ALLOW_ASYNC_KEYBOARD,
+                    ((xcb_key_release_event_t*) event)->time);
+        }
         break;
 
     /* a mouse button was pressed */
     case XCB_BUTTON_PRESS:
         handle_button_press((xcb_button_press_event_t*) event);
         /* continue processing pointer events normally */
-        xcb_allow_events(connection, XCB_ALLOW_ASYNC_POINTER,
-                ((xcb_button_press_event_t*) event)->time);
+        if (is_button_grab_synchronous(
+                    ((xcb_button_press_event_t*) event)->detail,
+                    ((xcb_button_press_event_t*) event)->state)) {
+            xcb_allow_events(connection, XCB_ALLOW_ASYNC_POINTER,
+                    ((xcb_button_press_event_t*) event)->time);
+        }
         break;
 
     /* a mouse button was released */
     case XCB_BUTTON_RELEASE:
         handle_button_release((xcb_button_release_event_t*) event);
         /* continue processing pointer events normally */
-        xcb_allow_events(connection, XCB_ALLOW_ASYNC_POINTER,
-                ((xcb_button_release_event_t*) event)->time);
+        if (is_button_grab_synchronous(
+                    ((xcb_button_release_event_t*) event)->detail,
+                    ((xcb_button_release_event_t*) event)->state)) {
+            xcb_allow_events(connection, XCB_ALLOW_ASYNC_POINTER,
+                    ((xcb_button_release_event_t*) event)->time);
+        }
         break;
 
     /* the mouse was moved */
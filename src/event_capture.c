@@ -0,0 +1,454 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audit.h"
+#include "configuration.h"
+#include "default_configuration.h"
+#include "event.h"
+#include "event_capture.h"
+#include "keymap.h"
+#include "log.h"
+#include "monitor.h"
+#include "statistics.h"
+#include "window.h"
+#include "window_adoption.h"
+#include "xalloc.h"
+
+/* the size of an event on the wire, `xcb_generic_event_t` has an additional
+ * `full_sequence` that is not captured
+ */
+#define CAPTURE_EVENT_SIZE 32
+
+/* the size of a reply without its additional data, `xcb_generic_reply_t`
+ * only covers the first 8 bytes
+ */
+#define CAPTURE_REPLY_SIZE 32
+
+/* the largest reply that is accepted when replaying */
+#define CAPTURE_MAXIMUM_REPLY_SIZE (16 << 20)
+
+/* the size of the buffer of the capture file */
+#define CAPTURE_BUFFER_SIZE (1 << 16)
+
+/* the most key symbols that are accepted when replaying, this fits 256
+ * keycodes with 255 symbols each
+ */
+#define CAPTURE_MAXIMUM_KEYSYMS (256 * 255)
+
+/* the file to capture events into */
+const char *event_capture_path;
+
+/* the file to replay events from */
+const char *event_replay_path;
+
+/* if events are being replayed right now */
+bool is_replaying_events;
+
+/* the open capture */
+static struct {
+    /* the file the records are written to, NULL if not capturing */
+    FILE *file;
+    /* if any event was captured since the last cycle mark */
+    bool has_events;
+    /* the number of captured events */
+    uint64_t number_of_events;
+} capture;
+
+/* Close the capture file. */
+static void stop_event_capture(void)
+{
+    if (capture.file == NULL) {
+        return;
+    }
+
+    if (fclose(capture.file) != 0) {
+        LOG_ERROR("could not write event capture %s: %s\n",
+                event_capture_path, strerror(errno));
+    } else {
+        LOG("captured %" PRIu64 " events into %s\n",
+                capture.number_of_events, event_capture_path);
+    }
+    capture.file = NULL;
+}
+
+/* Get the keyboard mapping of the server.
+ *
+ * @return NULL if the server did not reply.
+ */
+static xcb_get_keyboard_mapping_reply_t *get_keyboard_mapping(void)
+{
+    const xcb_setup_t *setup;
+    xcb_get_keyboard_mapping_cookie_t cookie;
+    xcb_get_keyboard_mapping_reply_t *mapping;
+    xcb_generic_error_t *error;
+
+    setup = xcb_get_setup(connection);
+    cookie = xcb_get_keyboard_mapping(connection, setup->min_keycode,
+            setup->max_keycode - setup->min_keycode + 1);
+    mapping = AUDIT(xcb_get_keyboard_mapping_reply(connection, cookie,
+                &error));
+    if (mapping == NULL) {
+        LOG_ERROR("could not get the keyboard mapping: %E\n", error);
+        free(error);
+        return NULL;
+    }
+    return mapping;
+}
+
+/* Open the capture file and write the header if a capture was requested. */
+int initialize_event_capture(void)
+{
+    EventCaptureHeader header;
+    xcb_atom_t atoms[ATOM_MAX];
+    xcb_get_keyboard_mapping_reply_t *mapping;
+
+    if (event_capture_path == NULL) {
+        return OK;
+    }
+
+    /* without the keyboard mapping, a replay would not know the keys */
+    mapping = get_keyboard_mapping();
+    if (mapping == NULL) {
+        return ERROR;
+    }
+
+    capture.file = fopen(event_capture_path, "wb");
+    if (capture.file == NULL) {
+        LOG_ERROR("could not open event capture %s: %s\n",
+                event_capture_path, strerror(errno));
+        free(mapping);
+        return ERROR;
+    }
+    setvbuf(capture.file, NULL, _IOFBF, CAPTURE_BUFFER_SIZE);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EVENT_CAPTURE_MAGIC, sizeof(header.magic));
+    header.version = EVENT_CAPTURE_VERSION;
+    header.number_of_atoms = ATOM_MAX;
+    header.randr_event_base = randr_event_base;
+    header.root = screen->root;
+    header.root_visual = screen->root_visual;
+    header.width = screen->width_in_pixels;
+    header.height = screen->height_in_pixels;
+    header.root_depth = screen->root_depth;
+    header.min_keycode = xcb_get_setup(connection)->min_keycode;
+    header.keysyms_per_keycode = mapping->keysyms_per_keycode;
+    header.number_of_keysyms = xcb_get_keyboard_mapping_keysyms_length(mapping);
+    fwrite(&header, sizeof(header), 1, capture.file);
+
+    for (uint32_t i = 0; i < ATOM_MAX; i++) {
+        atoms[i] = x_atoms[i].atom;
+    }
+    fwrite(atoms, sizeof(atoms), 1, capture.file);
+
+    fwrite(xcb_get_keyboard_mapping_keysyms(mapping), sizeof(xcb_keysym_t),
+            header.number_of_keysyms, capture.file);
+    free(mapping);
+
+    atexit(stop_event_capture);
+
+    LOG("capturing events into %s\n", event_capture_path);
+    return OK;
+}
+
+/* Add @event to the capture. */
+void capture_event(const xcb_generic_event_t *event)
+{
+    if (capture.file == NULL) {
+        return;
+    }
+
+    putc(CAPTURE_RECORD_EVENT, capture.file);
+    fwrite(event, CAPTURE_EVENT_SIZE, 1, capture.file);
+    capture.has_events = true;
+    capture.number_of_events++;
+}
+
+/* Mark that the buffered events are dispatched in the capture. */
+void capture_dispatch(void)
+{
+    if (capture.file == NULL) {
+        return;
+    }
+
+    putc(CAPTURE_RECORD_DISPATCH, capture.file);
+}
+
+/* Mark the end of a cycle in the capture. */
+void capture_cycle_end(void)
+{
+    /* cycles without events are not interesting for a replay */
+    if (capture.file == NULL || !capture.has_events) {
+        return;
+    }
+
+    putc(CAPTURE_RECORD_CYCLE, capture.file);
+    capture.has_events = false;
+}
+
+/* Write @reply with its size, @reply may be NULL. */
+static void write_reply(const void *reply)
+{
+    uint32_t size = 0;
+
+    if (reply != NULL) {
+        size = CAPTURE_REPLY_SIZE +
+            ((const xcb_generic_reply_t*) reply)->length * 4;
+    }
+    fwrite(&size, sizeof(size), 1, capture.file);
+    if (size > 0) {
+        fwrite(reply, size, 1, capture.file);
+    }
+}
+
+/* Add the replies @xcb_window is adopted with to the capture. */
+void capture_adoption(xcb_window_t xcb_window, bool is_map_requested,
+        const xcb_get_window_attributes_reply_t *attributes,
+        const xcb_get_geometry_reply_t *geometry, const PropertyWave *wave)
+{
+    CaptureAdoption adoption;
+
+    if (capture.file == NULL) {
+        return;
+    }
+
+    memset(&adoption, 0, sizeof(adoption));
+    adoption.window = xcb_window;
+    adoption.is_map_requested = is_map_requested;
+    adoption.properties = wave->properties;
+
+    putc(CAPTURE_RECORD_ADOPTION, capture.file);
+    fwrite(&adoption, sizeof(adoption), 1, capture.file);
+    write_reply(attributes);
+    write_reply(geometry);
+    for (window_property_t i = 0; i < WINDOW_PROPERTY_MAX; i++) {
+        if ((wave->properties & WINDOW_PROPERTY_BIT(i))) {
+            write_reply(wave->replies[i]);
+        }
+    }
+}
+
+/* Read a reply written by `write_reply()`.
+ *
+ * @return ERROR if the reply is cut off or malformed.
+ */
+static int read_reply(FILE *file, void **reply)
+{
+    uint32_t size;
+    xcb_generic_reply_t *generic_reply;
+
+    *reply = NULL;
+    if (fread(&size, sizeof(size), 1, file) != 1) {
+        return ERROR;
+    }
+    if (size == 0) {
+        return OK;
+    }
+    if (size < CAPTURE_REPLY_SIZE || size > CAPTURE_MAXIMUM_REPLY_SIZE) {
+        return ERROR;
+    }
+
+    generic_reply = xmalloc(size);
+    if (fread(generic_reply, size, 1, file) != 1 ||
+            CAPTURE_REPLY_SIZE + generic_reply->length * 4 != size) {
+        free(generic_reply);
+        return ERROR;
+    }
+    *reply = generic_reply;
+    return OK;
+}
+
+/* Read an adoption record and adopt its window.
+ *
+ * @return ERROR if the record is cut off or malformed.
+ */
+static int replay_adoption(FILE *file)
+{
+    CaptureAdoption adoption;
+    void *attributes = NULL, *geometry = NULL;
+    void *reply;
+    PropertyWave wave;
+    int result = OK;
+
+    if (fread(&adoption, sizeof(adoption), 1, file) != 1 ||
+            (adoption.properties & ~WINDOW_PROPERTY_ALL) != 0) {
+        return ERROR;
+    }
+
+    memset(&wave, 0, sizeof(wave));
+    wave.window = adoption.window;
+    wave.properties = adoption.properties;
+    /* all replies are there so nothing is discarded when clearing */
+    wave.received = adoption.properties;
+
+    if (read_reply(file, &attributes) != OK ||
+            read_reply(file, &geometry) != OK) {
+        result = ERROR;
+    }
+    for (window_property_t i = 0; result == OK && i < WINDOW_PROPERTY_MAX;
+            i++) {
+        if ((adoption.properties & WINDOW_PROPERTY_BIT(i))) {
+            result = read_reply(file, &reply);
+            wave.replies[i] = reply;
+        }
+    }
+
+    if (result == OK) {
+        finish_window_adoption(adoption.window, adoption.is_map_requested,
+                attributes, geometry, &wave);
+    }
+
+    clear_property_wave(&wave);
+    free(geometry);
+    free(attributes);
+    return result;
+}
+
+/* Read the header and atoms of a capture and set up fensterchef without a
+ * server.
+ *
+ * @return ERROR if the file is not an event capture of this version.
+ */
+static int set_up_replay(FILE *file)
+{
+    static xcb_screen_t replay_screen;
+
+    EventCaptureHeader header;
+    xcb_atom_t atoms[ATOM_MAX];
+    xcb_keysym_t *keysyms;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+            memcmp(header.magic, EVENT_CAPTURE_MAGIC,
+                sizeof(header.magic)) != 0 ||
+            header.version != EVENT_CAPTURE_VERSION ||
+            header.number_of_atoms != ATOM_MAX ||
+            header.number_of_keysyms > CAPTURE_MAXIMUM_KEYSYMS ||
+            fread(atoms, sizeof(atoms), 1, file) != 1) {
+        return ERROR;
+    }
+
+    keysyms = xmalloc(sizeof(*keysyms) * MAX(header.number_of_keysyms, 1));
+    if (fread(keysyms, sizeof(*keysyms), header.number_of_keysyms, file) !=
+            header.number_of_keysyms) {
+        free(keysyms);
+        return ERROR;
+    }
+    /* the bindings are resolved with this when the configuration is loaded */
+    set_keymap(header.min_keycode, header.keysyms_per_keycode, keysyms,
+            header.number_of_keysyms);
+    free(keysyms);
+
+    /* connecting to an invalid file descriptor gives a connection in error
+     * state, xcb drops all requests on it and all replies are NULL
+     */
+    connection = xcb_connect_to_fd(-1, NULL);
+    x_file_descriptor = -1;
+
+    replay_screen.root = header.root;
+    replay_screen.root_visual = header.root_visual;
+    replay_screen.width_in_pixels = header.width;
+    replay_screen.height_in_pixels = header.height;
+    replay_screen.root_depth = header.root_depth;
+    screen = &replay_screen;
+
+    set_atoms(atoms);
+    randr_event_base = header.randr_event_base;
+
+    is_replaying_events = true;
+    return OK;
+}
+
+/* Replay the capture at @path through the event handlers. */
+int replay_events(const char *path)
+{
+    FILE *file;
+    int type;
+    xcb_generic_event_t *event;
+    Window *old_focus_window;
+    uint64_t number_of_events = 0, number_of_cycles = 0;
+    uint64_t start, duration;
+    int result = OK;
+
+    file = fopen(path, "rb");
+    if (file == NULL) {
+        LOG_ERROR("could not open event capture %s: %s\n",
+                path, strerror(errno));
+        return ERROR;
+    }
+    setvbuf(file, NULL, _IOFBF, CAPTURE_BUFFER_SIZE);
+
+    if (set_up_replay(file) != OK) {
+        LOG_ERROR("%s is not an event capture of this version\n", path);
+        fclose(file);
+        return ERROR;
+    }
+
+    if (initialize_event_sources() != OK) {
+        fclose(file);
+        return ERROR;
+    }
+
+    /* the monitor layout is not captured, a single monitor covers the
+     * screen
+     */
+    merge_monitors(NULL);
+    initialize_root_properties();
+    /* the user configuration would make the replay differ between machines */
+    load_default_configuration();
+
+    /* only measure the handlers from now on */
+    reset_latency_statistics();
+
+    start = get_latency_time();
+    old_focus_window = focus_window;
+    while (result == OK && (type = getc(file)) != EOF) {
+        switch (type) {
+        case CAPTURE_RECORD_EVENT:
+            event = xcalloc(1, sizeof(*event));
+            if (fread(event, CAPTURE_EVENT_SIZE, 1, file) != 1) {
+                free(event);
+                result = ERROR;
+                break;
+            }
+            buffer_event(event);
+            number_of_events++;
+            break;
+
+        case CAPTURE_RECORD_DISPATCH:
+            dispatch_buffered_events();
+            break;
+
+        case CAPTURE_RECORD_CYCLE:
+            finish_cycle(old_focus_window);
+            old_focus_window = focus_window;
+            number_of_cycles++;
+            break;
+
+        case CAPTURE_RECORD_ADOPTION:
+            result = replay_adoption(file);
+            break;
+
+        default:
+            result = ERROR;
+            break;
+        }
+    }
+    duration = get_latency_time() - start;
+
+    if (result != OK) {
+        LOG_ERROR("%s is cut off or malformed after %" PRIu64 " events\n",
+                path, number_of_events);
+    }
+
+    LOG("replayed %" PRIu64 " events in %" PRIu64 " cycles in"
+                " %" PRIu64 ".%03" PRIu64 " ms\n",
+            number_of_events, number_of_cycles,
+            duration / 1000000, duration / 1000 % 1000);
+    log_latency_statistics();
+
+    fclose(file);
+    return result;
+}
@@ -0,0 +1,1257 @@
+#include <inttypes.h>
+#include <string.h>
+
+#include <xcb/xcb_event.h>
+
+#include "fake_server.h"
+#include "log.h"
+#include "utility.h"
+#include "xalloc.h"
+
+/* the visual of the root window of the fake server */
+#define FAKE_ROOT_VISUAL 0x21
+
+/* the depth of the root window of the fake server */
+#define FAKE_ROOT_DEPTH 24
+
+/* the number of major opcodes of the core protocol */
+#define FAKE_REQUEST_KINDS 128
+
+/* the response type of a reply */
+#define FAKE_REPLY 1
+
+/* the size of a reply without its additional data */
+#define FAKE_REPLY_SIZE 32
+
+/* a property of a fake window */
+struct fake_property {
+    /* the property atom */
+    xcb_atom_t atom;
+    /* the type of the value */
+    xcb_atom_t type;
+    /* the size of the elements in bits */
+    uint8_t format;
+    /* the number of elements */
+    uint32_t length;
+    /* the bytes of the value */
+    char *data;
+    /* the next property of the same window */
+    struct fake_property *next;
+};
+
+/* a window of the fake server */
+struct fake_window {
+    /* if the window was created and is not destroyed yet */
+    bool exists;
+    /* if the window is mapped */
+    bool is_mapped;
+    /* if the window manager should not tamper with the window */
+    bool is_override_redirect;
+    /* InputOutput or InputOnly */
+    uint16_t window_class;
+    /* the geometry of the window */
+    int32_t x;
+    int32_t y;
+    uint32_t width;
+    uint32_t height;
+    uint32_t border_width;
+    /* the color of the border */
+    uint32_t border_pixel;
+    /* the events fensterchef selected on the window */
+    uint32_t event_mask;
+    /* the properties of the window */
+    struct fake_property *properties;
+    /* the windows directly above and below within the stacking order of the
+     * children of the root, `XCB_NONE` at the ends
+     */
+    xcb_window_t above;
+    xcb_window_t below;
+};
+
+/* a reply of the fake server */
+struct fake_reply {
+    /* the sequence number of the request */
+    uint32_t sequence;
+    /* the reply, NULL on error */
+    void *reply;
+    /* if the reply was taken or discarded */
+    bool is_taken;
+};
+
+/* the state of the fake server */
+static struct {
+    /* the screen with the root window */
+    xcb_screen_t screen;
+    /* all windows indexed by their identifier minus `FAKE_ROOT_WINDOW` */
+    struct fake_window *windows;
+    /* the number of given out window identifiers */
+    uint32_t number_of_windows;
+    /* the number of allocated windows */
+    uint32_t windows_capacity;
+    /* the bottom and top child of the root */
+    xcb_window_t bottom;
+    xcb_window_t top;
+    /* the window with the input focus */
+    xcb_window_t focus;
+    /* the sequence number of the last request of fensterchef */
+    uint32_t sequence;
+    /* the replies ordered by their sequence number, all replies before
+     * `first_reply` are taken
+     */
+    struct fake_reply *replies;
+    /* the first reply that might not be taken yet */
+    uint32_t first_reply;
+    /* the number of replies */
+    uint32_t number_of_replies;
+    /* the number of allocated replies */
+    uint32_t replies_capacity;
+    /* the queued events, a ring buffer whose capacity is a power of two */
+    xcb_generic_event_t **events;
+    /* the index of the first queued event */
+    uint32_t first_event;
+    /* the number of queued events */
+    uint32_t number_of_events;
+    /* the number of allocated events */
+    uint32_t events_capacity;
+    /* the number of requests of each major opcode */
+    uint64_t requests[FAKE_REQUEST_KINDS];
+} fake;
+
+/* Get the fake window with the identifier @window.
+ *
+ * @return NULL if the window does not exist.
+ */
+static struct fake_window *get_fake_window(xcb_window_t window)
+{
+    uint32_t index;
+
+    if (window < FAKE_ROOT_WINDOW) {
+        return NULL;
+    }
+    index = window - FAKE_ROOT_WINDOW;
+    if (index >= fake.number_of_windows || !fake.windows[index].exists) {
+        return NULL;
+    }
+    return &fake.windows[index];
+}
+
+/* Count a request of fensterchef with @major_opcode. */
+static inline void count_request(uint8_t major_opcode)
+{
+    fake.sequence++;
+    fake.requests[major_opcode]++;
+}
+
+/* Double the capacity of the event queue. */
+static void grow_event_queue(void)
+{
+    xcb_generic_event_t **events;
+    uint32_t capacity;
+
+    capacity = MAX(fake.events_capacity * 2, 64);
+    events = xreallocarray(NULL, capacity, sizeof(*events));
+    /* unwrap the ring buffer */
+    for (uint32_t i = 0; i < fake.number_of_events; i++) {
+        events[i] = fake.events[(fake.first_event + i) &
+            (fake.events_capacity - 1)];
+    }
+    free(fake.events);
+    fake.events = events;
+    fake.events_capacity = capacity;
+    fake.first_event = 0;
+}
+
+/* Put a new event with @response_type at the end of the event queue.
+ *
+ * @return the zeroed event to fill in.
+ */
+static void *queue_event(uint8_t response_type)
+{
+    xcb_generic_event_t *event;
+    uint32_t index;
+
+    if (fake.number_of_events == fake.events_capacity) {
+        grow_event_queue();
+    }
+
+    event = xcalloc(1, sizeof(*event));
+    event->response_type = response_type;
+    event->sequence = fake.sequence;
+    event->full_sequence = fake.sequence;
+
+    index = (fake.first_event + fake.number_of_events) &
+        (fake.events_capacity - 1);
+    fake.events[index] = event;
+    fake.number_of_events++;
+    return event;
+}
+
+/* Create an error for the last request which had @major_opcode. */
+static xcb_generic_error_t *create_error(uint8_t error_code,
+        uint8_t major_opcode, uint32_t resource)
+{
+    xcb_generic_error_t *error;
+
+    error = xcalloc(1, sizeof(*error));
+    error->error_code = error_code;
+    error->sequence = fake.sequence;
+    error->resource_id = resource;
+    error->major_code = major_opcode;
+    error->full_sequence = fake.sequence;
+    return error;
+}
+
+/* Put an error for the last request which had @major_opcode into the event
+ * queue, like xcb does for unchecked requests.
+ */
+static void queue_error(uint8_t error_code, uint8_t major_opcode,
+        uint32_t resource)
+{
+    xcb_generic_error_t *error;
+
+    error = queue_event(0);
+    error->error_code = error_code;
+    error->resource_id = resource;
+    error->major_code = major_opcode;
+}
+
+/* Allocate a zeroed reply with @length 32 bit units of additional data. */
+static void *allocate_reply(uint32_t length)
+{
+    xcb_generic_reply_t *reply;
+
+    reply = xcalloc(1, FAKE_REPLY_SIZE + length * 4);
+    reply->response_type = FAKE_REPLY;
+    reply->length = length;
+    return reply;
+}
+
+/* Put @reply to the last request at the end of the replies, @reply may be
+ * NULL.
+ *
+ * @return the sequence number of the last request.
+ */
+static uint32_t queue_reply(void *reply)
+{
+    struct fake_reply *fake_reply;
+
+    if (fake.number_of_replies == fake.replies_capacity) {
+        /* move the replies that are not taken to the front */
+        fake.number_of_replies -= fake.first_reply;
+        memmove(fake.replies, &fake.replies[fake.first_reply],
+                sizeof(*fake.replies) * fake.number_of_replies);
+        fake.first_reply = 0;
+        if (fake.number_of_replies == fake.replies_capacity) {
+            fake.replies_capacity = MAX(fake.replies_capacity * 2, 64);
+            RESIZE(fake.replies, fake.replies_capacity);
+        }
+    }
+
+    if (reply != NULL) {
+        ((xcb_generic_reply_t*) reply)->sequence = fake.sequence;
+    }
+
+    fake_reply = &fake.replies[fake.number_of_replies++];
+    fake_reply->sequence = fake.sequence;
+    fake_reply->reply = reply;
+    fake_reply->is_taken = false;
+    return fake.sequence;
+}
+
+/* Find the reply to the request with @sequence.
+ *
+ * @return NULL if the reply was already taken.
+ */
+static struct fake_reply *find_reply(uint32_t sequence)
+{
+    uint32_t low, high, middle;
+
+    /* binary search, the replies are ordered by sequence number */
+    low = fake.first_reply;
+    high = fake.number_of_replies;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (fake.replies[middle].sequence < sequence) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low == fake.number_of_replies ||
+            fake.replies[low].sequence != sequence ||
+            fake.replies[low].is_taken) {
+        return NULL;
+    }
+    return &fake.replies[low];
+}
+
+/* Take the reply out of @fake_reply. */
+static void *take_reply(struct fake_reply *fake_reply)
+{
+    void *reply;
+
+    reply = fake_reply->reply;
+    fake_reply->reply = NULL;
+    fake_reply->is_taken = true;
+
+    while (fake.first_reply < fake.number_of_replies &&
+            fake.replies[fake.first_reply].is_taken) {
+        fake.first_reply++;
+    }
+    if (fake.first_reply == fake.number_of_replies) {
+        fake.first_reply = 0;
+        fake.number_of_replies = 0;
+    }
+    return reply;
+}
+
+/* Get the windows that want to know about structure changes of @window.
+ *
+ * @return the number of windows put into @listeners, at most two.
+ */
+static uint32_t get_structure_listeners(xcb_window_t window,
+        const struct fake_window *fake_window, xcb_window_t *listeners)
+{
+    uint32_t count = 0;
+
+    if ((fake.windows[0].event_mask & XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY)) {
+        listeners[count++] = FAKE_ROOT_WINDOW;
+    }
+    if ((fake_window->event_mask & XCB_EVENT_MASK_STRUCTURE_NOTIFY)) {
+        listeners[count++] = window;
+    }
+    return count;
+}
+
+/* Check if the window manager redirects requests of @fake_window. */
+static bool is_redirected(const struct fake_window *fake_window)
+{
+    return !fake_window->is_override_redirect &&
+        (fake.windows[0].event_mask & XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT);
+}
+
+/* Take @fake_window out of the stacking order. */
+static void unlink_fake_window(struct fake_window *fake_window)
+{
+    if (fake_window->above == XCB_NONE) {
+        fake.top = fake_window->below;
+    } else {
+        get_fake_window(fake_window->above)->below = fake_window->below;
+    }
+    if (fake_window->below == XCB_NONE) {
+        fake.bottom = fake_window->above;
+    } else {
+        get_fake_window(fake_window->below)->above = fake_window->above;
+    }
+    fake_window->above = XCB_NONE;
+    fake_window->below = XCB_NONE;
+}
+
+/* Put @window directly above @sibling or on top if @sibling is `XCB_NONE`. */
+static void link_fake_window_above(xcb_window_t window,
+        struct fake_window *fake_window, xcb_window_t sibling)
+{
+    struct fake_window *fake_sibling;
+
+    if (sibling == XCB_NONE) {
+        sibling = fake.top;
+    }
+    if (sibling == XCB_NONE) {
+        fake.bottom = window;
+        fake.top = window;
+        return;
+    }
+
+    fake_sibling = get_fake_window(sibling);
+    fake_window->below = sibling;
+    fake_window->above = fake_sibling->above;
+    if (fake_sibling->above == XCB_NONE) {
+        fake.top = window;
+    } else {
+        get_fake_window(fake_sibling->above)->below = window;
+    }
+    fake_sibling->above = window;
+}
+
+/* Put @window directly below @sibling or at the bottom if @sibling is
+ * `XCB_NONE`.
+ */
+static void link_fake_window_below(xcb_window_t window,
+        struct fake_window *fake_window, xcb_window_t sibling)
+{
+    struct fake_window *fake_sibling;
+
+    if (sibling == XCB_NONE) {
+        sibling = fake.bottom;
+    }
+    if (sibling == XCB_NONE) {
+        fake.bottom = window;
+        fake.top = window;
+        return;
+    }
+
+    fake_sibling = get_fake_window(sibling);
+    fake_window->above = sibling;
+    fake_window->below = fake_sibling->below;
+    if (fake_sibling->below == XCB_NONE) {
+        fake.bottom = window;
+    } else {
+        get_fake_window(fake_sibling->below)->above = window;
+    }
+    fake_sibling->below = window;
+}
+
+/* Move the input focus to @window. */
+static void change_fake_focus(xcb_window_t window)
+{
+    struct fake_window *fake_window;
+    xcb_focus_in_event_t *event;
+
+    if (fake.focus == window) {
+        return;
+    }
+
+    fake_window = get_fake_window(fake.focus);
+    if (fake_window != NULL &&
+            (fake_window->event_mask & XCB_EVENT_MASK_FOCUS_CHANGE)) {
+        event = queue_event(XCB_FOCUS_OUT);
+        event->detail = XCB_NOTIFY_DETAIL_NONLINEAR;
+        event->event = fake.focus;
+        event->mode = XCB_NOTIFY_MODE_NORMAL;
+    }
+
+    fake.focus = window;
+
+    fake_window = get_fake_window(window);
+    if (fake_window != NULL &&
+            (fake_window->event_mask & XCB_EVENT_MASK_FOCUS_CHANGE)) {
+        event = queue_event(XCB_FOCUS_IN);
+        event->detail = XCB_NOTIFY_DETAIL_NONLINEAR;
+        event->event = window;
+        event->mode = XCB_NOTIFY_MODE_NORMAL;
+    }
+}
+
+/* Set the attributes within @value_mask of @fake_window. */
+static void set_fake_attributes(struct fake_window *fake_window,
+        uint32_t value_mask, const uint32_t *values)
+{
+    /* the values are in the order of the bits */
+    for (uint32_t bit = 1; bit <= XCB_CW_CURSOR; bit <<= 1) {
+        if (!(value_mask & bit)) {
+            continue;
+        }
+        switch (bit) {
+        case XCB_CW_BORDER_PIXEL:
+            fake_window->border_pixel = *values;
+            break;
+
+        case XCB_CW_OVERRIDE_REDIRECT:
+            fake_window->is_override_redirect = *values;
+            break;
+
+        case XCB_CW_EVENT_MASK:
+            fake_window->event_mask = *values;
+            break;
+
+        /* the other attributes have no effect on the fake server */
+        }
+        values++;
+    }
+}
+
+/* Create the unmapped child @window of the root on top of all others. */
+static void create_fake_window(xcb_window_t window, int32_t x, int32_t y,
+        uint32_t width, uint32_t height, uint16_t window_class)
+{
+    struct fake_window *fake_window;
+    xcb_create_notify_event_t *event;
+
+    fake_window = &fake.windows[window - FAKE_ROOT_WINDOW];
+    memset(fake_window, 0, sizeof(*fake_window));
+    fake_window->exists = true;
+    fake_window->window_class = window_class;
+    fake_window->x = x;
+    fake_window->y = y;
+    fake_window->width = width;
+    fake_window->height = height;
+    link_fake_window_above(window, fake_window, XCB_NONE);
+
+    if ((fake.windows[0].event_mask & XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY)) {
+        event = queue_event(XCB_CREATE_NOTIFY);
+        event->parent = FAKE_ROOT_WINDOW;
+        event->window = window;
+        event->x = x;
+        event->y = y;
+        event->width = width;
+        event->height = height;
+    }
+}
+
+/* Show @window. */
+static void map_fake_window(xcb_window_t window,
+        struct fake_window *fake_window)
+{
+    xcb_window_t listeners[2];
+    uint32_t count;
+    xcb_map_notify_event_t *event;
+    xcb_expose_event_t *expose;
+
+    if (fake_window->is_mapped) {
+        return;
+    }
+
+    fake_window->is_mapped = true;
+
+    count = get_structure_listeners(window, fake_window, listeners);
+    for (uint32_t i = 0; i < count; i++) {
+        event = queue_event(XCB_MAP_NOTIFY);
+        event->event = listeners[i];
+        event->window = window;
+        event->override_redirect = fake_window->is_override_redirect;
+    }
+
+    if ((fake_window->event_mask & XCB_EVENT_MASK_EXPOSURE)) {
+        expose = queue_event(XCB_EXPOSE);
+        expose->window = window;
+        expose->width = fake_window->width;
+        expose->height = fake_window->height;
+    }
+}
+
+/* Hide @window, the focus reverts to the root if @window had it. */
+static void unmap_fake_window(xcb_window_t window,
+        struct fake_window *fake_window)
+{
+    xcb_window_t listeners[2];
+    uint32_t count;
+    xcb_unmap_notify_event_t *event;
+
+    if (!fake_window->is_mapped) {
+        return;
+    }
+
+    fake_window->is_mapped = false;
+
+    count = get_structure_listeners(window, fake_window, listeners);
+    for (uint32_t i = 0; i < count; i++) {
+        event = queue_event(XCB_UNMAP_NOTIFY);
+        event->event = listeners[i];
+        event->window = window;
+    }
+
+    if (fake.focus == window) {
+        change_fake_focus(FAKE_ROOT_WINDOW);
+    }
+}
+
+/* Change the geometry or stacking within @value_mask of @window. */
+static void configure_fake_window(xcb_window_t window,
+        struct fake_window *fake_window, uint16_t value_mask,
+        const uint32_t *values)
+{
+    xcb_window_t sibling = XCB_NONE;
+    xcb_window_t listeners[2];
+    uint32_t count;
+    xcb_configure_notify_event_t *event;
+
+    /* the values are in the order of the bits */
+    if ((value_mask & XCB_CONFIG_WINDOW_X)) {
+        fake_window->x = (int32_t) *values++;
+    }
+    if ((value_mask & XCB_CONFIG_WINDOW_Y)) {
+        fake_window->y = (int32_t) *values++;
+    }
+    if ((value_mask & XCB_CONFIG_WINDOW_WIDTH)) {
+        fake_window->width = *values++;
+    }
+    if ((value_mask & XCB_CONFIG_WINDOW_HEIGHT)) {
+        fake_window->height = *values++;
+    }
+    if ((value_mask & XCB_CONFIG_WINDOW_BORDER_WIDTH)) {
+        fake_window->border_width = *values++;
+    }
+    if ((value_mask & XCB_CONFIG_WINDOW_SIBLING)) {
+        sibling = *values++;
+        /* only siblings can be stacked relative to each other */
+        if (sibling == window || get_fake_window(sibling) == NULL) {
+            sibling = XCB_NONE;
+        }
+    }
+    if ((value_mask & XCB_CONFIG_WINDOW_STACK_MODE)) {
+        switch (*values) {
+        case XCB_STACK_MODE_ABOVE:
+            unlink_fake_window(fake_window);
+            link_fake_window_above(window, fake_window, sibling);
+            break;
+
+        case XCB_STACK_MODE_BELOW:
+            unlink_fake_window(fake_window);
+            link_fake_window_below(window, fake_window, sibling);
+            break;
+
+        /* the modes depending on overlapping windows are not modelled */
+        }
+    }
+
+    count = get_structure_listeners(window, fake_window, listeners);
+    for (uint32_t i = 0; i < count; i++) {
+        event = queue_event(XCB_CONFIGURE_NOTIFY);
+        event->event = listeners[i];
+        event->window = window;
+        event->above_sibling = fake_window->below;
+        event->x = fake_window->x;
+        event->y = fake_window->y;
+        event->width = fake_window->width;
+        event->height = fake_window->height;
+        event->border_width = fake_window->border_width;
+        event->override_redirect = fake_window->is_override_redirect;
+    }
+}
+
+/* Get @property of @fake_window.
+ *
+ * @return NULL if the property is not set.
+ */
+static struct fake_property *get_fake_property(
+        const struct fake_window *fake_window, xcb_atom_t property)
+{
+    struct fake_property *fake_property;
+
+    for (fake_property = fake_window->properties; fake_property != NULL;
+            fake_property = fake_property->next) {
+        if (fake_property->atom == property) {
+            return fake_property;
+        }
+    }
+    return NULL;
+}
+
+/* Replace @property of @window. */
+static void change_fake_property(xcb_window_t window,
+        struct fake_window *fake_window, xcb_atom_t property, xcb_atom_t type,
+        uint8_t format, uint32_t length, const void *data)
+{
+    struct fake_property *fake_property;
+    const uint32_t size = length * (format / 8);
+    xcb_property_notify_event_t *event;
+
+    fake_property = get_fake_property(fake_window, property);
+    if (fake_property == NULL) {
+        fake_property = xcalloc(1, sizeof(*fake_property));
+        fake_property->atom = property;
+        fake_property->next = fake_window->properties;
+        fake_window->properties = fake_property;
+    }
+
+    fake_property->type = type;
+    fake_property->format = format;
+    fake_property->length = length;
+    RESIZE(fake_property->data, MAX(size, 1));
+    if (size > 0) {
+        memcpy(fake_property->data, data, size);
+    }
+
+    if ((fake_window->event_mask & XCB_EVENT_MASK_PROPERTY_CHANGE)) {
+        event = queue_event(XCB_PROPERTY_NOTIFY);
+        event->window = window;
+        event->atom = property;
+        event->state = XCB_PROPERTY_NEW_VALUE;
+    }
+}
+
+/* Destroy @window and all its properties. */
+static void destroy_fake_window(xcb_window_t window,
+        struct fake_window *fake_window)
+{
+    xcb_window_t listeners[2];
+    uint32_t count;
+    xcb_destroy_notify_event_t *event;
+    struct fake_property *fake_property, *next;
+
+    unmap_fake_window(window, fake_window);
+
+    count = get_structure_listeners(window, fake_window, listeners);
+    for (uint32_t i = 0; i < count; i++) {
+        event = queue_event(XCB_DESTROY_NOTIFY);
+        event->event = listeners[i];
+        event->window = window;
+    }
+
+    unlink_fake_window(fake_window);
+    for (fake_property = fake_window->properties; fake_property != NULL;
+            fake_property = next) {
+        next = fake_property->next;
+        free(fake_property->data);
+        free(fake_property);
+    }
+    fake_window->properties = NULL;
+    fake_window->exists = false;
+}
+
+/* Give out the next window identifier. */
+static uint32_t fake_generate_id(void)
+{
+    if (fake.number_of_windows == fake.windows_capacity) {
+        fake.windows_capacity = MAX(fake.windows_capacity * 2, 64);
+        RESIZE(fake.windows, fake.windows_capacity);
+    }
+    memset(&fake.windows[fake.number_of_windows], 0,
+            sizeof(*fake.windows));
+    return FAKE_ROOT_WINDOW + fake.number_of_windows++;
+}
+
+/* Create a child window of the root on the fake server. */
+static xcb_generic_error_t *fake_create_window_checked(xcb_window_t window,
+        int32_t x, int32_t y, uint32_t width, uint32_t height,
+        uint16_t window_class, uint32_t value_mask, const uint32_t *values)
+{
+    count_request(XCB_CREATE_WINDOW);
+    /* the identifier must be given out and not be in use */
+    if (window <= FAKE_ROOT_WINDOW ||
+            window - FAKE_ROOT_WINDOW >= fake.number_of_windows ||
+            fake.windows[window - FAKE_ROOT_WINDOW].exists) {
+        return create_error(XCB_ID_CHOICE, XCB_CREATE_WINDOW, window);
+    }
+
+    if (window_class == XCB_WINDOW_CLASS_COPY_FROM_PARENT) {
+        window_class = XCB_WINDOW_CLASS_INPUT_OUTPUT;
+    }
+    create_fake_window(window, x, y, width, height, window_class);
+    set_fake_attributes(get_fake_window(window), value_mask, values);
+    return NULL;
+}
+
+/* Change the attributes of a window on the fake server. */
+static void fake_change_window_attributes(xcb_window_t window,
+        uint32_t value_mask, const uint32_t *values)
+{
+    struct fake_window *fake_window;
+
+    count_request(XCB_CHANGE_WINDOW_ATTRIBUTES);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        queue_error(XCB_WINDOW, XCB_CHANGE_WINDOW_ATTRIBUTES, window);
+        return;
+    }
+    set_fake_attributes(fake_window, value_mask, values);
+}
+
+/* Change the attributes of a window on the fake server and report errors
+ * directly.
+ */
+static xcb_generic_error_t *fake_change_window_attributes_checked(
+        xcb_window_t window, uint32_t value_mask, const uint32_t *values)
+{
+    struct fake_window *fake_window;
+
+    count_request(XCB_CHANGE_WINDOW_ATTRIBUTES);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        return create_error(XCB_WINDOW, XCB_CHANGE_WINDOW_ATTRIBUTES, window);
+    }
+    set_fake_attributes(fake_window, value_mask, values);
+    return NULL;
+}
+
+/* Configure a window on the fake server. */
+static void fake_configure_window(xcb_window_t window, uint16_t value_mask,
+        const uint32_t *values)
+{
+    struct fake_window *fake_window;
+
+    count_request(XCB_CONFIGURE_WINDOW);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL || window == FAKE_ROOT_WINDOW) {
+        queue_error(XCB_WINDOW, XCB_CONFIGURE_WINDOW, window);
+        return;
+    }
+    configure_fake_window(window, fake_window, value_mask, values);
+}
+
+/* Map a window on the fake server. */
+static void fake_map_window(xcb_window_t window)
+{
+    struct fake_window *fake_window;
+
+    count_request(XCB_MAP_WINDOW);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        queue_error(XCB_WINDOW, XCB_MAP_WINDOW, window);
+        return;
+    }
+    map_fake_window(window, fake_window);
+}
+
+/* Unmap a window on the fake server. */
+static void fake_unmap_window(xcb_window_t window)
+{
+    struct fake_window *fake_window;
+
+    count_request(XCB_UNMAP_WINDOW);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        queue_error(XCB_WINDOW, XCB_UNMAP_WINDOW, window);
+        return;
+    }
+    /* the root can not be unmapped */
+    if (window != FAKE_ROOT_WINDOW) {
+        unmap_fake_window(window, fake_window);
+    }
+}
+
+/* Replace a property on the fake server. */
+static void fake_change_property(xcb_window_t window, xcb_atom_t property,
+        xcb_atom_t type, uint8_t format, uint32_t length, const void *data)
+{
+    struct fake_window *fake_window;
+
+    count_request(XCB_CHANGE_PROPERTY);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        queue_error(XCB_WINDOW, XCB_CHANGE_PROPERTY, window);
+        return;
+    }
+    change_fake_property(window, fake_window, property, type, format, length,
+            data);
+}
+
+/* Set the input focus on the fake server. */
+static void fake_set_input_focus(xcb_window_t window)
+{
+    struct fake_window *fake_window;
+
+    count_request(XCB_SET_INPUT_FOCUS);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        queue_error(XCB_WINDOW, XCB_SET_INPUT_FOCUS, window);
+        return;
+    }
+    /* only viewable windows can be focused */
+    if (!fake_window->is_mapped) {
+        queue_error(XCB_MATCH, XCB_SET_INPUT_FOCUS, window);
+        return;
+    }
+    change_fake_focus(window);
+}
+
+/* Send an event to a client of the fake server, the clients follow the
+ * protocols of `WM_PROTOCOLS` right away.
+ */
+static void fake_send_event(xcb_window_t window, const char *event)
+{
+    struct fake_window *fake_window;
+    const xcb_client_message_event_t *message;
+
+    count_request(XCB_SEND_EVENT);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        queue_error(XCB_WINDOW, XCB_SEND_EVENT, window);
+        return;
+    }
+
+    message = (const xcb_client_message_event_t*) event;
+    if ((message->response_type & ~0x80) != XCB_CLIENT_MESSAGE ||
+            message->type != ATOM(WM_PROTOCOLS)) {
+        return;
+    }
+
+    if (message->data.data32[0] == ATOM(WM_DELETE_WINDOW)) {
+        destroy_fake_window(window, fake_window);
+    } else if (message->data.data32[0] == ATOM(WM_TAKE_FOCUS) &&
+            fake_window->is_mapped) {
+        change_fake_focus(window);
+    }
+}
+
+/* Kill the client owning a window on the fake server, each client has a single
+ * window.
+ */
+static void fake_kill_client(xcb_window_t window)
+{
+    struct fake_window *fake_window;
+
+    count_request(XCB_KILL_CLIENT);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL || window == FAKE_ROOT_WINDOW) {
+        queue_error(XCB_VALUE, XCB_KILL_CLIENT, window);
+        return;
+    }
+    destroy_fake_window(window, fake_window);
+}
+
+/* Answer a request for the attributes of a window. */
+static uint32_t fake_get_window_attributes(xcb_window_t window)
+{
+    struct fake_window *fake_window;
+    xcb_get_window_attributes_reply_t *reply;
+
+    count_request(XCB_GET_WINDOW_ATTRIBUTES);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        queue_error(XCB_WINDOW, XCB_GET_WINDOW_ATTRIBUTES, window);
+        return queue_reply(NULL);
+    }
+
+    reply = allocate_reply((sizeof(*reply) - FAKE_REPLY_SIZE) / 4);
+    reply->visual = FAKE_ROOT_VISUAL;
+    reply->_class = fake_window->window_class;
+    reply->win_gravity = XCB_GRAVITY_NORTH_WEST;
+    reply->map_state = fake_window->is_mapped ? XCB_MAP_STATE_VIEWABLE :
+        XCB_MAP_STATE_UNMAPPED;
+    reply->override_redirect = fake_window->is_override_redirect;
+    reply->all_event_masks = fake_window->event_mask;
+    reply->your_event_mask = fake_window->event_mask;
+    return queue_reply(reply);
+}
+
+/* Answer a request for the geometry of a window. */
+static uint32_t fake_get_geometry(xcb_window_t window)
+{
+    struct fake_window *fake_window;
+    xcb_get_geometry_reply_t *reply;
+
+    count_request(XCB_GET_GEOMETRY);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        queue_error(XCB_DRAWABLE, XCB_GET_GEOMETRY, window);
+        return queue_reply(NULL);
+    }
+
+    reply = allocate_reply(0);
+    reply->depth = fake_window->window_class == XCB_WINDOW_CLASS_INPUT_ONLY ?
+        0 : FAKE_ROOT_DEPTH;
+    reply->root = FAKE_ROOT_WINDOW;
+    reply->x = fake_window->x;
+    reply->y = fake_window->y;
+    reply->width = fake_window->width;
+    reply->height = fake_window->height;
+    reply->border_width = fake_window->border_width;
+    return queue_reply(reply);
+}
+
+/* Answer a request for a property of a window. */
+static uint32_t fake_get_property(xcb_window_t window, xcb_atom_t property,
+        xcb_atom_t type, uint32_t length)
+{
+    struct fake_window *fake_window;
+    struct fake_property *fake_property;
+    xcb_get_property_reply_t *reply;
+    uint64_t size, wanted_size;
+
+    count_request(XCB_GET_PROPERTY);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        queue_error(XCB_WINDOW, XCB_GET_PROPERTY, window);
+        return queue_reply(NULL);
+    }
+
+    fake_property = get_fake_property(fake_window, property);
+    /* a property that is not set has the type `XCB_NONE` */
+    if (fake_property == NULL) {
+        return queue_reply(allocate_reply(0));
+    }
+
+    size = (uint64_t) fake_property->length * (fake_property->format / 8);
+    /* a type mismatch only reports the actual type and size */
+    if (type != XCB_GET_PROPERTY_TYPE_ANY && type != fake_property->type) {
+        reply = allocate_reply(0);
+        reply->type = fake_property->type;
+        reply->format = fake_property->format;
+        reply->bytes_after = size;
+        return queue_reply(reply);
+    }
+
+    wanted_size = MIN(size, (uint64_t) length * 4);
+    reply = allocate_reply((wanted_size + 3) / 4);
+    reply->type = fake_property->type;
+    reply->format = fake_property->format;
+    reply->bytes_after = size - wanted_size;
+    reply->value_len = wanted_size / (fake_property->format / 8);
+    memcpy(xcb_get_property_value(reply), fake_property->data, wanted_size);
+    return queue_reply(reply);
+}
+
+/* Answer a request for the children of a window, only the root has
+ * children.
+ */
+static uint32_t fake_query_tree(xcb_window_t window)
+{
+    struct fake_window *fake_window;
+    xcb_query_tree_reply_t *reply;
+    xcb_window_t *children;
+    uint32_t count = 0;
+
+    count_request(XCB_QUERY_TREE);
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        queue_error(XCB_WINDOW, XCB_QUERY_TREE, window);
+        return queue_reply(NULL);
+    }
+
+    if (window == FAKE_ROOT_WINDOW) {
+        for (xcb_window_t child = fake.bottom; child != XCB_NONE;
+                child = get_fake_window(child)->above) {
+            count++;
+        }
+    }
+
+    reply = allocate_reply(count);
+    reply->root = FAKE_ROOT_WINDOW;
+    reply->parent = window == FAKE_ROOT_WINDOW ? XCB_NONE : FAKE_ROOT_WINDOW;
+    reply->children_len = count;
+    /* the children are in bottom to top stacking order */
+    children = xcb_query_tree_children(reply);
+    count = 0;
+    if (window == FAKE_ROOT_WINDOW) {
+        for (xcb_window_t child = fake.bottom; child != XCB_NONE;
+                child = get_fake_window(child)->above) {
+            children[count++] = child;
+        }
+    }
+    return queue_reply(reply);
+}
+
+/* Take the reply of the fake server, it answers all requests right away. */
+static bool fake_poll_for_reply(uint32_t sequence, void **reply)
+{
+    struct fake_reply *fake_reply;
+
+    fake_reply = find_reply(sequence);
+    *reply = fake_reply == NULL ? NULL : take_reply(fake_reply);
+    return true;
+}
+
+/* Take the reply of the fake server, there is nothing to wait for. */
+static void *fake_wait_for_reply(uint32_t sequence)
+{
+    struct fake_reply *fake_reply;
+
+    fake_reply = find_reply(sequence);
+    return fake_reply == NULL ? NULL : take_reply(fake_reply);
+}
+
+/* Drop the reply of the fake server. */
+static void fake_discard_reply(uint32_t sequence)
+{
+    struct fake_reply *fake_reply;
+
+    fake_reply = find_reply(sequence);
+    if (fake_reply != NULL) {
+        free(take_reply(fake_reply));
+    }
+}
+
+/* Take the next event out of the event queue. */
+static xcb_generic_event_t *fake_poll_for_event(void)
+{
+    xcb_generic_event_t *event;
+
+    if (fake.number_of_events == 0) {
+        return NULL;
+    }
+
+    event = fake.events[fake.first_event];
+    fake.first_event = (fake.first_event + 1) & (fake.events_capacity - 1);
+    fake.number_of_events--;
+    return event;
+}
+
+/* Nothing is buffered by the fake server. */
+static void fake_flush(void)
+{
+    /* nothing */
+}
+
+/* the backend answering from the fake server */
+const XBackend fake_backend = {
+    .generate_id = fake_generate_id,
+    .create_window_checked = fake_create_window_checked,
+    .change_window_attributes = fake_change_window_attributes,
+    .change_window_attributes_checked = fake_change_window_attributes_checked,
+    .configure_window = fake_configure_window,
+    .map_window = fake_map_window,
+    .unmap_window = fake_unmap_window,
+    .change_property = fake_change_property,
+    .set_input_focus = fake_set_input_focus,
+    .send_event = fake_send_event,
+    .kill_client = fake_kill_client,
+    .get_window_attributes = fake_get_window_attributes,
+    .get_geometry = fake_get_geometry,
+    .get_property = fake_get_property,
+    .query_tree = fake_query_tree,
+    .poll_for_reply = fake_poll_for_reply,
+    .wait_for_reply = fake_wait_for_reply,
+    .discard_reply = fake_discard_reply,
+    .poll_for_event = fake_poll_for_event,
+    .flush = fake_flush,
+};
+
+/* Set up the fake server and use it as backend. */
+void initialize_fake_server(uint32_t width, uint32_t height)
+{
+    xcb_window_t root;
+    struct fake_window *fake_root;
+    xcb_atom_t atoms[ATOM_MAX];
+
+    /* connecting to an invalid file descriptor gives a connection in error
+     * state, xcb drops all requests on it and all replies are NULL
+     */
+    connection = xcb_connect_to_fd(-1, NULL);
+    x_file_descriptor = -1;
+
+    root = fake_generate_id();
+    fake_root = &fake.windows[0];
+    fake_root->exists = true;
+    fake_root->is_mapped = true;
+    fake_root->window_class = XCB_WINDOW_CLASS_INPUT_OUTPUT;
+    fake_root->width = width;
+    fake_root->height = height;
+    fake.focus = root;
+
+    fake.screen.root = root;
+    fake.screen.root_visual = FAKE_ROOT_VISUAL;
+    fake.screen.white_pixel = 0xffffff;
+    fake.screen.width_in_pixels = width;
+    fake.screen.height_in_pixels = height;
+    fake.screen.root_depth = FAKE_ROOT_DEPTH;
+    screen = &fake.screen;
+
+    for (uint32_t i = 0; i < ATOM_MAX; i++) {
+        atoms[i] = FAKE_FIRST_ATOM + i;
+    }
+    set_atoms(atoms);
+
+    x_backend = &fake_backend;
+}
+
+/* Create an unmapped window of a new client. */
+xcb_window_t create_fake_client(int32_t x, int32_t y, uint32_t width,
+        uint32_t height)
+{
+    xcb_window_t window;
+
+    window = fake_generate_id();
+    create_fake_window(window, x, y, width, height,
+            XCB_WINDOW_CLASS_INPUT_OUTPUT);
+    return window;
+}
+
+/* Replace @property of the client window @window. */
+void set_fake_client_property(xcb_window_t window, xcb_atom_t property,
+        xcb_atom_t type, uint8_t format, uint32_t length, const void *data)
+{
+    struct fake_window *fake_window;
+
+    fake_window = get_fake_window(window);
+    if (fake_window != NULL) {
+        change_fake_property(window, fake_window, property, type, format,
+                length, data);
+    }
+}
+
+/* Ask for the client window @window to be shown. */
+void map_fake_client(xcb_window_t window)
+{
+    struct fake_window *fake_window;
+    xcb_map_request_event_t *event;
+
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL || fake_window->is_mapped) {
+        return;
+    }
+
+    if (is_redirected(fake_window)) {
+        event = queue_event(XCB_MAP_REQUEST);
+        event->parent = FAKE_ROOT_WINDOW;
+        event->window = window;
+    } else {
+        map_fake_window(window, fake_window);
+    }
+}
+
+/* Hide the client window @window. */
+void unmap_fake_client(xcb_window_t window)
+{
+    struct fake_window *fake_window;
+
+    fake_window = get_fake_window(window);
+    if (fake_window != NULL) {
+        unmap_fake_window(window, fake_window);
+    }
+}
+
+/* Ask for the client window @window to get a new geometry. */
+void configure_fake_client(xcb_window_t window, int32_t x, int32_t y,
+        uint32_t width, uint32_t height)
+{
+    struct fake_window *fake_window;
+    xcb_configure_request_event_t *event;
+    uint32_t values[4];
+
+    fake_window = get_fake_window(window);
+    if (fake_window == NULL) {
+        return;
+    }
+
+    if (is_redirected(fake_window)) {
+        event = queue_event(XCB_CONFIGURE_REQUEST);
+        event->parent = FAKE_ROOT_WINDOW;
+        event->window = window;
+        event->x = x;
+        event->y = y;
+        event->width = width;
+        event->height = height;
+        event->border_width = fake_window->border_width;
+        event->value_mask = XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y |
+            XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT;
+    } else {
+        values[0] = x;
+        values[1] = y;
+        values[2] = width;
+        values[3] = height;
+        configure_fake_window(window, fake_window, XCB_CONFIG_WINDOW_X |
+                XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH |
+                XCB_CONFIG_WINDOW_HEIGHT, values);
+    }
+}
+
+/* Destroy the client window @window. */
+void destroy_fake_client(xcb_window_t window)
+{
+    struct fake_window *fake_window;
+
+    fake_window = get_fake_window(window);
+    if (fake_window != NULL && window != FAKE_ROOT_WINDOW) {
+        destroy_fake_window(window, fake_window);
+    }
+}
+
+/* Check if the client window @window still exists. */
+bool does_fake_client_exist(xcb_window_t window)
+{
+    return get_fake_window(window) != NULL;
+}
+
+/* Get the number of requests fensterchef sent to the fake server. */
+uint64_t get_number_of_fake_requests(void)
+{
+    return fake.sequence;
+}
+
+/* Log how many requests of each kind fensterchef sent to the fake server. */
+void log_fake_server_statistics(void)
+{
+    const char *label;
+
+    LOG("fake server received %" PRIu32 " requests:\n", fake.sequence);
+    for (uint32_t i = 0; i < FAKE_REQUEST_KINDS; i++) {
+        if (fake.requests[i] == 0) {
+            continue;
+        }
+        label = xcb_event_get_request_label(i);
+        LOG("  %s: %" PRIu64 "\n", label == NULL ? "?" : label,
+                fake.requests[i]);
+    }
+}
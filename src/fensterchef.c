@@ -1,6 +1,7 @@
 #include <unistd.h>
 
 #include "configuration.h"
+#include "event.h"
 #include "fensterchef.h"
 #include "log.h"
 #include "render.h"
@@ -54,11 +55,13 @@ void set_notification(const uint8_t *message, int32_t x, int32_t y)
             notification.border_width);
 
     general_values[0] = XCB_STACK_MODE_ABOVE;
-    xcb_configure_window(connection, notification.id,
+    x_backend->configure_window(notification.id,
             XCB_CONFIG_WINDOW_STACK_MODE, general_values);
 
     /* show the window */
     map_client(&notification);
+    /* draw on the window with its new size */
+    commit_client(&notification);
 
     /* render the notification on the window */
     rectangle.x = 0;
@@ -72,6 +75,6 @@ void set_notification(const uint8_t *message, int32_t x, int32_t y)
             configuration.notification.padding / 2,
             measure.ascent + configuration.notification.padding / 2);
 
-    /* set an alarm to trigger after @configuration.notification.duration */
-    alarm(configuration.notification.duration);
+    /* hide the notification after @configuration.notification.duration */
+    set_timer(notification_timer, configuration.notification.duration * 1000);
 }
@@ -0,0 +1,319 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "event.h"
+#include "flight_recorder.h"
+#include "log.h"
+#include "reactor.h"
+#include "window.h"
+#include "window_list.h"
+
+/* The last records. This is always on so it only does a few stores per record
+ * and never allocates.
+ */
+static struct {
+    /* the records, `next` wraps around */
+    FlightRecord records[FLIGHT_RECORDER_SIZE];
+    /* the total number of records made, the next record goes to
+     * `next % FLIGHT_RECORDER_SIZE`
+     */
+    uint64_t next;
+    /* the time new records get */
+    uint32_t time;
+    /* the time fensterchef started */
+    struct timespec start;
+    /* the file the records are dumped into */
+    char path[256];
+} flight_recorder;
+
+/* Get the next record to fill. */
+static inline FlightRecord *get_next_record(flight_record_type_t type)
+{
+    FlightRecord *record;
+
+    record = &flight_recorder.records[
+        flight_recorder.next & (FLIGHT_RECORDER_SIZE - 1)];
+    flight_recorder.next++;
+    record->time = flight_recorder.time;
+    record->type = type;
+    return record;
+}
+
+/* Dump the records when fensterchef crashes. */
+static void handle_crash_signal(int signal)
+{
+    (void) signal;
+    /* the handler is reset so the signal repeats with the default action after
+     * returning
+     */
+    (void) dump_flight_recorder();
+}
+
+/* Dump the records when SIGUSR1 is received. */
+static void handle_dump_signal(int signal)
+{
+    (void) signal;
+    if (dump_flight_recorder() == OK) {
+        LOG("dumped flight recorder to %s\n", flight_recorder.path);
+    } else {
+        LOG_ERROR("could not dump flight recorder to %s: %s\n",
+                flight_recorder.path, strerror(errno));
+    }
+}
+
+/* Choose the dump file and install the dump handlers. */
+int initialize_flight_recorder(void)
+{
+    const char *directory;
+    struct sigaction action;
+
+    clock_gettime(CLOCK_MONOTONIC, &flight_recorder.start);
+
+    /* the path is made now because this is not possible in a signal handler */
+    directory = getenv("XDG_RUNTIME_DIR");
+    if (directory == NULL || directory[0] == '\0') {
+        directory = "/tmp";
+    }
+    snprintf(flight_recorder.path, sizeof(flight_recorder.path),
+            "%s/fensterchef-%ld.flight", directory, (long) getpid());
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_crash_signal;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGABRT, &action, NULL);
+
+    return register_signal(SIGUSR1, handle_dump_signal);
+}
+
+/* Take the current time for all records until the next tick. */
+void tick_flight_recorder(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    flight_recorder.time =
+        (now.tv_sec - flight_recorder.start.tv_sec) * 1000 +
+        (now.tv_nsec - flight_recorder.start.tv_nsec) / 1000000;
+}
+
+/* Record an event that is about to be handled. */
+void record_event(const xcb_generic_event_t *event)
+{
+    FlightRecord *const record = get_next_record(FLIGHT_RECORD_EVENT);
+
+    record->data.event = *event;
+}
+
+/* Record an action that is about to be done on @window. */
+void record_action(const Action *action, const Window *window)
+{
+    FlightRecord *const record = get_next_record(FLIGHT_RECORD_ACTION);
+
+    record->data.action.code = action->code;
+    record->data.action.window = window == NULL ? XCB_NONE : window->client.id;
+    /* strings can not be recovered from a dump */
+    if (get_action_data_type(action->code) == PARSER_DATA_TYPE_STRING) {
+        memset(record->data.action.parameters, 0,
+                sizeof(record->data.action.parameters));
+    } else {
+        memcpy(record->data.action.parameters, &action->parameter.quad,
+                sizeof(record->data.action.parameters));
+    }
+}
+
+/* Record the state of @client after it was committed. */
+void record_commit(const XClient *client)
+{
+    FlightRecord *const record = get_next_record(FLIGHT_RECORD_COMMIT);
+
+    record->data.commit.window = client->id;
+    record->data.commit.x = client->x;
+    record->data.commit.y = client->y;
+    record->data.commit.width = client->width;
+    record->data.commit.height = client->height;
+    record->data.commit.border_width = client->border_width;
+    record->data.commit.is_mapped = client->is_mapped;
+}
+
+/* Write @size bytes of @data to @file_descriptor, this is async-signal-safe. */
+static int write_all(int file_descriptor, const void *data, size_t size)
+{
+    const char *bytes = data;
+    ssize_t written;
+
+    while (size > 0) {
+        written = write(file_descriptor, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return ERROR;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return OK;
+}
+
+/* Write all records to the dump file. */
+int dump_flight_recorder(void)
+{
+    FlightRecorderHeader header;
+    xcb_atom_t atoms[ATOM_MAX];
+    uint32_t first;
+    int file_descriptor;
+    int result;
+
+    file_descriptor = open(flight_recorder.path,
+            O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (file_descriptor < 0) {
+        return ERROR;
+    }
+
+    memcpy(header.magic, FLIGHT_RECORDER_MAGIC, sizeof(header.magic));
+    header.version = FLIGHT_RECORDER_VERSION;
+    header.record_size = sizeof(FlightRecord);
+    header.number_of_records = MIN(flight_recorder.next,
+            (uint64_t) FLIGHT_RECORDER_SIZE);
+    header.randr_event_base = randr_event_base;
+    header.number_of_atoms = ATOM_MAX;
+    header.root = screen == NULL ? XCB_NONE : screen->root;
+    header.check_window = wm_check_window;
+    header.window_list = window_list.client.id;
+    header.notification = notification.id;
+
+    for (uint32_t i = 0; i < ATOM_MAX; i++) {
+        atoms[i] = x_atoms[i].atom;
+    }
+
+    /* the oldest record is right after the newest once the ring is full */
+    if (flight_recorder.next <= FLIGHT_RECORDER_SIZE) {
+        first = 0;
+    } else {
+        first = flight_recorder.next & (FLIGHT_RECORDER_SIZE - 1);
+    }
+
+    result = write_all(file_descriptor, &header, sizeof(header));
+    if (result == OK) {
+        result = write_all(file_descriptor, atoms, sizeof(atoms));
+    }
+    if (result == OK) {
+        result = write_all(file_descriptor, &flight_recorder.records[first],
+                (header.number_of_records - first) * sizeof(FlightRecord));
+    }
+    if (result == OK) {
+        result = write_all(file_descriptor, &flight_recorder.records[0],
+                first * sizeof(FlightRecord));
+    }
+    close(file_descriptor);
+    return result;
+}
+
+/* Get the path of the file the records are dumped into. */
+const char *get_flight_recorder_path(void)
+{
+    return flight_recorder.path;
+}
+
+/* Print a single record in the log format. */
+static void log_record(FlightRecord *record)
+{
+    switch (record->type) {
+    case FLIGHT_RECORD_EVENT:
+        LOG("%" PRIu32 "ms %V\n", record->time, &record->data.event);
+        break;
+
+    case FLIGHT_RECORD_ACTION:
+        if (record->data.action.code <= ACTION_NULL ||
+                record->data.action.code >= ACTION_MAX) {
+            LOG_ERROR("%" PRIu32 "ms invalid action %" PRIu32 "\n",
+                    record->time, record->data.action.code);
+            break;
+        }
+        LOG("%" PRIu32 "ms action %s on %w with %d %d %d %d\n",
+                record->time,
+                action_to_string(record->data.action.code),
+                record->data.action.window,
+                record->data.action.parameters[0],
+                record->data.action.parameters[1],
+                record->data.action.parameters[2],
+                record->data.action.parameters[3]);
+        break;
+
+    case FLIGHT_RECORD_COMMIT:
+        LOG("%" PRIu32 "ms commit %w to %R %" PRIu32 " mapped %b\n",
+                record->time, record->data.commit.window,
+                record->data.commit.x, record->data.commit.y,
+                record->data.commit.width, record->data.commit.height,
+                record->data.commit.border_width,
+                record->data.commit.is_mapped);
+        break;
+
+    default:
+        LOG_ERROR("%" PRIu32 "ms invalid record type %u\n",
+                record->time, record->type);
+        break;
+    }
+}
+
+/* Print the records within the dump at @path in the log format. */
+int decode_flight_recorder_dump(const char *path)
+{
+    static xcb_screen_t decode_screen;
+
+    FILE *file;
+    FlightRecorderHeader header;
+    xcb_atom_t atoms[ATOM_MAX];
+    FlightRecord record;
+    int result = OK;
+
+    file = fopen(path, "rb");
+    if (file == NULL) {
+        LOG_ERROR("could not open %s: %s\n", path, strerror(errno));
+        return ERROR;
+    }
+
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+            memcmp(header.magic, FLIGHT_RECORDER_MAGIC,
+                sizeof(header.magic)) != 0 ||
+            header.version != FLIGHT_RECORDER_VERSION ||
+            header.record_size != sizeof(record) ||
+            header.number_of_atoms != ATOM_MAX ||
+            fread(atoms, sizeof(atoms), 1, file) != 1) {
+        LOG_ERROR("%s is not a flight recorder dump of this version\n", path);
+        fclose(file);
+        return ERROR;
+    }
+
+    /* the events were recorded with this event base, atoms and windows */
+    randr_event_base = header.randr_event_base;
+    set_atoms(atoms);
+    decode_screen.root = header.root;
+    screen = &decode_screen;
+    wm_check_window = header.check_window;
+    window_list.client.id = header.window_list;
+    notification.id = header.notification;
+
+    LOG("decoding %" PRIu32 " records of %s\n",
+            header.number_of_records, path);
+    for (uint32_t i = 0; i < header.number_of_records; i++) {
+        if (fread(&record, sizeof(record), 1, file) != 1) {
+            LOG_ERROR("%s is cut off after %" PRIu32 " records\n", path, i);
+            result = ERROR;
+            break;
+        }
+        log_record(&record);
+    }
+
+    fclose(file);
+    return result;
+}
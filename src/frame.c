@@ -8,10 +8,30 @@
 #include "stash_frame.h"
 #include "utility.h"
 #include "window.h"
+#include "xalloc.h"
+
+/* how many frames fit into a slab of the frame pool */
+#define FRAMES_PER_SLAB 64
 
 /* the currently selected/focused frame */
 Frame *focus_frame;
 
+/* the pool all frames are allocated from */
+static struct object_pool frame_pool = OBJECT_POOL("frames", Frame,
+        FRAMES_PER_SLAB);
+
+/* Allocate a zeroed frame from the frame pool. */
+Frame *create_frame(void)
+{
+    return allocate_pool_object(&frame_pool);
+}
+
+/* Give @frame back to the frame pool. */
+void destroy_frame(Frame *frame)
+{
+    free_pool_object(&frame_pool, frame);
+}
+
 /* Check if the given point is within the given frame. */
 bool is_point_in_frame(const Frame *frame, int32_t x, int32_t y)
 {
@@ -108,10 +128,35 @@ void replace_frame(Frame *frame, Frame *with)
         with->window = NULL;
     }
 
+    attach_inner_windows(frame);
+
     /* reload the frame recursively */
     resize_frame(frame, frame->x, frame->y, frame->width, frame->height);
 }
 
+/* Point all windows within @frame and its children to the frame they are in.
+ */
+void attach_inner_windows(Frame *frame)
+{
+    if (frame->left != NULL) {
+        attach_inner_windows(frame->left);
+        attach_inner_windows(frame->right);
+    } else if (frame->window != NULL) {
+        frame->window->frame = frame;
+    }
+}
+
+/* Set the frame of all windows within @frame and its children to NULL. */
+void detach_inner_windows(Frame *frame)
+{
+    if (frame->left != NULL) {
+        detach_inner_windows(frame->left);
+        detach_inner_windows(frame->right);
+    } else if (frame->window != NULL) {
+        frame->window->frame = NULL;
+    }
+}
+
 /* Get the gaps the frame applies to its inner window. */
 void get_frame_gaps(Frame *frame, Extents *gaps)
 {
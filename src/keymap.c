@@ -2,10 +2,23 @@
 #include "keymap.h"
 #include "utility.h"
 #include "x11_management.h"
+#include "xalloc.h"
 
 /* symbol translation table */
 static xcb_key_symbols_t *key_symbols;
 
+/* the keyboard mapping set by `set_keymap()`, used if there is no table */
+static struct {
+    /* the first keycode */
+    xcb_keycode_t min_keycode;
+    /* the number of key symbols of each keycode */
+    uint8_t keysyms_per_keycode;
+    /* the number of keycodes */
+    uint32_t number_of_keycodes;
+    /* the key symbols of all keycodes */
+    xcb_keysym_t *keysyms;
+} keymap;
+
 /* Initializes the key symbol table so the below functions can be used. */
 int initialize_keymap(void)
 {
@@ -16,9 +29,24 @@ int initialize_keymap(void)
     return OK;
 }
 
+/* Use the given keyboard mapping instead of asking the server. */
+void set_keymap(xcb_keycode_t min_keycode, uint8_t keysyms_per_keycode,
+        const xcb_keysym_t *keysyms, uint32_t number_of_keysyms)
+{
+    free(keymap.keysyms);
+    keymap.min_keycode = min_keycode;
+    keymap.keysyms_per_keycode = keysyms_per_keycode;
+    keymap.number_of_keycodes = keysyms_per_keycode == 0 ? 0 :
+            number_of_keysyms / keysyms_per_keycode;
+    keymap.keysyms = xmemdup(keysyms, sizeof(*keysyms) * number_of_keysyms);
+}
+
 /* Refresh the keymap if a mapping notify event arrives. */
 void refresh_keymap(xcb_mapping_notify_event_t *event)
 {
+    if (key_symbols == NULL) {
+        return;
+    }
     (void) xcb_refresh_keyboard_mapping(key_symbols, event);
     /* regrab all keys */
     grab_configured_keys();
@@ -27,11 +55,46 @@ void refresh_keymap(xcb_mapping_notify_event_t *event)
 /* Get a keysym from a keycode. */
 xcb_keysym_t get_keysym(xcb_keycode_t keycode)
 {
+    uint32_t index;
+
+    /* use the captured keyboard mapping when replaying events */
+    if (key_symbols == NULL) {
+        index = (uint32_t) keycode - keymap.min_keycode;
+        if (keycode < keymap.min_keycode ||
+                index >= keymap.number_of_keycodes) {
+            return XCB_NO_SYMBOL;
+        }
+        return keymap.keysyms[index * keymap.keysyms_per_keycode];
+    }
     return xcb_key_symbols_get_keysym(key_symbols, keycode, 0);
 }
 
 /* Get a list of keycodes from a keysym. */
 xcb_keycode_t *get_keycodes(xcb_keysym_t keysym)
 {
-    return xcb_key_symbols_get_keycode(key_symbols, keysym);
+    xcb_keycode_t *keycodes;
+    uint32_t count = 0;
+
+    if (key_symbols != NULL) {
+        return xcb_key_symbols_get_keycode(key_symbols, keysym);
+    }
+
+    if (keymap.number_of_keycodes == 0) {
+        return NULL;
+    }
+
+    /* go through the columns in the same order as xcb does, the list is
+     * terminated by `XCB_NO_SYMBOL`
+     */
+    keycodes = xmalloc(sizeof(*keycodes) *
+            (keymap.number_of_keycodes * keymap.keysyms_per_keycode + 1));
+    for (uint32_t j = 0; j < keymap.keysyms_per_keycode; j++) {
+        for (uint32_t i = 0; i < keymap.number_of_keycodes; i++) {
+            if (keymap.keysyms[i * keymap.keysyms_per_keycode + j] == keysym) {
+                keycodes[count++] = keymap.min_keycode + i;
+            }
+        }
+    }
+    keycodes[count] = XCB_NO_SYMBOL;
+    return keycodes;
 }
@@ -1,11 +1,18 @@
+#include <errno.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <xcb/randr.h>
 #include <xcb/xcb_event.h>
 #include <xcb/xcb_event.h>
+#include <xcb/xcbext.h> // xcb_poll_for_reply
 
 #include "action.h"
 #include "event.h"
@@ -14,10 +21,70 @@
 #include "window.h"
 #include "window_list.h"
 #include "x11_management.h"
+#include "xalloc.h"
 
 /* the severity of the logging */
 log_severity_t log_severity = LOG_SEVERITY_INFO;
 
+/* the size of the log ring buffer in bytes, this is a power of two */
+#define LOG_RING_SIZE (1 << 20)
+
+/* the maximum number of bytes of a single log line, longer lines are cut */
+#define LOG_LINE_SIZE 4096
+
+/* the stream the current line is formatted into */
+static FILE *log_stream;
+
+/* the memory behind `log_stream` */
+static char log_line[LOG_LINE_SIZE];
+
+/* Lines that are formatted by the main thread and written to standard error
+ * output by a writer thread. The main thread is the only producer and the
+ * writer thread the only consumer, so the positions only need atomic loads
+ * and stores.
+ */
+static struct {
+    /* the bytes of the ring */
+    char *data;
+    /* the position the main thread writes the next line at, this only ever
+     * increases
+     */
+    size_t head;
+    /* the position the writer thread writes out next, this only ever increases
+     */
+    size_t tail;
+    /* if the writer thread waits for the event file descriptor */
+    int is_writer_waiting;
+    /* if the writer thread should write out what is left and stop */
+    int is_stopping;
+    /* file descriptor used to wake up the writer thread */
+    int event_fd;
+    /* the number of lines that did not fit since the last report */
+    uint64_t number_of_dropped_lines;
+    /* the writer thread */
+    pthread_t writer;
+    /* if the writer thread is running */
+    bool is_running;
+} log_ring;
+
+/* The names of atoms fensterchef does not know. They are requested from the
+ * server when they are first logged and only picked up once the reply is
+ * there so that logging never waits for the server.
+ */
+static struct {
+    /* the atoms whose name was requested */
+    struct unknown_atom {
+        /* the atom identifier */
+        xcb_atom_t atom;
+        /* the name of the atom, NULL while the reply is not there */
+        char *name;
+        /* the sequence number of the name request, 0 once it is done */
+        unsigned int sequence;
+    } *atoms;
+    /* the number of atoms */
+    uint32_t length;
+} unknown_atoms;
+
 /***********************/
 /** String conversion **/
 
@@ -115,18 +182,65 @@ static const char *atom_to_string(xcb_atom_t atom)
         [XCB_ATOM_WM_TRANSIENT_FOR] = "WM_TRANSIENT_FOR",
     };
 
+    uint32_t id;
+
     if (atom < SIZE(xcb_atoms)) {
         return xcb_atoms[atom];
     }
-    for (uint32_t i = 0; i < SIZE(x_atoms); i++) {
-        if (x_atoms[i].atom == atom) {
-            return x_atoms[i].name;
-        }
+    id = get_atom_id(atom);
+    if (id != ATOM_MAX) {
+        return x_atoms[id].name;
     }
 
     return NULL;
 }
 
+/* Get the name of an atom fensterchef does not know without blocking.
+ *
+ * @return NULL when the name is not there (yet).
+ */
+static const char *get_unknown_atom_name(xcb_atom_t atom)
+{
+    struct unknown_atom *unknown = NULL;
+    xcb_get_atom_name_reply_t *reply;
+    xcb_generic_error_t *error;
+
+    if (connection == NULL) {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < unknown_atoms.length; i++) {
+        if (unknown_atoms.atoms[i].atom == atom) {
+            unknown = &unknown_atoms.atoms[i];
+            break;
+        }
+    }
+
+    /* send the request, the reply is picked up the next time */
+    if (unknown == NULL) {
+        RESIZE(unknown_atoms.atoms, unknown_atoms.length + 1);
+        unknown = &unknown_atoms.atoms[unknown_atoms.length];
+        unknown_atoms.length++;
+        unknown->atom = atom;
+        unknown->name = NULL;
+        unknown->sequence =
+            xcb_get_atom_name_unchecked(connection, atom).sequence;
+        return NULL;
+    }
+
+    if (unknown->sequence != 0 && xcb_poll_for_reply(connection,
+                unknown->sequence, (void**) &reply, &error) != 0) {
+        unknown->sequence = 0;
+        if (reply != NULL) {
+            unknown->name = xstrndup(xcb_get_atom_name_name(reply),
+                    xcb_get_atom_name_name_length(reply));
+            free(reply);
+        }
+        free(error);
+    }
+    return unknown->name;
+}
+
 static const char *notify_detail_to_string(xcb_notify_detail_t detail)
 {
     switch (detail) {
@@ -259,45 +373,45 @@ static const char *gravity_to_string(xcb_gravity_t gravity)
 static void log_boolean(bool boolean)
 {
     fputs(boolean ? COLOR(GREEN) "true" CLEAR_COLOR :
-            COLOR(RED) "false" CLEAR_COLOR, stderr);
+            COLOR(RED) "false" CLEAR_COLOR, log_stream);
 }
 
 static void log_hexadecimal(uint32_t x)
 {
-    fprintf(stderr, COLOR(GREEN) "%#x" CLEAR_COLOR, x);
+    fprintf(log_stream, COLOR(GREEN) "%#x" CLEAR_COLOR, x);
 }
 
 static void log_point(int32_t x, int32_t y)
 {
-    fprintf(stderr, COLOR(GREEN) "%" PRId32 "+%" PRId32 CLEAR_COLOR, x, y);
+    fprintf(log_stream, COLOR(GREEN) "%" PRId32 "+%" PRId32 CLEAR_COLOR, x, y);
 }
 
 static void log_rectangle(int32_t x, int32_t y, uint32_t width, uint32_t height)
 {
-    fprintf(stderr, COLOR(GREEN) "%" PRId32 "+%" PRId32
+    fprintf(log_stream, COLOR(GREEN) "%" PRId32 "+%" PRId32
                 "+%" PRIu32 "x%" PRIu32  CLEAR_COLOR,
             x, y, width, height);
 }
 
 static void log_size(uint32_t width, uint32_t height)
 {
-    fprintf(stderr, COLOR(GREEN) "%" PRId32 "x%" PRId32 CLEAR_COLOR,
+    fprintf(log_stream, COLOR(GREEN) "%" PRId32 "x%" PRId32 CLEAR_COLOR,
             width, height);
 }
 
 static void log_integer(int32_t x)
 {
-    fprintf(stderr, COLOR(GREEN) "%" PRId32 CLEAR_COLOR, x);
+    fprintf(log_stream, COLOR(GREEN) "%" PRId32 CLEAR_COLOR, x);
 }
 
 static void log_unsigned(uint32_t x)
 {
-    fprintf(stderr, COLOR(GREEN) "%" PRIu32 CLEAR_COLOR, x);
+    fprintf(log_stream, COLOR(GREEN) "%" PRIu32 CLEAR_COLOR, x);
 }
 
 static void log_unsigned_pair(uint32_t x, uint32_t y)
 {
-    fprintf(stderr, COLOR(GREEN) "%" PRIu32 ",%" PRIu32 CLEAR_COLOR, x, y);
+    fprintf(log_stream, COLOR(GREEN) "%" PRIu32 ",%" PRIu32 CLEAR_COLOR, x, y);
 }
 
 static void log_button(xcb_button_t button)
@@ -306,9 +420,9 @@ static void log_button(xcb_button_t button)
 
     string = button_to_string(button);
     if (string == NULL) {
-        fprintf(stderr, COLOR(CYAN) "X%u" CLEAR_COLOR, button - 7);
+        fprintf(log_stream, COLOR(CYAN) "X%u" CLEAR_COLOR, button - 7);
     } else {
-        fprintf(stderr, COLOR(CYAN) "%s" CLEAR_COLOR, string);
+        fprintf(log_stream, COLOR(CYAN) "%s" CLEAR_COLOR, string);
     }
 }
 
@@ -316,13 +430,13 @@ static void log_source(uint32_t source)
 {
     switch (source) {
     case 1:
-        fputs(COLOR(CYAN) "client" CLEAR_COLOR, stderr);
+        fputs(COLOR(CYAN) "client" CLEAR_COLOR, log_stream);
         break;
     case 2:
-        fputs(COLOR(CYAN) "pager" CLEAR_COLOR, stderr);
+        fputs(COLOR(CYAN) "pager" CLEAR_COLOR, log_stream);
         break;
     default:
-        fputs(COLOR(CYAN) "legacy" CLEAR_COLOR, stderr);
+        fputs(COLOR(CYAN) "legacy" CLEAR_COLOR, log_stream);
         break;
     }
 }
@@ -333,9 +447,9 @@ static void log_gravity(xcb_gravity_t gravity)
 
     string = gravity_to_string(gravity);
     if (string == NULL) {
-        fprintf(stderr, COLOR(GREEN) "%u" CLEAR_COLOR, gravity);
+        fprintf(log_stream, COLOR(GREEN) "%u" CLEAR_COLOR, gravity);
     } else {
-        fprintf(stderr, COLOR(CYAN) "%s" CLEAR_COLOR, string);
+        fprintf(log_stream, COLOR(CYAN) "%s" CLEAR_COLOR, string);
     }
 }
 
@@ -345,9 +459,9 @@ static void log_direction(wm_move_resize_direction_t direction)
 
     string = direction_to_string(direction);
     if (string == NULL) {
-        fprintf(stderr, COLOR(GREEN) "%u" CLEAR_COLOR, direction);
+        fprintf(log_stream, COLOR(GREEN) "%u" CLEAR_COLOR, direction);
     } else {
-        fprintf(stderr, COLOR(CYAN) "%s" CLEAR_COLOR, string);
+        fprintf(log_stream, COLOR(CYAN) "%s" CLEAR_COLOR, string);
     }
 }
 
@@ -360,161 +474,158 @@ static void log_modifiers(uint32_t mask)
     };
     int modifier_count = 0;
 
-    fputs(COLOR(MAGENTA), stderr);
+    fputs(COLOR(MAGENTA), log_stream);
     for (const char **modifier = modifiers; mask != 0; mask >>= 1, modifier++) {
         if ((mask & 1)) {
             if (modifier_count > 0) {
-                fputs(CLEAR_COLOR "+" COLOR(MAGENTA), stderr);
+                fputs(CLEAR_COLOR "+" COLOR(MAGENTA), log_stream);
             }
-            fprintf(stderr, *modifier);
+            fprintf(log_stream, *modifier);
             modifier_count++;
         }
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_xcb_window(xcb_window_t xcb_window)
 {
+    Window *window;
+
     log_hexadecimal(xcb_window);
-    fputs(COLOR(YELLOW), stderr);
-    if (xcb_window == wm_check_window) {
-        fputs("<check>", stderr);
+    fputs(COLOR(YELLOW), log_stream);
+    /* the utility windows and the screen may not be set up yet */
+    if (xcb_window == XCB_NONE) {
+        /* nothing */
+    } else if (xcb_window == wm_check_window) {
+        fputs("<check>", log_stream);
     } else if (xcb_window == window_list.client.id) {
-        fputs("<window list>", stderr);
+        fputs("<window list>", log_stream);
     } else if (xcb_window == notification.id) {
-        fputs("<notification>", stderr);
-    } else if (xcb_window == screen->root) {
-        fputs("<root>", stderr);
+        fputs("<notification>", log_stream);
+    } else if (screen != NULL && xcb_window == screen->root) {
+        fputs("<root>", log_stream);
     } else {
-        for (Window *window = first_window; window != NULL;
-                window = window->next) {
-            if (window->client.id == xcb_window) {
-                fprintf(stderr, "<%" PRIu32 ">", window->number);
-                break;
-            }
+        window = get_window_of_xcb_window(xcb_window);
+        if (window != NULL) {
+            fprintf(log_stream, "<%" PRIu32 ">", window->number);
         }
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_motion(xcb_motion_t motion)
 {
-    fputs(COLOR(CYAN), stderr);
+    fputs(COLOR(CYAN), log_stream);
     switch (motion) {
     case XCB_MOTION_NORMAL:
-        fputs("normal", stderr);
+        fputs("normal", log_stream);
         break;
     case XCB_MOTION_HINT:
-        fputs("hint", stderr);
+        fputs("hint", log_stream);
         break;
     default:
-        fprintf(stderr, "%u", motion);
+        fprintf(log_stream, "%u", motion);
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_notify_detail(xcb_notify_detail_t detail)
 {
     const char *string;
 
-    fputs(COLOR(CYAN), stderr);
+    fputs(COLOR(CYAN), log_stream);
     string = notify_detail_to_string(detail);
     if (string == NULL) {
-        fprintf(stderr, "%u", detail);
+        fprintf(log_stream, "%u", detail);
     } else {
-        fputs(string, stderr);
+        fputs(string, log_stream);
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_notify_mode(xcb_notify_mode_t mode)
 {
     const char *string;
 
-    fputs(COLOR(CYAN), stderr);
+    fputs(COLOR(CYAN), log_stream);
     string = notify_mode_to_string(mode);
     if (string == NULL) {
-        fprintf(stderr, "%u", mode);
+        fprintf(log_stream, "%u", mode);
     } else {
-        fputs(string, stderr);
+        fputs(string, log_stream);
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_place(xcb_place_t place)
 {
-    fputs(COLOR(CYAN), stderr);
+    fputs(COLOR(CYAN), log_stream);
     switch (place) {
     case XCB_PLACE_ON_TOP:
-        fputs("on top", stderr);
+        fputs("on top", log_stream);
         break;
     case XCB_PLACE_ON_BOTTOM:
-        fputs("on bottom", stderr);
+        fputs("on bottom", log_stream);
         break;
     default:
-        fprintf(stderr, "%u", place);
+        fprintf(log_stream, "%u", place);
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_property_state(uint8_t state)
 {
-    fputs(COLOR(CYAN), stderr);
+    fputs(COLOR(CYAN), log_stream);
     switch (state) {
     case XCB_PROPERTY_NEW_VALUE:
-        fputs("new value", stderr);
+        fputs("new value", log_stream);
         break;
     case XCB_PROPERTY_DELETE:
-        fputs("delete", stderr);
+        fputs("delete", log_stream);
         break;
     default:
-        fprintf(stderr, "%" PRIu8, state);
+        fprintf(log_stream, "%" PRIu8, state);
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_atom(xcb_atom_t atom)
 {
     const char *atom_string;
-    xcb_get_atom_name_cookie_t name_cookie;
-    xcb_get_atom_name_reply_t *name;
 
-    fputs(COLOR(CYAN), stderr);
+    fputs(COLOR(CYAN), log_stream);
     atom_string = atom_to_string(atom);
     if (atom_string == NULL) {
-        name_cookie = xcb_get_atom_name(connection, atom);
-        name = xcb_get_atom_name_reply(connection, name_cookie, NULL);
-        if (name == NULL) {
-            fprintf(stderr, "%" PRIu32, atom);
+        atom_string = get_unknown_atom_name(atom);
+        if (atom_string == NULL) {
+            fprintf(log_stream, "%" PRIu32, atom);
         } else {
-            fprintf(stderr, "%.*s", xcb_get_atom_name_name_length(name),
-                    xcb_get_atom_name_name(name));
-            free(name);
+            fprintf(log_stream, "%s", atom_string);
         }
-        fputs(COLOR(RED) "<not known>", stderr);
+        fputs(COLOR(RED) "<not known>", log_stream);
     } else {
-        fprintf(stderr, "%s", atom_string);
+        fprintf(log_stream, "%s", atom_string);
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_visibility(xcb_visibility_t visibility)
 {
-    fputs(COLOR(CYAN), stderr);
+    fputs(COLOR(CYAN), log_stream);
     switch (visibility) {
     case XCB_VISIBILITY_UNOBSCURED:
-        fputs("unobscured", stderr);
+        fputs("unobscured", log_stream);
         break;
     case XCB_VISIBILITY_PARTIALLY_OBSCURED:
-        fputs("partially obscured", stderr);
+        fputs("partially obscured", log_stream);
         break;
     case XCB_VISIBILITY_FULLY_OBSCURED:
-        fputs("fully obscured", stderr);
+        fputs("fully obscured", log_stream);
         break;
     default:
-        fprintf(stderr, "%u", visibility);
+        fprintf(log_stream, "%u", visibility);
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_configure_mask(uint32_t mask)
@@ -525,115 +636,115 @@ static void log_configure_mask(uint32_t mask)
     };
     int flag_count = 0;
 
-    fputs(COLOR(MAGENTA), stderr);
+    fputs(COLOR(MAGENTA), log_stream);
     for (const char **flag = flags; mask != 0; mask >>= 1, flag++) {
         if ((mask & 1)) {
             if (flag_count > 0) {
-                fputs(CLEAR_COLOR "+" COLOR(MAGENTA), stderr);
+                fputs(CLEAR_COLOR "+" COLOR(MAGENTA), log_stream);
             }
-            fprintf(stderr, *flag);
+            fprintf(log_stream, *flag);
             flag_count++;
         }
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_mapping(xcb_mapping_t mapping)
 {
-    fputs(COLOR(CYAN), stderr);
+    fputs(COLOR(CYAN), log_stream);
     switch (mapping) {
     case XCB_MAPPING_MODIFIER:
-        fputs("modifier", stderr);
+        fputs("modifier", log_stream);
         break;
     case XCB_MAPPING_KEYBOARD:
-        fputs("keyboard", stderr);
+        fputs("keyboard", log_stream);
         break;
     case XCB_MAPPING_POINTER:
-        fputs("pointer", stderr);
+        fputs("pointer", log_stream);
         break;
     default:
-        fprintf(stderr, "%u", mapping);
+        fprintf(log_stream, "%u", mapping);
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_wm_state(xcb_icccm_wm_state_t state)
 {
-    fputs(COLOR(CYAN), stderr);
+    fputs(COLOR(CYAN), log_stream);
     switch (state) {
     case XCB_ICCCM_WM_STATE_WITHDRAWN:
-        fputs("withdrawn", stderr);
+        fputs("withdrawn", log_stream);
         break;
     case XCB_ICCCM_WM_STATE_NORMAL:
-        fputs("normal", stderr);
+        fputs("normal", log_stream);
         break;
     case XCB_ICCCM_WM_STATE_ICONIC:
-        fputs("iconic", stderr);
+        fputs("iconic", log_stream);
         break;
     default:
-        fprintf(stderr, "%u", state);
+        fprintf(log_stream, "%u", state);
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_window_mode(window_mode_t mode)
 {
-    fputs(COLOR(CYAN), stderr);
+    fputs(COLOR(CYAN), log_stream);
     switch (mode) {
     case WINDOW_MODE_TILING:
-        fputs("tiling", stderr);
+        fputs("tiling", log_stream);
         break;
     case WINDOW_MODE_FLOATING:
-        fputs("floating", stderr);
+        fputs("floating", log_stream);
         break;
     case WINDOW_MODE_DOCK:
-        fputs("dock", stderr);
+        fputs("dock", log_stream);
         break;
     case WINDOW_MODE_FULLSCREEN:
-        fputs("fullscreen", stderr);
+        fputs("fullscreen", log_stream);
         break;
     case WINDOW_MODE_MAX:
-        fputs("none", stderr);
+        fputs("none", log_stream);
         break;
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 static void log_connection_error(int error)
 {
-    fputs(COLOR(RED), stderr);
+    fputs(COLOR(RED), log_stream);
     switch (error) {
     case XCB_CONN_ERROR:
-        fputs("socket, pipe or other stream error", stderr);
+        fputs("socket, pipe or other stream error", log_stream);
         break;
     case XCB_CONN_CLOSED_EXT_NOTSUPPORTED:
-        fputs("an extension is not supported", stderr);
+        fputs("an extension is not supported", log_stream);
         break;
     case XCB_CONN_CLOSED_MEM_INSUFFICIENT:
-        fputs("insufficient memory", stderr);
+        fputs("insufficient memory", log_stream);
         break;
     case XCB_CONN_CLOSED_REQ_LEN_EXCEED:
-        fputs("maximum request length exceeded", stderr);
+        fputs("maximum request length exceeded", log_stream);
         break;
     case XCB_CONN_CLOSED_PARSE_ERR:
-        fputs("failed parsing display string", stderr);
+        fputs("failed parsing display string", log_stream);
         break;
     case XCB_CONN_CLOSED_INVALID_SCREEN:
-        fputs("no screen matching the display", stderr);
+        fputs("no screen matching the display", log_stream);
         break;
     case XCB_CONN_CLOSED_FDPASSING_FAILED:
-        fputs("FD passing operation failed", stderr);
+        fputs("FD passing operation failed", log_stream);
         break;
     default:
-        fprintf(stderr, "%d", error);
+        fprintf(log_stream, "%d", error);
     }
-    fputs(CLEAR_COLOR, stderr);
+    fputs(CLEAR_COLOR, log_stream);
 }
 
 /*************************/
 /** Event log functions **/
 
-#define V(string) fputs(", " string "=", stderr)
+#define V(string) fputs(", " string "=", log_stream)
 
 /* Log a RandrScreenChangeNotifyEvent to standard error output. */
 static void log_randr_screen_change_notify_event(
@@ -653,7 +764,7 @@ static void log_generic_error(xcb_generic_error_t *error)
     if (error_label == NULL) {
         V("error_code"); log_unsigned(error->error_code);
     } else {
-        V("error_label"); fprintf(stderr, COLOR(CYAN) "%s" CLEAR_COLOR,
+        V("error_label"); fprintf(log_stream, COLOR(CYAN) "%s" CLEAR_COLOR,
                 error_label);
     }
     V("code"); log_unsigned_pair(error->major_code, error->minor_code);
@@ -728,7 +839,7 @@ static void log_focus_in_event(xcb_focus_in_event_t *event)
 static void log_keymap_notify_event(xcb_keymap_notify_event_t *event)
 {
     (void) event;
-    fprintf(stderr, ", keys=...");
+    fprintf(log_stream, ", keys=...");
 }
 
 /* Log a ExposeEvent to standard error output. */
@@ -953,16 +1064,16 @@ static void log_client_message_event(xcb_client_message_event_t *event)
     } else if (event->type == ATOM(_NET_WM_STATE)) {
         V("data");
         if (event->data.data32[0] >= SIZE(state_strings)) {
-            fprintf(stderr, COLOR(RED) "<misformatted>");
+            fprintf(log_stream, COLOR(RED) "<misformatted>");
         } else {
-            fprintf(stderr, COLOR(CYAN) "%s",
+            fprintf(log_stream, COLOR(CYAN) "%s",
                     state_strings[event->data.data32[0]]);
         }
-        fputc(' ', stderr);
+        fputc(' ', log_stream);
         log_atom(event->data.data32[1]);
     } else {
         V("data32");
-        fprintf(stderr, COLOR(GREEN) "%" PRIu32 " %" PRIu32 " %" PRIu32
+        fprintf(log_stream, COLOR(GREEN) "%" PRIu32 " %" PRIu32 " %" PRIu32
                     " %" PRIu32 " %" PRIu32 CLEAR_COLOR,
                 event->data.data32[0], event->data.data32[1],
                 event->data.data32[2], event->data.data32[3],
@@ -994,35 +1105,35 @@ static void log_event(xcb_generic_event_t *event)
     event_type = (event->response_type & ~0x80);
     if (randr_event_base > 0 &&
             event_type == randr_event_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY) {
-        fputs("RandrScreenChangeNotify", stderr);
+        fputs("RandrScreenChangeNotify", log_stream);
     } else if (randr_event_base > 0 &&
             event_type == randr_event_base + XCB_RANDR_NOTIFY) {
-        fputs("RandrNotify", stderr);
+        fputs("RandrNotify", log_stream);
     } else if (xcb_event_get_label(event_type) != NULL) {
-        fputs(xcb_event_get_label(event_type), stderr);
+        fputs(xcb_event_get_label(event_type), log_stream);
     } else {
-        fprintf(stderr, "EVENT[%" PRIu8 "]", event_type);
+        fprintf(log_stream, "EVENT[%" PRIu8 "]", event_type);
     }
 
     if (event_type == XCB_GE_GENERIC) {
         xcb_ge_generic_event_t *const generic_event =
             (xcb_ge_generic_event_t*) event;
         if (generic_event->extension >= SIZE(generic_event_strings)) {
-            fprintf(stderr, "EVENT[%" PRIu8 "]", event_type);
+            fprintf(log_stream, "EVENT[%" PRIu8 "]", event_type);
         } else {
-            fprintf(stderr, "%s",
+            fprintf(log_stream, "%s",
                     generic_event_strings[generic_event->extension]);
         }
     }
 
-    fprintf(stderr, "(sequence=");
+    fprintf(log_stream, "(sequence=");
     log_unsigned(event->sequence);
 
     if (randr_event_base > 0 &&
             event_type == randr_event_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY) {
         log_randr_screen_change_notify_event(
                 (xcb_randr_screen_change_notify_event_t*) event);
-        fputs(")", stderr);
+        fputs(")", log_stream);
         return;
     }
 
@@ -1152,31 +1263,37 @@ static void log_event(xcb_generic_event_t *event)
         log_ge_generic_event((xcb_ge_generic_event_t*) event);
         break;
     }
-    fputs(")", stderr);
+    fputs(")", log_stream);
 }
 
 /* Log an xcb error to standard error output. */
 static void log_error(xcb_generic_error_t *error)
 {
-    fprintf(stderr, "(sequence=");
+    /* a broken connection has no error for the failed request */
+    if (error == NULL) {
+        fputs("(connection error)", log_stream);
+        return;
+    }
+
+    fprintf(log_stream, "(sequence=");
     log_integer(error->sequence);
     log_generic_error(error);
-    fputs(")", stderr);
+    fputs(")", log_stream);
 }
 
 /* Log a window to standard error output. */
 static void log_window(const Window *window)
 {
     log_hexadecimal(window->client.id);
-    fprintf(stderr, COLOR(YELLOW) "<%" PRIu32 ">" CLEAR_COLOR, window->number);
+    fprintf(log_stream, COLOR(YELLOW) "<%" PRIu32 ">" CLEAR_COLOR, window->number);
 }
 
 /* Log a window to standard error output. */
 static void log_frame(const Frame *frame)
 {
-    fputs(COLOR(MAGENTA) "[", stderr);
+    fputs(COLOR(MAGENTA) "[", log_stream);
     log_rectangle(frame->x, frame->y, frame->width, frame->height);
-    fputs(COLOR(MAGENTA) "]" CLEAR_COLOR, stderr);
+    fputs(COLOR(MAGENTA) "]" CLEAR_COLOR, log_stream);
 }
 
 /* Log an action to standard error output. */
@@ -1184,9 +1301,9 @@ static void log_actions(const Action *actions, uint32_t number_of_actions)
 {
     for (uint32_t i = 0; i < number_of_actions; i++) {
         if (i > 0) {
-            fputs(" ; ", stderr);
+            fputs(" ; ", log_stream);
         }
-        fprintf(stderr, COLOR(CYAN) "%s" CLEAR_COLOR,
+        fprintf(log_stream, COLOR(CYAN) "%s" CLEAR_COLOR,
                 action_to_string(actions[i].code));
         switch (get_action_data_type(actions[i].code)) {
         case PARSER_DATA_TYPE_VOID:
@@ -1194,23 +1311,23 @@ static void log_actions(const Action *actions, uint32_t number_of_actions)
             break;
 
         case PARSER_DATA_TYPE_BOOLEAN:
-            fputc(' ', stderr);
+            fputc(' ', log_stream);
             log_boolean(actions[i].parameter.boolean);
             break;
 
         case PARSER_DATA_TYPE_STRING:
-            fputc(' ', stderr);
-            fprintf(stderr, COLOR(GREEN) "%s" CLEAR_COLOR,
+            fputc(' ', log_stream);
+            fprintf(log_stream, COLOR(GREEN) "%s" CLEAR_COLOR,
                     (char*) actions[i].parameter.string);
             break;
 
         case PARSER_DATA_TYPE_INTEGER:
-            fputc(' ', stderr);
+            fputc(' ', log_stream);
             log_integer(actions[i].parameter.integer);
             break;
 
         case PARSER_DATA_TYPE_QUAD:
-            fprintf(stderr, COLOR(GREEN)
+            fprintf(log_stream, COLOR(GREEN)
                         " %" PRId32 " %" PRId32 " %" PRId32 " %" PRId32
                         CLEAR_COLOR,
                     actions[i].parameter.quad[0], actions[i].parameter.quad[1],
@@ -1218,12 +1335,12 @@ static void log_actions(const Action *actions, uint32_t number_of_actions)
             break;
 
         case PARSER_DATA_TYPE_COLOR:
-            fprintf(stderr, COLOR(YELLOW) " #%06x" CLEAR_COLOR,
+            fprintf(log_stream, COLOR(YELLOW) " #%06x" CLEAR_COLOR,
                 actions[i].parameter.color);
             break;
 
         case PARSER_DATA_TYPE_MODIFIERS:
-            fputc(' ', stderr);
+            fputc(' ', log_stream);
             log_modifiers(actions[i].parameter.modifiers);
             break;
         }
@@ -1233,38 +1350,282 @@ static void log_actions(const Action *actions, uint32_t number_of_actions)
 /* Log the screen information to standard error output. */
 static void log_screen(xcb_screen_t *screen)
 {
-    fprintf(stderr, "Screen(root="); log_hexadecimal(screen->root);
+    fprintf(log_stream, "Screen(root="); log_hexadecimal(screen->root);
     V("default_colormap"); log_hexadecimal(screen->default_colormap);
     V("white_pixel"); log_hexadecimal(screen->white_pixel);
     V("black_pixel"); log_hexadecimal(screen->black_pixel);
     V("size"); log_size(screen->width_in_pixels, screen->height_in_pixels);
     V("millimeter_size"); log_size(screen->width_in_millimeters,
                                 screen->height_in_millimeters);
-    fputs(")", stderr);
+    fputs(")", log_stream);
+}
+
+/*****************/
+/** Log writing **/
+
+/* Write all of @data to standard error output. */
+static void write_fully(const char *data, size_t length)
+{
+    ssize_t written;
+
+    while (length > 0) {
+        written = write(STDERR_FILENO, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            /* there is nobody to report this to */
+            return;
+        }
+        data += written;
+        length -= written;
+    }
+}
+
+/* Write out the log ring until it is stopped. */
+static void *run_log_writer(void *data)
+{
+    size_t head, tail;
+    size_t offset, length;
+    uint64_t value;
+
+    (void) data;
+    tail = log_ring.tail;
+    while (true) {
+        head = __atomic_load_n(&log_ring.head, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (__atomic_load_n(&log_ring.is_stopping, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+
+            /* announce the wait before checking again so that no line is
+             * missed, the main thread checks in the opposite order
+             */
+            __atomic_store_n(&log_ring.is_writer_waiting, true,
+                    __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&log_ring.head, __ATOMIC_SEQ_CST) == tail &&
+                    !__atomic_load_n(&log_ring.is_stopping,
+                        __ATOMIC_SEQ_CST)) {
+                (void) read(log_ring.event_fd, &value, sizeof(value));
+            }
+            __atomic_store_n(&log_ring.is_writer_waiting, false,
+                    __ATOMIC_RELAXED);
+            continue;
+        }
+
+        /* write the part up to the end of the ring in one go */
+        offset = tail & (LOG_RING_SIZE - 1);
+        length = MIN(head - tail, LOG_RING_SIZE - offset);
+        write_fully(&log_ring.data[offset], length);
+        tail += length;
+        __atomic_store_n(&log_ring.tail, tail, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+/* Wake up the writer thread if it waits for lines. */
+static void wake_up_log_writer(void)
+{
+    const uint64_t value = 1;
+
+    if (__atomic_load_n(&log_ring.is_writer_waiting, __ATOMIC_SEQ_CST)) {
+        (void) write(log_ring.event_fd, &value, sizeof(value));
+    }
+}
+
+/* Get the number of bytes that can be put into the log ring. */
+static inline size_t get_log_ring_space(void)
+{
+    return LOG_RING_SIZE - (log_ring.head -
+            __atomic_load_n(&log_ring.tail, __ATOMIC_ACQUIRE));
+}
+
+/* Put @line into the log ring, the caller checks that there is space. */
+static void push_log_line(const char *line, size_t length)
+{
+    size_t head;
+    size_t offset, first_length;
+
+    head = log_ring.head;
+
+    /* the line might wrap around the end of the ring */
+    offset = head & (LOG_RING_SIZE - 1);
+    first_length = MIN(length, LOG_RING_SIZE - offset);
+    memcpy(&log_ring.data[offset], line, first_length);
+    memcpy(&log_ring.data[0], &line[first_length], length - first_length);
+
+    __atomic_store_n(&log_ring.head, head + length, __ATOMIC_SEQ_CST);
+}
+
+/* Wait until the writer thread wrote out all lines of the log ring. */
+static void drain_log_ring(void)
+{
+    while (__atomic_load_n(&log_ring.tail, __ATOMIC_ACQUIRE) !=
+            log_ring.head) {
+        wake_up_log_writer();
+        sched_yield();
+    }
+}
+
+/* Hand the line formatted into `log_stream` to the writer.
+ *
+ * Errors are written right away after the lines before them so they are not
+ * lost when fensterchef crashes right after.
+ */
+static void submit_log_line(log_severity_t severity)
+{
+    char report[64];
+    int report_length = 0;
+    size_t length;
+
+    length = MIN((size_t) ftell(log_stream), sizeof(log_line));
+    /* the line was cut, at least end it */
+    if (length >= sizeof(log_line) - 1) {
+        log_line[length - 1] = '\n';
+    }
+
+    if (!log_ring.is_running) {
+        write_fully(log_line, length);
+    } else if (severity == LOG_SEVERITY_ERROR) {
+        drain_log_ring();
+        if (log_ring.number_of_dropped_lines > 0) {
+            report_length = snprintf(report, sizeof(report),
+                    "(dropped %" PRIu64 " log lines)\n",
+                    log_ring.number_of_dropped_lines);
+            write_fully(report, report_length);
+            log_ring.number_of_dropped_lines = 0;
+        }
+        write_fully(log_line, length);
+    } else {
+        /* report the dropped lines right before the next line that fits */
+        if (log_ring.number_of_dropped_lines > 0) {
+            report_length = snprintf(report, sizeof(report),
+                    "(dropped %" PRIu64 " log lines)\n",
+                    log_ring.number_of_dropped_lines);
+        }
+
+        if (get_log_ring_space() < report_length + length) {
+            log_ring.number_of_dropped_lines++;
+        } else {
+            if (report_length > 0) {
+                push_log_line(report, report_length);
+                log_ring.number_of_dropped_lines = 0;
+            }
+            push_log_line(log_line, length);
+        }
+        wake_up_log_writer();
+    }
+
+    rewind(log_stream);
+}
+
+/* Create the stream log lines are formatted into. */
+static void open_log_stream(void)
+{
+    log_stream = fmemopen(log_line, sizeof(log_line), "w");
+    if (log_stream == NULL) {
+        /* fall back to direct output */
+        log_stream = stderr;
+        return;
+    }
+    /* write straight into `log_line` */
+    setvbuf(log_stream, NULL, _IONBF, 0);
+}
+
+/* Write out the remaining lines and stop the writer thread. */
+static void stop_logging(void)
+{
+    if (!log_ring.is_running) {
+        return;
+    }
+
+    __atomic_store_n(&log_ring.is_stopping, true, __ATOMIC_SEQ_CST);
+    wake_up_log_writer();
+    pthread_join(log_ring.writer, NULL);
+    log_ring.is_running = false;
+
+    if (log_ring.number_of_dropped_lines > 0) {
+        fprintf(stderr, "(dropped %" PRIu64 " log lines)\n",
+                log_ring.number_of_dropped_lines);
+    }
+}
+
+/* Forget about the writer thread in a forked child, it only exists in the
+ * parent.
+ */
+static void detach_log_writer(void)
+{
+    log_ring.is_running = false;
+}
+
+/* Start the thread that writes out the log lines. */
+void initialize_logging(void)
+{
+    sigset_t all_signals, old_signals;
+
+    if (log_stream == NULL) {
+        open_log_stream();
+    }
+    if (log_stream == stderr) {
+        return;
+    }
+
+    log_ring.event_fd = eventfd(0, EFD_CLOEXEC);
+    if (log_ring.event_fd < 0) {
+        return;
+    }
+    log_ring.data = xmalloc(LOG_RING_SIZE);
+
+    /* signals must only go to the main thread */
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals);
+    if (pthread_create(&log_ring.writer, NULL, run_log_writer, NULL) != 0) {
+        pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+        close(log_ring.event_fd);
+        free(log_ring.data);
+        log_ring.data = NULL;
+        return;
+    }
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+
+    log_ring.is_running = true;
+    atexit(stop_logging);
+    pthread_atfork(NULL, NULL, detach_log_writer);
 }
 
 /* Print a formatted string to standard error output. */
 void log_formatted(log_severity_t severity, const char *file, int line,
         const char *format, ...)
 {
+    /* the time the time string was made for */
+    static time_t cached_time = -1;
+    /* the current time as string, it only changes every second */
+    static char time_string[32];
+
     va_list list;
     char buffer[64];
     time_t current_time;
-    struct tm *tm;
 
     /* omit logging if not severe enough */
     if (log_severity > severity) {
         return;
     }
 
+    if (log_stream == NULL) {
+        open_log_stream();
+    }
+
     /* print the time and file with line number at the front */
     current_time = time(NULL);
-    tm = localtime(&current_time);
-    strftime(buffer, sizeof(buffer),
-            severity == LOG_SEVERITY_ERROR ? COLOR(RED) "{%F %T}" :
-                COLOR(GREEN) "[%F %T]", tm);
-    fprintf(stderr, "%s" COLOR(YELLOW) "(%s:%d) " CLEAR_COLOR,
-            buffer, file, line);
+    if (current_time != cached_time) {
+        strftime(time_string, sizeof(time_string), "%F %T",
+                localtime(&current_time));
+        cached_time = current_time;
+    }
+    fprintf(log_stream, severity == LOG_SEVERITY_ERROR ?
+                COLOR(RED) "{%s}" COLOR(YELLOW) "(%s:%d) " CLEAR_COLOR :
+                COLOR(GREEN) "[%s]" COLOR(YELLOW) "(%s:%d) " CLEAR_COLOR,
+            time_string, file, line);
 
     /* parse the format string */
     va_start(list, format);
@@ -1275,7 +1636,7 @@ void log_formatted(log_severity_t severity, const char *file, int line,
                 format++;
                 /* fall through */
             case '\0':
-                fputc('%', stderr);
+                fputc('%', log_stream);
                 continue;
 
             /* print a point */
@@ -1362,7 +1723,7 @@ void log_formatted(log_severity_t severity, const char *file, int line,
             default: {
                 uint32_t i = 0;
 
-                fputs(COLOR(GREEN), stderr);
+                fputs(COLOR(GREEN), log_stream);
 
                 /* move a segment of `format` into `buffer` and feed it into the
                  * real `printf()`
@@ -1371,8 +1732,8 @@ void log_formatted(log_severity_t severity, const char *file, int line,
                     buffer[i] = format[i];
                     if (strchr(PRINTF_FORMAT_SPECIFIERS, format[i]) != NULL) {
                         buffer[i + 1] = '\0';
-                        vfprintf(stderr, buffer, list);
-                        fputs(CLEAR_COLOR, stderr);
+                        vfprintf(log_stream, buffer, list);
+                        fputs(CLEAR_COLOR, log_stream);
                         format += i - 1;
                         /* all clean */
                         i = 0;
@@ -1383,7 +1744,7 @@ void log_formatted(log_severity_t severity, const char *file, int line,
 
                 /* if anything is weird print the rest of the format string */
                 if (i > 0) {
-                    fputs(format, stderr);
+                    fputs(format, log_stream);
                     while (format[2] != '\0') {
                         format++;
                     }
@@ -1393,8 +1754,12 @@ void log_formatted(log_severity_t severity, const char *file, int line,
             }
             format++;
         } else {
-            fputc(format[0], stderr);
+            fputc(format[0], log_stream);
         }
     }
     va_end(list);
+
+    if (log_stream != stderr) {
+        submit_log_line(severity);
+    }
 }
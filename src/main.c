@@ -1,12 +1,16 @@
+#include "audit.h"
 #include "default_configuration.h"
 #include "event.h"
+#include "event_capture.h"
 #include "fensterchef.h"
+#include "flight_recorder.h"
 #include "frame.h"
 #include "keymap.h"
 #include "log.h"
 #include "monitor.h"
 #include "program_options.h"
 #include "render.h"
+#include "simulation.h"
 #include "window.h"
 #include "x11_management.h"
 #include "xalloc.h"
@@ -19,10 +23,25 @@ int main(int argc, char **argv)
         exit(EXIT_FAILURE);
     }
 
+    /* move writing the log off the main thread */
+    initialize_logging();
+
     LOG("welcome to " FENSTERCHEF_NAME " " FENSTERCHEF_VERSION "\n");
     LOG("the configuration file may reside in %s\n", fensterchef_configuration);
     LOG("parsed arguments, starting to log\n");
 
+    /* replay captured events instead of connecting to the server */
+    if (event_replay_path != NULL) {
+        quit_fensterchef(replay_events(event_replay_path) == OK ?
+                EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    /* manage the windows of a fake server instead of connecting */
+    if (number_of_simulated_windows > 0) {
+        quit_fensterchef(run_simulation(number_of_simulated_windows) == OK ?
+                EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
     /* initialize the X connection and X atoms */
     if (initialize_x11() != OK) {
         quit_fensterchef(EXIT_FAILURE);
@@ -44,14 +63,31 @@ int main(int argc, char **argv)
         quit_fensterchef(EXIT_FAILURE);
     }
 
-    /* set the signal handlers */
-    if (initialize_signal_handlers() != OK) {
+    /* set up the sources the event loop waits on */
+    if (initialize_event_sources() != OK) {
+        quit_fensterchef(EXIT_FAILURE);
+    }
+
+    /* record what happens so it can be looked at after a crash */
+    if (initialize_flight_recorder() != OK) {
+        quit_fensterchef(EXIT_FAILURE);
+    }
+
+    /* report the round trips periodically if requested */
+    if (initialize_audit() != OK) {
         quit_fensterchef(EXIT_FAILURE);
     }
 
     /* initialize randr if possible and the initial frames */
     initialize_monitors();
 
+    /* start capturing events if requested, the existing windows are part of
+     * the capture
+     */
+    if (initialize_event_capture() != OK) {
+        quit_fensterchef(EXIT_FAILURE);
+    }
+
     /* set the X properties on the root window */
     initialize_root_properties();
 
@@ -75,9 +111,11 @@ int main(int argc, char **argv)
     /* do an inital synchronization */
     synchronize_with_server();
     synchronize_client_list();
+    commit_clients();
+    flush_properties();
 
     /* before entering the loop, flush all the initialization calls */
-    xcb_flush(connection);
+    x_backend->flush();
 
     is_fensterchef_running = true;
     /* run the main event loop */
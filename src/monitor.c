@@ -3,6 +3,7 @@
 
 #include <xcb/xcb_renderutil.h>
 
+#include "audit.h"
 #include "configuration.h"
 #include "event.h" // randr_event_base
 #include "frame.h"
@@ -22,6 +23,9 @@ static bool randr_enabled = false;
 /* the first monitor in the monitor linked list */
 Monitor *first_monitor;
 
+/* if the struts of the monitors need to be recomputed */
+bool are_monitor_struts_dirty;
+
 /* Create a screenless monitor. */
 static Monitor *create_monitor(const char *name, uint32_t name_len)
 {
@@ -49,7 +53,8 @@ void initialize_monitors(void)
     /* get the randr version number, currently not used for anything */
     version_cookie = xcb_randr_query_version(connection,
             XCB_RANDR_MAJOR_VERSION, XCB_RANDR_MINOR_VERSION);
-    version = xcb_randr_query_version_reply(connection, version_cookie, &error);
+    version = AUDIT(xcb_randr_query_version_reply(connection, version_cookie,
+                &error));
     if (error != NULL) {
         LOG_ERROR("could not query randr version: %E\n", error);
         free(error);
@@ -213,8 +218,8 @@ Monitor *query_monitors(void)
             screen->root);
 
     /* get the primary monitor */
-    primary = xcb_randr_get_output_primary_reply(connection, primary_cookie,
-            NULL);
+    primary = AUDIT(xcb_randr_get_output_primary_reply(connection,
+                primary_cookie, NULL));
     if (primary == NULL) {
         primary_output = XCB_NONE;
     } else {
@@ -223,8 +228,9 @@ Monitor *query_monitors(void)
     }
 
     /* get the screen resources for querying the screen outputs */
-    resources = xcb_randr_get_screen_resources_current_reply(connection,
-            resources_cookie, &error);
+    resources = AUDIT_XCB_REPLY(resources_cookie, &error,
+            xcb_randr_get_screen_resources_current_reply(connection,
+                resources_cookie, &error));
     if (error != NULL) {
         LOG_ERROR("could not get screen resources: %E\n", error);
         free(error);
@@ -240,8 +246,8 @@ Monitor *query_monitors(void)
         /* get the output information which includes the output name */
         output_cookie = xcb_randr_get_output_info(connection, outputs[i],
                resources->timestamp);
-        output = xcb_randr_get_output_info_reply(connection, output_cookie,
-                &error);
+        output = AUDIT(xcb_randr_get_output_info_reply(connection,
+                    output_cookie, &error));
         if (error != NULL) {
             LOG_ERROR("unable to get output info of %d: %E\n", i, error);
             free(error);
@@ -264,7 +270,8 @@ Monitor *query_monitors(void)
         crtc_cookie = xcb_randr_get_crtc_info(connection, output->crtc,
                 resources->timestamp);
 
-        crtc = xcb_randr_get_crtc_info_reply(connection, crtc_cookie, &error);
+        crtc = AUDIT(xcb_randr_get_crtc_info_reply(connection, crtc_cookie,
+                    &error));
         if (crtc == NULL) {
             LOG_ERROR("output %.*s gave a NULL crtc: %E\n", name_length, name,
                     error);
@@ -350,7 +357,7 @@ void merge_monitors(Monitor *monitors)
 
             /* stash away the frame */
             stash_frame(monitor->frame);
-            free(monitor->frame);
+            destroy_frame(monitor->frame);
         }
         free(monitor->name);
         free(monitor);
@@ -361,11 +368,18 @@ void merge_monitors(Monitor *monitors)
     /* initialize the remaining monitors' frames */
     for (Monitor *monitor = monitors; monitor != NULL;
             monitor = monitor->next) {
+        /* the size of the monitor might have changed */
+        monitor->is_dirty = true;
         if (monitor->frame == NULL) {
             if (configuration.tiling.auto_fill_void) {
                 monitor->frame = pop_stashed_frame();
             } else {
-                monitor->frame = xcalloc(1, sizeof(*monitor->frame));
+                monitor->frame = NULL;
+            }
+            if (monitor->frame == NULL) {
+                monitor->frame = create_frame();
+            } else {
+                attach_inner_windows(monitor->frame);
             }
             /* set the initial size */
             monitor->frame->x = monitor->x;
@@ -375,6 +389,9 @@ void merge_monitors(Monitor *monitors)
         }
     }
 
+    /* the struts are relative to the monitors */
+    are_monitor_struts_dirty = true;
+
     /* if the focus frame was abonded, focus a different one */
     if (focus_frame == NULL) {
         set_focus_frame(first_monitor->frame);
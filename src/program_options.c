@@ -1,7 +1,12 @@
+#include <stdlib.h>
 #include <string.h>
 
+#include "audit.h"
+#include "event_capture.h"
 #include "fensterchef.h"
+#include "flight_recorder.h"
 #include "program_options.h"
+#include "simulation.h"
 
 /* how fensterchef is started */
 static const char *program_name;
@@ -14,6 +19,11 @@ typedef enum option {
     OPTION_VERBOSITY, /* -d VERBOSITY */
     OPTION_VERBOSE, /* --verbose */
     OPTION_CONFIG, /* -c, --config FILE */
+    OPTION_DECODE_FLIGHT_RECORDER, /* --decode-flight-recorder FILE */
+    OPTION_AUDIT_ROUND_TRIPS, /* --audit-round-trips */
+    OPTION_CAPTURE_EVENTS, /* --capture-events FILE */
+    OPTION_REPLAY_EVENTS, /* --replay-events FILE */
+    OPTION_SIMULATE, /* --simulate WINDOWS */
 } option_t;
 
 /* context the parser needs to parse the options */
@@ -33,6 +43,11 @@ static const struct parse_option {
     [OPTION_VERBOSITY] = { NULL, 'd', 1 },
     [OPTION_VERBOSE] = { "verbose", '\0', 0 },
     [OPTION_CONFIG] = { "config", 'c', 1 },
+    [OPTION_DECODE_FLIGHT_RECORDER] = { "decode-flight-recorder", '\0', 1 },
+    [OPTION_AUDIT_ROUND_TRIPS] = { "audit-round-trips", '\0', 0 },
+    [OPTION_CAPTURE_EVENTS] = { "capture-events", '\0', 1 },
+    [OPTION_REPLAY_EVENTS] = { "replay-events", '\0', 1 },
+    [OPTION_SIMULATE] = { "simulate", '\0', 1 },
 };
 
 /* Print the usage to standard error output. */
@@ -48,7 +63,16 @@ static void print_usage(void)
             error                   only log errors\n\
             nothing                 log nothing\n\
         --verbose                   log everything\n\
-        -c, --config    FILE        set the path of the configuration\n",
+        -c, --config    FILE        set the path of the configuration\n\
+        --decode-flight-recorder FILE\n\
+                                    print a flight recorder dump and exit\n\
+        --audit-round-trips         periodically log where fensterchef waits\n\
+                                    for replies of the X server\n\
+        --capture-events FILE       write all handled events into FILE\n\
+        --replay-events FILE        run the events captured in FILE through\n\
+                                    the event handlers without a server\n\
+        --simulate      WINDOWS     manage WINDOWS windows of a fake server\n\
+                                    and log how long it took\n",
         stderr);
 
 }
@@ -109,6 +133,42 @@ static int handle_option(option_t option, char *value)
     case OPTION_CONFIG:
         fensterchef_configuration = value;
         return OK;
+
+    /* print the records of a flight recorder dump */
+    case OPTION_DECODE_FLIGHT_RECORDER:
+        exit(decode_flight_recorder_dump(value) == OK ? EXIT_SUCCESS :
+                EXIT_FAILURE);
+
+    /* measure the time spent waiting for replies */
+    case OPTION_AUDIT_ROUND_TRIPS:
+        is_auditing = true;
+        return OK;
+
+    /* write the handled events into a file */
+    case OPTION_CAPTURE_EVENTS:
+        event_capture_path = value;
+        return OK;
+
+    /* replay events instead of managing windows */
+    case OPTION_REPLAY_EVENTS:
+        event_replay_path = value;
+        return OK;
+
+    /* run against the fake server instead of managing windows */
+    case OPTION_SIMULATE: {
+        char *end;
+        unsigned long number;
+
+        number = strtoul(value, &end, 10);
+        if (end != value && *end == '\0' && number > 0 &&
+                number <= UINT32_MAX) {
+            number_of_simulated_windows = number;
+            return OK;
+        }
+
+        fprintf(stderr, "invalid number of windows: %s\n", value);
+        break;
+    }
     }
 
     print_usage();
@@ -0,0 +1,304 @@
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "reactor.h"
+#include "utility.h"
+
+/* the maximum number of ready sources handled by one wait */
+#define REACTOR_MAXIMUM_EVENTS 16
+
+/* the number of signals a callback can be registered for */
+#define REACTOR_MAXIMUM_SIGNALS 64
+
+/* a file descriptor watched by the reactor */
+struct reactor_source {
+    /* the watched file descriptor, -1 once it was unregistered */
+    int file_descriptor;
+    /* the callback to run when the file descriptor is ready */
+    reactor_callback_t callback;
+    /* the data to pass to the callback */
+    void *data;
+    /* the next source in the linked list */
+    struct reactor_source *next;
+};
+
+/* a timer that runs a callback after some time */
+struct reactor_timer {
+    /* the timer file descriptor */
+    int file_descriptor;
+    /* the callback to run when the timer expires */
+    timer_callback_t callback;
+    /* the data to pass to the callback */
+    void *data;
+};
+
+/* the epoll instance */
+static int epoll_file_descriptor = -1;
+
+/* all watched file descriptors */
+static struct reactor_source *first_source;
+
+/* if a source was unregistered and needs to be freed */
+static bool has_removed_sources;
+
+/* the file descriptor the blocked signals are received on */
+static int signal_file_descriptor = -1;
+
+/* the signals that are received through the signal file descriptor */
+static sigset_t signal_mask;
+
+/* the signal mask before any signal was blocked */
+static sigset_t original_signal_mask;
+
+/* the callbacks of all registered signals */
+static signal_callback_t signal_callbacks[REACTOR_MAXIMUM_SIGNALS];
+
+/* Run the callbacks of all signals that were received. */
+static void handle_signals(int file_descriptor, uint32_t events, void *data)
+{
+    struct signalfd_siginfo information;
+    uint32_t signal;
+
+    (void) events;
+    (void) data;
+
+    while (read(file_descriptor, &information, sizeof(information)) ==
+            sizeof(information)) {
+        signal = information.ssi_signo;
+        if (signal < SIZE(signal_callbacks) &&
+                signal_callbacks[signal] != NULL) {
+            signal_callbacks[signal](signal);
+        }
+    }
+}
+
+/* Create the epoll instance and signal file descriptor. */
+int initialize_reactor(void)
+{
+    epoll_file_descriptor = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_file_descriptor < 0) {
+        LOG_ERROR("could not create epoll instance: %s\n", strerror(errno));
+        return ERROR;
+    }
+
+    sigemptyset(&signal_mask);
+    (void) sigprocmask(SIG_SETMASK, NULL, &original_signal_mask);
+
+    signal_file_descriptor = signalfd(-1, &signal_mask,
+            SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_file_descriptor < 0) {
+        LOG_ERROR("could not create signal file descriptor: %s\n",
+                strerror(errno));
+        return ERROR;
+    }
+    return register_file_descriptor(signal_file_descriptor, EPOLLIN,
+            handle_signals, NULL);
+}
+
+/* Start watching @file_descriptor for @events. */
+int register_file_descriptor(int file_descriptor, uint32_t events,
+        reactor_callback_t callback, void *data)
+{
+    struct reactor_source *source;
+    struct epoll_event event;
+
+    source = xmalloc(sizeof(*source));
+    source->file_descriptor = file_descriptor;
+    source->callback = callback;
+    source->data = data;
+
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = source;
+    if (epoll_ctl(epoll_file_descriptor, EPOLL_CTL_ADD, file_descriptor,
+                &event) < 0) {
+        LOG_ERROR("could not watch file descriptor %d: %s\n",
+                file_descriptor, strerror(errno));
+        free(source);
+        return ERROR;
+    }
+
+    source->next = first_source;
+    first_source = source;
+    return OK;
+}
+
+/* Stop watching @file_descriptor. */
+void unregister_file_descriptor(int file_descriptor)
+{
+    struct reactor_source *source;
+
+    for (source = first_source; source != NULL; source = source->next) {
+        if (source->file_descriptor == file_descriptor) {
+            break;
+        }
+    }
+
+    if (source == NULL) {
+        return;
+    }
+
+    (void) epoll_ctl(epoll_file_descriptor, EPOLL_CTL_DEL, file_descriptor,
+            NULL);
+
+    /* the source might be referenced by ready events that are still being
+     * handled, so it is only freed once the wait finished
+     */
+    source->file_descriptor = -1;
+    has_removed_sources = true;
+}
+
+/* Free all sources that were unregistered. */
+static void free_removed_sources(void)
+{
+    struct reactor_source **pointer, *source;
+
+    pointer = &first_source;
+    while (*pointer != NULL) {
+        source = *pointer;
+        if (source->file_descriptor < 0) {
+            *pointer = source->next;
+            free(source);
+        } else {
+            pointer = &source->next;
+        }
+    }
+    has_removed_sources = false;
+}
+
+/* Run the callback of an expired timer. */
+static void handle_timer_expiration(int file_descriptor, uint32_t events,
+        void *data)
+{
+    ReactorTimer *timer;
+    uint64_t expirations;
+
+    (void) events;
+
+    timer = data;
+    /* reading fails if the timer was rearmed in the meantime */
+    if (read(file_descriptor, &expirations, sizeof(expirations)) !=
+            sizeof(expirations)) {
+        return;
+    }
+    timer->callback(timer->data);
+}
+
+/* Create a timer that runs @callback once it expires. */
+ReactorTimer *create_timer(timer_callback_t callback, void *data)
+{
+    ReactorTimer *timer;
+
+    timer = xmalloc(sizeof(*timer));
+    timer->file_descriptor = timerfd_create(CLOCK_MONOTONIC,
+            TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer->file_descriptor < 0) {
+        LOG_ERROR("could not create timer: %s\n", strerror(errno));
+        free(timer);
+        return NULL;
+    }
+    timer->callback = callback;
+    timer->data = data;
+
+    if (register_file_descriptor(timer->file_descriptor, EPOLLIN,
+                handle_timer_expiration, timer) != OK) {
+        close(timer->file_descriptor);
+        free(timer);
+        return NULL;
+    }
+    return timer;
+}
+
+/* Arm @timer to expire in @milliseconds. */
+void set_timer(ReactorTimer *timer, uint32_t milliseconds)
+{
+    struct itimerspec specification;
+
+    memset(&specification, 0, sizeof(specification));
+    specification.it_value.tv_sec = milliseconds / 1000;
+    specification.it_value.tv_nsec = (milliseconds % 1000) * 1000000;
+    if (timerfd_settime(timer->file_descriptor, 0, &specification,
+                NULL) < 0) {
+        LOG_ERROR("could not set timer: %s\n", strerror(errno));
+    }
+}
+
+/* Destroy a timer created by `create_timer()`. */
+void destroy_timer(ReactorTimer *timer)
+{
+    unregister_file_descriptor(timer->file_descriptor);
+    close(timer->file_descriptor);
+    free(timer);
+}
+
+/* Block @signal and run @callback whenever it is received. */
+int register_signal(int signal, signal_callback_t callback)
+{
+    sigset_t set;
+
+    if (signal <= 0 || signal >= (int) SIZE(signal_callbacks)) {
+        LOG_ERROR("can not register signal %d\n", signal);
+        return ERROR;
+    }
+
+    sigemptyset(&set);
+    sigaddset(&set, signal);
+    /* the signal must be blocked, otherwise its default action is taken */
+    if (sigprocmask(SIG_BLOCK, &set, NULL) < 0) {
+        LOG_ERROR("could not block signal %d: %s\n", signal, strerror(errno));
+        return ERROR;
+    }
+
+    sigaddset(&signal_mask, signal);
+    if (signalfd(signal_file_descriptor, &signal_mask, 0) < 0) {
+        LOG_ERROR("could not receive signal %d: %s\n", signal,
+                strerror(errno));
+        return ERROR;
+    }
+
+    signal_callbacks[signal] = callback;
+    return OK;
+}
+
+/* Restore the signal mask that was active before signals were registered. */
+void restore_signal_mask(void)
+{
+    (void) sigprocmask(SIG_SETMASK, &original_signal_mask, NULL);
+}
+
+/* Wait until a source is ready and run the callbacks of all ready sources. */
+int wait_for_sources(int timeout)
+{
+    struct epoll_event events[REACTOR_MAXIMUM_EVENTS];
+    int count;
+    struct reactor_source *source;
+
+    count = epoll_wait(epoll_file_descriptor, events, SIZE(events), timeout);
+    if (count < 0) {
+        /* a signal that is not registered interrupted the wait */
+        if (errno == EINTR) {
+            return OK;
+        }
+        LOG_ERROR("could not wait for events: %s\n", strerror(errno));
+        return ERROR;
+    }
+
+    for (int i = 0; i < count; i++) {
+        source = events[i].data.ptr;
+        if (source->file_descriptor < 0 || source->callback == NULL) {
+            continue;
+        }
+        source->callback(source->file_descriptor, events[i].events,
+                source->data);
+    }
+
+    if (has_removed_sources) {
+        free_removed_sources();
+    }
+    return OK;
+}
@@ -2,6 +2,7 @@
 
 #include <xcb/xcb_renderutil.h>
 
+#include "audit.h"
 #include "log.h"
 #include "render.h"
 #include "utf8.h"
@@ -129,9 +130,9 @@ static int initialize_font_drawing(void)
 
     /* create the glyphset which will store the glyph pixel data */
     font.glyphset = xcb_generate_id(connection);
-    error = xcb_request_check(connection,
+    error = AUDIT(xcb_request_check(connection,
                 xcb_render_create_glyph_set_checked(connection,
-                    font.glyphset, get_picture_format(8)));
+                    font.glyphset, get_picture_format(8))));
     if (error != NULL) {
         LOG_ERROR("could not create a glyphset for rendering: %E\n", error);
         free(error);
@@ -154,8 +155,8 @@ int initialize_renderer(void)
      * for example ARGB, 8 bit colors etc.
      */
     formats_cookie = xcb_render_query_pict_formats(connection);
-    formats = xcb_render_query_pict_formats_reply(connection,
-            formats_cookie, &error);
+    formats = AUDIT(xcb_render_query_pict_formats_reply(connection,
+            formats_cookie, &error));
     if (formats == NULL) {
         LOG_ERROR("could not query picture formats: %E\n", error);
         return ERROR;
@@ -168,10 +169,10 @@ int initialize_renderer(void)
     /* create a graphics context */
     general_values[0] = screen->black_pixel;
     general_values[1] = screen->white_pixel;
-    error = xcb_request_check(connection,
+    error = AUDIT(xcb_request_check(connection,
             xcb_create_gc_checked(connection, stock_objects[STOCK_GC],
                 screen->root, XCB_GC_FOREGROUND | XCB_GC_BACKGROUND,
-                general_values));
+                general_values)));
     if (error != NULL) {
         LOG_ERROR("could not create graphics context for notifications: %E\n",
                 error);
@@ -182,10 +183,10 @@ int initialize_renderer(void)
     /* create a graphics context with inverted colors */
     general_values[0] = screen->white_pixel;
     general_values[1] = screen->black_pixel;
-    error = xcb_request_check(connection,
+    error = AUDIT(xcb_request_check(connection,
             xcb_create_gc_checked(connection,
                 stock_objects[STOCK_INVERTED_GC], screen->root,
-                XCB_GC_FOREGROUND | XCB_GC_BACKGROUND, general_values));
+                XCB_GC_FOREGROUND | XCB_GC_BACKGROUND, general_values)));
     if (error != NULL) {
         LOG_ERROR("could not create inverted graphics context for notifications: %E\n",
                 error);
@@ -282,12 +283,12 @@ xcb_render_picture_t cache_window_picture(xcb_drawable_t xcb_drawable)
     picture = xcb_generate_id(connection);
     general_values[0] = XCB_RENDER_POLY_MODE_IMPRECISE;
     general_values[1] = XCB_RENDER_POLY_EDGE_SMOOTH;
-    error = xcb_request_check(connection,
+    error = AUDIT(xcb_request_check(connection,
                 xcb_render_create_picture_checked(connection, picture,
                 xcb_drawable,
                 find_visual_format(screen->root_visual),
                 XCB_RENDER_CP_POLY_MODE | XCB_RENDER_CP_POLY_EDGE,
-                general_values));
+                general_values)));
     if (error != NULL) {
         LOG_ERROR("could not create picture: %E\n", error);
         free(error);
@@ -324,9 +325,10 @@ xcb_render_picture_t create_pen(xcb_render_color_t color)
 
     /* create 1x1 pixmap */
     pixmap = xcb_generate_id(connection);
-    error = xcb_request_check(connection, xcb_create_pixmap_checked(connection,
+    error = AUDIT(xcb_request_check(connection,
+            xcb_create_pixmap_checked(connection,
                 screen->root_depth, pixmap,
-                screen->root, 1, 1));
+                screen->root, 1, 1)));
     if (error != NULL) {
         LOG_ERROR("could not create pixmap: %E\n", error);
         free(error);
@@ -336,9 +338,9 @@ xcb_render_picture_t create_pen(xcb_render_color_t color)
     /* create repeated picture to render on */
     picture = xcb_generate_id(connection);
     general_values[0] = XCB_RENDER_REPEAT_NORMAL;
-    error = xcb_request_check(connection,
+    error = AUDIT(xcb_request_check(connection,
             xcb_render_create_picture_checked(connection, picture, pixmap,
-                get_picture_format(24), XCB_RENDER_CP_REPEAT, general_values));
+                get_picture_format(24), XCB_RENDER_CP_REPEAT, general_values)));
     if (error != NULL) {
         LOG_ERROR("could not create picture: %E\n", error);
         free(error);
@@ -0,0 +1,179 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "default_configuration.h"
+#include "event.h"
+#include "fake_server.h"
+#include "log.h"
+#include "monitor.h"
+#include "simulation.h"
+#include "statistics.h"
+#include "window.h"
+#include "xalloc.h"
+
+/* the size of the screen of the simulation */
+#define SIMULATION_WIDTH 1920
+#define SIMULATION_HEIGHT 1080
+
+/* the number of windows to simulate */
+uint32_t number_of_simulated_windows;
+
+/* the client windows of the simulation */
+static xcb_window_t *clients;
+
+/* Set the name of the client with @index, @prefix makes it change. */
+static void name_client(uint32_t index, const char *prefix)
+{
+    char name[32];
+    int length;
+
+    length = snprintf(name, sizeof(name), "%s %" PRIu32, prefix, index);
+    set_fake_client_property(clients[index], ATOM(_NET_WM_NAME),
+            ATOM(UTF8_STRING), 8, length, name);
+}
+
+/* Create the client with @index and ask for it to be mapped. */
+static void simulate_map(uint32_t index)
+{
+    const xcb_atom_t protocols[] = { ATOM(WM_DELETE_WINDOW) };
+
+    /* spread the windows so they do not all have the same geometry */
+    clients[index] = create_fake_client(index % 64 * 16, index % 32 * 16,
+            640 + index % 7 * 32, 480 + index % 5 * 32);
+    name_client(index, "window");
+    set_fake_client_property(clients[index], ATOM(WM_PROTOCOLS),
+            XCB_ATOM_ATOM, 32, SIZE(protocols), protocols);
+    map_fake_client(clients[index]);
+}
+
+/* Change the name of the client with @index. */
+static void simulate_rename(uint32_t index)
+{
+    name_client(index, "renamed window");
+}
+
+/* Ask for the client with @index to get a new geometry. */
+static void simulate_configure(uint32_t index)
+{
+    configure_fake_client(clients[index], index % 16 * 32, index % 8 * 32,
+            800, 600);
+}
+
+/* Hide the client with @index. */
+static void simulate_unmap(uint32_t index)
+{
+    unmap_fake_client(clients[index]);
+}
+
+/* Ask for the client with @index to be mapped again. */
+static void simulate_remap(uint32_t index)
+{
+    map_fake_client(clients[index]);
+}
+
+/* Close the client with @index like the user would. */
+static void simulate_close(uint32_t index)
+{
+    Window *window;
+
+    window = get_window_of_xcb_window(clients[index]);
+    if (window != NULL) {
+        close_window(window);
+    } else {
+        destroy_fake_client(clients[index]);
+    }
+}
+
+/* the phases of the simulation in the order they run */
+static const struct simulation_phase {
+    /* the name shown in the log */
+    const char *name;
+    /* the operation done for each client */
+    void (*operation)(uint32_t index);
+} phases[] = {
+    { "map", simulate_map },
+    { "rename", simulate_rename },
+    { "configure", simulate_configure },
+    { "unmap", simulate_unmap },
+    { "remap", simulate_remap },
+    { "close", simulate_close },
+};
+
+/* Set up fensterchef with the fake server as backend. */
+static int set_up_simulation(void)
+{
+    initialize_fake_server(SIMULATION_WIDTH, SIMULATION_HEIGHT);
+
+    if (take_control() != OK) {
+        return ERROR;
+    }
+
+    if (initialize_event_sources() != OK) {
+        return ERROR;
+    }
+
+    /* the fake server has no randr, a single monitor covers the screen */
+    merge_monitors(NULL);
+    initialize_root_properties();
+    /* the user configuration would make the runs differ between machines */
+    load_default_configuration();
+
+    /* handle the events of setting up */
+    run_cycle(focus_window);
+    return OK;
+}
+
+/* Run fensterchef against the fake server with @number_of_windows clients. */
+int run_simulation(uint32_t number_of_windows)
+{
+    uint64_t durations[SIZE(phases)];
+    uint64_t requests[SIZE(phases)];
+    uint64_t start, start_requests;
+    uint32_t number_of_left_windows = 0;
+
+    if (set_up_simulation() != OK) {
+        return ERROR;
+    }
+
+    /* only measure the handlers from now on */
+    reset_latency_statistics();
+
+    clients = xreallocarray(NULL, number_of_windows, sizeof(*clients));
+
+    for (uint32_t i = 0; i < SIZE(phases); i++) {
+        start = get_latency_time();
+        start_requests = get_number_of_fake_requests();
+        for (uint32_t j = 0; j < number_of_windows; j++) {
+            phases[i].operation(j);
+            run_cycle(focus_window);
+        }
+        durations[i] = get_latency_time() - start;
+        requests[i] = get_number_of_fake_requests() - start_requests;
+    }
+
+    for (uint32_t i = 0; i < number_of_windows; i++) {
+        if (does_fake_client_exist(clients[i])) {
+            number_of_left_windows++;
+        }
+    }
+
+    LOG("simulated %" PRIu32 " windows:\n", number_of_windows);
+    for (uint32_t i = 0; i < SIZE(phases); i++) {
+        LOG("  %s: %" PRIu64 ".%03" PRIu64 " ms, %" PRIu64 " requests\n",
+                phases[i].name,
+                durations[i] / 1000000, durations[i] / 1000 % 1000,
+                requests[i]);
+    }
+    log_fake_server_statistics();
+    log_latency_statistics();
+
+    free(clients);
+
+    if (number_of_left_windows > 0) {
+        LOG_ERROR("%" PRIu32 " windows were not closed\n",
+                number_of_left_windows);
+        return ERROR;
+    }
+    return OK;
+}
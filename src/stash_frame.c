@@ -23,8 +23,11 @@ Frame *stash_frame_later(Frame *frame)
         return NULL;
     }
 
+    /* the windows are no longer in the frame tree */
+    detach_inner_windows(frame);
+
     /* reparent the child frames */
-    Frame *const stash = xcalloc(1, sizeof(*stash));
+    Frame *const stash = create_frame();
     if (frame->left != NULL) {
         stash->split_direction = frame->split_direction;
         stash->left = frame->left;
@@ -42,12 +45,26 @@ Frame *stash_frame_later(Frame *frame)
     return stash;
 }
 
+/* Turn the window pointers within @frame and its children into handles. */
+static void stash_inner_windows(Frame *frame)
+{
+    if (frame->left != NULL) {
+        stash_inner_windows(frame->left);
+        stash_inner_windows(frame->right);
+    } else {
+        frame->stashed_window = get_window_handle(frame->window);
+        frame->window = NULL;
+    }
+}
+
 /* Links a frame into the stash linked list. */
 void link_frame_into_stash(Frame *frame)
 {
     if (frame == NULL) {
         return;
     }
+    /* windows might get destroyed while the frame is stashed */
+    stash_inner_windows(frame);
     frame->previous_stashed = last_stashed_frame;
     last_stashed_frame = frame;
 }
@@ -65,39 +82,38 @@ Frame *stash_frame(Frame *frame)
     return stash;
 }
 
-/* Check if @window still exists as hidden tiling window.
+/* Check if @window is still a hidden tiling window.
  *
- * @window may be NULL or a completely random memory address and this function
- *         can still handle that.
+ * @window may be NULL.
  */
 static bool is_window_valid(Window *window)
 {
-    for (Window *other = first_window; other != NULL; other = other->next) {
-        if (other == window) {
-            return window->state.mode == WINDOW_MODE_TILING &&
-                !window->state.is_visible;
-        }
-    }
-    return false;
+    return window != NULL && window->state.mode == WINDOW_MODE_TILING &&
+        !window->state.is_visible && window->frame == NULL;
 }
 
-/* Make sure all window pointers are still valid.
+/* Turn the window handles back into pointers and make sure the windows can
+ * still be shown.
  *
  * @return the number of valid windows.
  */
 static uint32_t validate_inner_windows(Frame *frame)
 {
+    Window *window;
+
     if (frame->left != NULL) {
         return validate_inner_windows(frame->left) +
             validate_inner_windows(frame->right);
-    } else if (frame->window != NULL) {
-        if (!is_window_valid(frame->window)) {
-            frame->window = NULL;
-            return 0;
-        }
-        return 1;
     }
-    return 0;
+
+    window = get_window_of_handle(frame->stashed_window);
+    frame->stashed_window = NULL_WINDOW_HANDLE;
+    if (!is_window_valid(window)) {
+        frame->window = NULL;
+        return 0;
+    }
+    frame->window = window;
+    return 1;
 }
 
 /* Frees @frame and all child frames. */
@@ -107,7 +123,7 @@ static void free_frame_recursively(Frame *frame)
         free_frame_recursively(frame->left);
         free_frame_recursively(frame->right);
     }
-    free(frame);
+    destroy_frame(frame);
 }
 
 /* Put the child frames or window into @frame of the recently saved frame. */
@@ -147,6 +163,7 @@ static void show_inner_windows(Frame *frame)
     } else if (frame->window != NULL) {
         reload_frame(frame);
         frame->window->state.is_visible = true;
+        mark_window_dirty(frame->window, WINDOW_DIRTY_VISIBILITY);
     }
 }
 
@@ -161,5 +178,5 @@ void fill_void_with_stash(Frame *frame)
     }
     replace_frame(frame, pop);
     show_inner_windows(frame);
-    free(pop);
+    destroy_frame(pop);
 }
@@ -0,0 +1,225 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <xcb/randr.h>
+#include <xcb/xcb_event.h>
+
+#include "event.h"
+#include "fensterchef.h"
+#include "frame.h"
+#include "log.h"
+#include "statistics.h"
+#include "utility.h"
+
+/* the histograms of all latencies, recording only touches two counters and a
+ * bucket so this is always on
+ */
+static LatencyHistogram histograms[LATENCY_MAX];
+
+/* the names of the latencies that are not events */
+static const char *latency_names[LATENCY_EVENT] = {
+    [LATENCY_CYCLE] = "cycle",
+    [LATENCY_SYNCHRONIZE_WITH_SERVER] = "synchronize_with_server",
+    [LATENCY_SYNCHRONIZE_CLIENT_LIST] = "synchronize_client_list",
+    [LATENCY_FLUSH] = "xcb_flush",
+};
+
+/* Get the current time of the monotonic clock in nanoseconds. */
+uint64_t get_latency_time(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Get the bucket @duration falls into. */
+static inline uint32_t get_latency_bucket(uint64_t duration)
+{
+    uint32_t exponent;
+
+    /* the small values are exact */
+    if (duration < LATENCY_SUB_BUCKETS) {
+        return duration;
+    }
+
+    exponent = 63 - __builtin_clzll(duration);
+    if (exponent >= LATENCY_MAXIMUM_EXPONENT) {
+        return LATENCY_BUCKETS - 1;
+    }
+    /* take the bits right after the most significant bit as sub bucket */
+    return (exponent - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS +
+        ((duration >> (exponent - LATENCY_SUB_BUCKET_BITS)) &
+            (LATENCY_SUB_BUCKETS - 1));
+}
+
+/* Get the largest duration that falls into @bucket. */
+static uint64_t get_latency_bucket_limit(uint32_t bucket)
+{
+    uint32_t exponent;
+    uint64_t sub_bucket;
+
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    exponent = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKET_BITS - 1;
+    sub_bucket = bucket % LATENCY_SUB_BUCKETS;
+    return ((LATENCY_SUB_BUCKETS + sub_bucket + 1) <<
+            (exponent - LATENCY_SUB_BUCKET_BITS)) - 1;
+}
+
+/* Add the duration since @start to the histogram of @latency. */
+void record_latency(latency_t latency, uint64_t start)
+{
+    LatencyHistogram *const histogram = &histograms[latency];
+    uint64_t duration;
+
+    duration = get_latency_time() - start;
+    histogram->count++;
+    histogram->maximum = MAX(histogram->maximum, duration);
+    histogram->buckets[get_latency_bucket(duration)]++;
+}
+
+/* Get the smallest duration that is larger than @percentile percent of all
+ * durations in @histogram.
+ */
+uint64_t get_latency_percentile(const LatencyHistogram *histogram,
+        uint32_t percentile)
+{
+    uint64_t rank;
+    uint64_t count = 0;
+
+    if (histogram->count == 0) {
+        return 0;
+    }
+
+    /* round up so the 100th percentile is the last duration */
+    rank = (histogram->count * percentile + 99) / 100;
+    rank = MAX(rank, 1);
+    for (uint32_t i = 0; i < LATENCY_BUCKETS; i++) {
+        count += histogram->buckets[i];
+        if (count >= rank) {
+            return MIN(get_latency_bucket_limit(i), histogram->maximum);
+        }
+    }
+    return histogram->maximum;
+}
+
+/* Get a readable name of @latency. */
+static void get_latency_name(latency_t latency, char *name, size_t size)
+{
+    uint8_t event_type;
+
+    if (latency < LATENCY_EVENT) {
+        snprintf(name, size, "%s", latency_names[latency]);
+        return;
+    }
+
+    event_type = latency - LATENCY_EVENT;
+    if (randr_event_base > 0 &&
+            event_type == randr_event_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY) {
+        snprintf(name, size, "RandrScreenChangeNotify");
+    } else if (randr_event_base > 0 &&
+            event_type == randr_event_base + XCB_RANDR_NOTIFY) {
+        snprintf(name, size, "RandrNotify");
+    } else if (xcb_event_get_label(event_type) != NULL) {
+        snprintf(name, size, "%s", xcb_event_get_label(event_type));
+    } else {
+        snprintf(name, size, "EVENT[%" PRIu8 "]", event_type);
+    }
+}
+
+/* Print @duration with a fitting unit into @string. */
+static void format_duration(uint64_t duration, char *string, size_t size)
+{
+    if (duration < 1000) {
+        snprintf(string, size, "%" PRIu64 "ns", duration);
+    } else if (duration < 1000000) {
+        snprintf(string, size, "%.1fus", duration / 1e3);
+    } else if (duration < 1000000000) {
+        snprintf(string, size, "%.1fms", duration / 1e6);
+    } else {
+        snprintf(string, size, "%.2fs", duration / 1e9);
+    }
+}
+
+/* Log all non empty histograms.
+ *
+ * @return the event type with the highest 99th percentile or `LATENCY_MAX` if
+ *         no event was handled.
+ */
+latency_t log_latency_statistics(void)
+{
+    char name[64];
+    char median[16], high[16], maximum[16];
+    latency_t slowest = LATENCY_MAX;
+    uint64_t slowest_duration = 0;
+    uint64_t duration;
+
+    LOG("latency statistics (count p50 p99 max):\n");
+    for (latency_t i = 0; i < LATENCY_MAX; i++) {
+        if (histograms[i].count == 0) {
+            continue;
+        }
+
+        get_latency_name(i, name, sizeof(name));
+        format_duration(get_latency_percentile(&histograms[i], 50),
+                median, sizeof(median));
+        duration = get_latency_percentile(&histograms[i], 99);
+        format_duration(duration, high, sizeof(high));
+        format_duration(histograms[i].maximum, maximum, sizeof(maximum));
+        LOG("  %s: %" PRIu64 " %s %s %s\n",
+                name, histograms[i].count, median, high, maximum);
+
+        if (i >= LATENCY_EVENT && duration >= slowest_duration) {
+            slowest = i;
+            slowest_duration = duration;
+        }
+    }
+    return slowest;
+}
+
+/* Log all non empty histograms and show a short summary in the notification
+ * window.
+ */
+void show_latency_statistics(void)
+{
+    char name[64];
+    char median[16], high[16], maximum[16];
+    char slowest_high[16];
+    char message[256];
+    latency_t slowest;
+
+    slowest = log_latency_statistics();
+
+    /* the notification window only has a single line */
+    format_duration(get_latency_percentile(&histograms[LATENCY_CYCLE], 50),
+            median, sizeof(median));
+    format_duration(get_latency_percentile(&histograms[LATENCY_CYCLE], 99),
+            high, sizeof(high));
+    format_duration(histograms[LATENCY_CYCLE].maximum,
+            maximum, sizeof(maximum));
+    if (slowest == LATENCY_MAX) {
+        snprintf(message, sizeof(message), "cycle p50 %s p99 %s max %s",
+                median, high, maximum);
+    } else {
+        get_latency_name(slowest, name, sizeof(name));
+        format_duration(get_latency_percentile(&histograms[slowest], 99),
+                slowest_high, sizeof(slowest_high));
+        snprintf(message, sizeof(message),
+                "cycle p50 %s p99 %s max %s, slowest %s p99 %s",
+                median, high, maximum, name, slowest_high);
+    }
+    set_notification((utf8_t*) message,
+            focus_frame->x + focus_frame->width / 2,
+            focus_frame->y + focus_frame->height / 2);
+}
+
+/* Clear all histograms. */
+void reset_latency_statistics(void)
+{
+    memset(histograms, 0, sizeof(histograms));
+}
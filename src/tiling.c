@@ -13,8 +13,8 @@ void split_frame(Frame *split_from, frame_split_direction_t direction)
     Frame *left, *right;
     Frame *next_focus_frame;
 
-    left = xcalloc(1, sizeof(*left));
-    right = xcalloc(1, sizeof(*right));
+    left = create_frame();
+    right = create_frame();
 
     /* let `left` take the children or window */
     if (split_from->left != NULL) {
@@ -26,6 +26,9 @@ void split_frame(Frame *split_from, frame_split_direction_t direction)
     } else {
         left->window = split_from->window;
         split_from->window = NULL;
+        if (left->window != NULL) {
+            left->window->frame = left;
+        }
     }
 
     split_from->split_direction = direction;
@@ -259,15 +262,18 @@ int remove_void(Frame *frame)
         parent->right->parent = parent;
     } else {
         parent->window = other->window;
+        if (parent->window != NULL) {
+            parent->window->frame = parent;
+        }
     }
 
-    free(other);
+    destroy_frame(other);
 
     resize_frame(parent, parent->x, parent->y, parent->width, parent->height);
 
     LOG("frame %F was removed\n", frame);
 
-    free(frame);
+    destroy_frame(frame);
 
     const int x = parent->x + parent->width / 2;
     const int y = parent->y + parent->height / 2;
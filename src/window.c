@@ -12,6 +12,9 @@
 /* the window that was created before any other */
 Window *oldest_window;
 
+/* the window that was created last */
+Window *newest_window;
+
 /* the window at the bottom of the Z stack */
 Window *bottom_window;
 
@@ -24,63 +27,157 @@ Window *first_window;
 /* the currently focused window */
 Window *focus_window;
 
-/* Create a window struct and add it to the window list. */
-Window *create_window(xcb_window_t xcb_window)
+/* the first window that needs to be synchronized with the server */
+Window *first_dirty_window;
+
+/* how many windows fit into a slab of the window pool */
+#define WINDOWS_PER_SLAB 32
+
+/* the pool all windows are allocated from */
+static struct object_pool window_pool = OBJECT_POOL("windows", Window,
+        WINDOWS_PER_SLAB);
+
+/* the number of window numbers tracked by a single word of the number bitmap */
+#define WINDOW_NUMBERS_PER_WORD 64
+
+/* the windows by their number */
+static struct {
+    /* the windows indexed by their number minus `FIRST_WINDOW_NUMBER`, NULL
+     * for free numbers
+     */
+    Window **slots;
+    /* how often each number was given out, this invalidates handles to
+     * destroyed windows
+     */
+    uint32_t *generations;
+    /* a bit for every number that is set when the number is taken */
+    uint64_t *used;
+    /* the number of slots, this is a multiple of `WINDOW_NUMBERS_PER_WORD` */
+    uint32_t capacity;
+    /* all words of `used` before this index are full */
+    uint32_t first_free_word;
+} window_numbers;
+
+/* the initial number of buckets in the window map */
+#define WINDOW_MAP_INITIAL_CAPACITY 64
+
+/* Hash map from X window ids to windows. It uses open addressing with linear
+ * probing and is kept at most half full so that most lookups only touch a
+ * single bucket.
+ */
+static struct window_map {
+    /* the buckets, an empty bucket is NULL */
+    Window **buckets;
+    /* the number of buckets, this is always a power of two */
+    uint32_t capacity;
+    /* the number of windows within the map */
+    uint32_t count;
+} window_map;
+
+/* Get the hash of an X window id. */
+static inline uint32_t hash_xcb_window(xcb_window_t xcb_window)
 {
-    xcb_get_window_attributes_cookie_t attributes_cookie;
-    xcb_get_window_attributes_reply_t *attributes;
-    xcb_get_geometry_cookie_t geometry_cookie;
-    xcb_get_geometry_reply_t *geometry;
-    xcb_generic_error_t *error;
-    Window *window;
-    Window *previous;
-    window_mode_t mode;
+    uint32_t hash;
 
-    attributes_cookie = xcb_get_window_attributes(connection, xcb_window);
-    geometry_cookie = xcb_get_geometry(connection, xcb_window);
+    /* X window ids are mostly sequential with the client id in the upper bits,
+     * mix them so that consecutive ids spread over the buckets
+     */
+    hash = xcb_window * UINT32_C(0x9e3779b1);
+    return hash ^ (hash >> 16);
+}
 
-    attributes = xcb_get_window_attributes_reply(connection, attributes_cookie,
-            &error);
-    if (attributes == NULL) {
-        LOG_ERROR("could not get window attributes of %w: %E\n",
-                xcb_window, error);
-        free(error);
-        xcb_discard_reply(connection, geometry_cookie.sequence);
-        return NULL;
+/* Put @window into the bucket it belongs to without checking the capacity. */
+static void put_window_into_map(Window *window)
+{
+    uint32_t mask;
+    uint32_t index;
+
+    mask = window_map.capacity - 1;
+    index = hash_xcb_window(window->client.id) & mask;
+    while (window_map.buckets[index] != NULL) {
+        index = (index + 1) & mask;
     }
-    /* override redirect is used by windows to indicate that our window manager
-     * should not tamper with them, we also check if the class is InputOnly
-     * which is not a case we want to handle
-     */
-    if (attributes->override_redirect ||
-            attributes->_class == XCB_WINDOW_CLASS_INPUT_ONLY) {
-        free(attributes);
-        xcb_discard_reply(connection, geometry_cookie.sequence);
-        return NULL;
+    window_map.buckets[index] = window;
+}
+
+/* Add @window to the window map so it can be found by its X window id. */
+static void add_window_to_map(Window *window)
+{
+    Window **old_buckets;
+    uint32_t old_capacity;
+
+    /* grow the map when it would become more than half full */
+    if ((window_map.count + 1) * 2 > window_map.capacity) {
+        old_buckets = window_map.buckets;
+        old_capacity = window_map.capacity;
+
+        window_map.capacity = old_capacity == 0 ?
+                WINDOW_MAP_INITIAL_CAPACITY : old_capacity * 2;
+        window_map.buckets = xcalloc(window_map.capacity,
+                sizeof(*window_map.buckets));
+
+        /* rehash all windows into the new buckets */
+        for (uint32_t i = 0; i < old_capacity; i++) {
+            if (old_buckets[i] != NULL) {
+                put_window_into_map(old_buckets[i]);
+            }
+        }
+        free(old_buckets);
     }
 
-    geometry = xcb_get_geometry_reply(connection, geometry_cookie,
-            &error);
-    if (geometry == NULL) {
-        LOG_ERROR("could not get window geometry of %w: %E\n",
-                xcb_window, error);
-        free(attributes);
-        free(error);
-        return NULL;
+    put_window_into_map(window);
+    window_map.count++;
+}
+
+/* Remove @window from the window map. */
+static void remove_window_from_map(Window *window)
+{
+    uint32_t mask;
+    uint32_t index, next;
+    uint32_t home;
+
+    mask = window_map.capacity - 1;
+    index = hash_xcb_window(window->client.id) & mask;
+    while (window_map.buckets[index] != window) {
+        index = (index + 1) & mask;
     }
 
-    /* set the border color */
-    general_values[0] = configuration.border.color;
-    /* we want to know if if any properties change */
-    general_values[1] = XCB_EVENT_MASK_PROPERTY_CHANGE;
-    xcb_change_window_attributes(connection, xcb_window,
-            XCB_CW_BORDER_PIXEL | XCB_CW_EVENT_MASK, general_values);
+    /* shift following windows back into the gap so that no probe sequence is
+     * interrupted by an empty bucket
+     */
+    next = index;
+    while (true) {
+        next = (next + 1) & mask;
+        if (window_map.buckets[next] == NULL) {
+            break;
+        }
+        home = hash_xcb_window(window_map.buckets[next]->client.id) & mask;
+        /* check if the bucket at @next may be moved to @index, this is the
+         * case when its home bucket is not cyclically within (index, next]
+         */
+        if (((next - home) & mask) >= ((next - index) & mask)) {
+            window_map.buckets[index] = window_map.buckets[next];
+            index = next;
+        }
+    }
+    window_map.buckets[index] = NULL;
+    window_map.count--;
+}
 
-    window = xcalloc(1, sizeof(*window));
+/* Allocate a window struct for @xcb_window and initialize it with the server's
+ * view of the window.
+ */
+static Window *allocate_window(xcb_window_t xcb_window,
+        const xcb_get_window_attributes_reply_t *attributes,
+        const xcb_get_geometry_reply_t *geometry)
+{
+    Window *window;
+
+    window = allocate_pool_object(&window_pool);
 
     window->client.id = xcb_window;
     window->client.x = geometry->x;
-    window->client.y = geometry->x;
+    window->client.y = geometry->y;
     window->client.width = geometry->width;
     window->client.height = geometry->height;
     window->client.border_color = configuration.border.color;
@@ -88,69 +185,182 @@ Window *create_window(xcb_window_t xcb_window)
     if (attributes->map_state != XCB_MAP_STATE_UNMAPPED) {
         window->client.is_mapped = true;
     }
+    mark_client_committed(&window->client);
 
-    free(geometry);
-    free(attributes);
-
-    /* start off with an invalid mode, this gets set below */
+    /* start off with an invalid mode, this gets set later */
     window->state.mode = WINDOW_MODE_MAX;
     window->x = window->client.x;
     window->y = window->client.y;
     window->width = window->client.width;
     window->height = window->client.height;
     window->border_color = window->client.border_color;
+    return window;
+}
 
-    /* link into the Z, age and number linked lists */
-    if (first_window == NULL) {
-        oldest_window = window;
-        bottom_window = window;
-        top_window = window;
-        first_window = window;
-        window->number = FIRST_WINDOW_NUMBER;
-    } else {
-        previous = first_window;
-        if (first_window->number == FIRST_WINDOW_NUMBER) {
-            /* find a gap in the window numbers */
-            for (; previous->next != NULL; previous = previous->next) {
-                if (previous->number + 1 < previous->next->number) {
-                    break;
-                }
-            }
-            window->number = previous->number + 1;
-            window->next = previous->next;
-            previous->next = window;
-        } else {
-            window->number = FIRST_WINDOW_NUMBER;
+/* Get the lowest number that is not taken by any window and take it for
+ * @window.
+ */
+static uint32_t take_window_number(Window *window)
+{
+    uint32_t word;
+    uint32_t index;
+    uint32_t old_capacity;
+
+    /* find the first word with a free bit */
+    word = window_numbers.first_free_word;
+    while (word < window_numbers.capacity / WINDOW_NUMBERS_PER_WORD &&
+            window_numbers.used[word] == UINT64_MAX) {
+        word++;
+    }
+    window_numbers.first_free_word = word;
+
+    /* all numbers are taken, make room for more */
+    if (word == window_numbers.capacity / WINDOW_NUMBERS_PER_WORD) {
+        old_capacity = window_numbers.capacity;
+        window_numbers.capacity = MAX(old_capacity * 2,
+                WINDOW_NUMBERS_PER_WORD);
+        RESIZE(window_numbers.slots, window_numbers.capacity);
+        RESIZE(window_numbers.generations, window_numbers.capacity);
+        RESIZE(window_numbers.used,
+                window_numbers.capacity / WINDOW_NUMBERS_PER_WORD);
+        memset(&window_numbers.slots[old_capacity], 0,
+                sizeof(*window_numbers.slots) *
+                    (window_numbers.capacity - old_capacity));
+        memset(&window_numbers.generations[old_capacity], 0,
+                sizeof(*window_numbers.generations) *
+                    (window_numbers.capacity - old_capacity));
+        memset(&window_numbers.used[word], 0,
+                sizeof(*window_numbers.used) *
+                    (window_numbers.capacity - old_capacity) /
+                    WINDOW_NUMBERS_PER_WORD);
+    }
+
+    index = word * WINDOW_NUMBERS_PER_WORD +
+        __builtin_ctzll(~window_numbers.used[word]);
+    window_numbers.used[word] |= (uint64_t) 1 << (index %
+            WINDOW_NUMBERS_PER_WORD);
+    window_numbers.slots[index] = window;
+    return index + FIRST_WINDOW_NUMBER;
+}
+
+/* Give the number of @window free so it can be taken by another window. */
+static void release_window_number(Window *window)
+{
+    uint32_t index;
+
+    index = window->number - FIRST_WINDOW_NUMBER;
+    window_numbers.used[index / WINDOW_NUMBERS_PER_WORD] &=
+        ~((uint64_t) 1 << (index % WINDOW_NUMBERS_PER_WORD));
+    window_numbers.slots[index] = NULL;
+    window_numbers.generations[index]++;
+    window_numbers.first_free_word = MIN(window_numbers.first_free_word,
+            index / WINDOW_NUMBERS_PER_WORD);
+}
+
+/* Link all @windows into the Z, age and number linked lists in one go. The
+ * windows are put on top of the Z linked list in the given order and get the
+ * lowest free numbers.
+ */
+static void link_windows(Window **windows, uint32_t count)
+{
+    Window *window, *previous;
+
+    for (uint32_t i = 0; i < count; i++) {
+        window = windows[i];
+
+        /* the number is the lowest free one, so all lower numbers are taken
+         * and the window with the number right below is the previous window in
+         * the number linked list
+         */
+        window->number = take_window_number(window);
+        if (window->number == FIRST_WINDOW_NUMBER) {
+            previous = NULL;
             window->next = first_window;
             first_window = window;
+        } else {
+            previous = window_numbers.slots[window->number - 1 -
+                FIRST_WINDOW_NUMBER];
+            window->next = previous->next;
+            previous->next = window;
+        }
+        window->previous = previous;
+        if (window->next != NULL) {
+            window->next->previous = window;
         }
 
         /* put the window at the top of the Z linked list */
-        while (previous->above != NULL) {
-            previous = previous->above;
+        if (top_window == NULL) {
+            bottom_window = window;
+        } else {
+            top_window->above = window;
+            window->below = top_window;
         }
-        previous->above = window;
-        window->below = previous;
+        top_window = window;
 
-        /* put the window into the age linked list */
-        previous = oldest_window;
-        while (previous->newer != NULL) {
-            previous = previous->newer;
+        /* put the window at the end of the age linked list */
+        if (newest_window == NULL) {
+            oldest_window = window;
+        } else {
+            newest_window->newer = window;
+            window->older = newest_window;
         }
-        previous->newer = window;
+        newest_window = window;
     }
+}
+
+/* Initialize the properties, mode and Z position of the linked @window. */
+static void set_up_window(Window *window, PropertyWave *wave)
+{
+    window_mode_t mode;
+
+    add_window_to_map(window);
 
     /* initialize the window mode and Z position */
-    mode = initialize_window_properties(window);
+    mode = initialize_window_properties(window, wave);
     set_window_mode(window, mode);
     update_window_layer(window);
 
+    /* the window state has never been synchronized */
+    mark_window_dirty(window, WINDOW_DIRTY_ALL);
+
     has_client_list_changed = true;
 
     LOG("created new window %W\n", window);
+}
+
+/* Create a window struct and add it to the window list. */
+Window *create_window(xcb_window_t xcb_window,
+        const xcb_get_window_attributes_reply_t *attributes,
+        const xcb_get_geometry_reply_t *geometry, PropertyWave *wave)
+{
+    Window *window;
+
+    window = allocate_window(xcb_window, attributes, geometry);
+    link_windows(&window, 1);
+    set_up_window(window, wave);
     return window;
 }
 
+/* Create window structs for many X windows and add them to the window list in
+ * one go.
+ */
+void create_windows(uint32_t count, const xcb_window_t *xcb_windows,
+        xcb_get_window_attributes_reply_t *const *attributes,
+        xcb_get_geometry_reply_t *const *geometries, PropertyWave *waves,
+        Window **windows)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        windows[i] = allocate_window(xcb_windows[i], attributes[i],
+                geometries[i]);
+    }
+
+    link_windows(windows, count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        set_up_window(windows[i], &waves[i]);
+    }
+}
+
 /* Attempt to close a window. If it is the first time, use a friendly method by
  * sending a close request to the window. Call this function again within
  * `REQUEST_CLOSE_MAX_DURATION` to forcefully kill it.
@@ -165,11 +375,11 @@ void close_window(Window *window)
     /* if either `WM_DELETE_WINDOW` is not supported or a close was requested
      * twice in a row
      */
-    if (!supports_protocol(window, ATOM(WM_DELETE_WINDOW)) ||
+    if (!supports_protocol(window, WM_DELETE_WINDOW) ||
             (window->state.was_close_requested && current_time <=
                 window->state.user_request_close_time +
                     REQUEST_CLOSE_MAX_DURATION)) {
-        xcb_kill_client(connection, window->client.id);
+        x_backend->kill_client(window->client.id);
         return;
     }
 
@@ -181,8 +391,7 @@ void close_window(Window *window)
     event->format = 32;
     memset(&event->data, 0, sizeof(event->data));
     event->data.data32[0] = ATOM(WM_DELETE_WINDOW);
-    xcb_send_event(connection, false, window->client.id,
-            XCB_EVENT_MASK_NO_EVENT, event_data);
+    x_backend->send_event(window->client.id, event_data);
 
     window->state.was_close_requested = true;
     window->state.user_request_close_time = current_time;
@@ -219,6 +428,10 @@ void destroy_window(Window *window)
      * happen because usually a MapUnnotify event hides the window beforehand
      */
     hide_window_abruptly(window);
+    /* the client must leave the pending client list, the window is already
+     * gone from the server so nothing is sent
+     */
+    drop_client(&window->client);
 
     /* exceptional state, this should never happen */
     if (window == focus_window) {
@@ -230,6 +443,7 @@ void destroy_window(Window *window)
     frame = get_frame_of_window(window);
     if (frame != NULL) {
         frame->window = NULL;
+        window->frame = NULL;
         LOG_ERROR("window being destroyed is still within a frame\n");
     }
 
@@ -239,33 +453,69 @@ void destroy_window(Window *window)
     unlink_window_from_z_list(window);
 
     /* remove from the age linked list */
-    if (oldest_window == window) {
-        oldest_window = oldest_window->newer;
+    if (window->older != NULL) {
+        window->older->newer = window->newer;
     } else {
-        previous = oldest_window;
-        while (previous->newer != window) {
-            previous = previous->newer;
-        }
-        previous->newer = window->newer;
+        oldest_window = window->newer;
+    }
+    if (window->newer != NULL) {
+        window->newer->older = window->older;
+    } else {
+        newest_window = window->older;
     }
 
     /* remove from the number linked list */
-    if (first_window == window) {
-        first_window = first_window->next;
+    if (window->previous != NULL) {
+        window->previous->next = window->next;
     } else {
-        previous = first_window;
-        while (previous->next != window) {
-            previous = previous->next;
+        first_window = window->next;
+    }
+    if (window->next != NULL) {
+        window->next->previous = window->previous;
+    }
+    release_window_number(window);
+
+    remove_window_from_map(window);
+
+    /* remove from the dirty linked list */
+    if (window->dirty != 0) {
+        if (first_dirty_window == window) {
+            first_dirty_window = window->next_dirty;
+        } else {
+            previous = first_dirty_window;
+            while (previous->next_dirty != window) {
+                previous = previous->next_dirty;
+            }
+            previous->next_dirty = window->next_dirty;
         }
-        previous->next = window->next;
     }
 
     has_client_list_changed = true;
 
+    forget_properties(window->client.id);
+
     free(window->name);
-    free(window->protocols);
-    free(window->states);
-    free(window);
+    free(window->unknown_states);
+    free_pool_object(&window_pool, window);
+}
+
+/* Mark that @window changed in a way that needs to be synchronized. */
+void mark_window_dirty(Window *window, uint32_t flags)
+{
+    /* the monitor struts depend on the position, visibility and strut of all
+     * windows with strut
+     */
+    if ((flags & WINDOW_DIRTY_STRUT) ||
+            ((flags & (WINDOW_DIRTY_GEOMETRY | WINDOW_DIRTY_VISIBILITY)) &&
+                !is_strut_empty(&window->strut))) {
+        are_monitor_struts_dirty = true;
+    }
+
+    if (window->dirty == 0) {
+        window->next_dirty = first_dirty_window;
+        first_dirty_window = window;
+    }
+    window->dirty |= flags;
 }
 
 /* Adjust given @x and @y such that it follows the @window_gravity. */
@@ -407,6 +657,8 @@ void set_window_size(Window *window, int32_t x, int32_t y, uint32_t width,
     window->y = y;
     window->width = width;
     window->height = height;
+
+    mark_window_dirty(window, WINDOW_DIRTY_GEOMETRY);
 }
 
 /* Put the window on the best suited Z stack position. */
@@ -420,7 +672,7 @@ void update_window_layer(Window *window)
         LOG("setting window %W below all other windows\n", window);
 
         general_values[0] = XCB_STACK_MODE_BELOW;
-        xcb_configure_window(connection, window->client.id,
+        x_backend->configure_window(window->client.id,
                 XCB_CONFIG_WINDOW_STACK_MODE, general_values);
 
         /* link onto the bottom of the Z linked list */
@@ -436,7 +688,7 @@ void update_window_layer(Window *window)
         LOG("setting window %W above all other windows\n", window);
 
         general_values[0] = XCB_STACK_MODE_ABOVE;
-        xcb_configure_window(connection, window->client.id,
+        x_backend->configure_window(window->client.id,
                 XCB_CONFIG_WINDOW_STACK_MODE, general_values);
 
         /* link onto the top of the Z linked list */
@@ -451,7 +703,7 @@ void update_window_layer(Window *window)
         if (below->transient_for == window->client.id) {
             general_values[0] = window->client.id;
             general_values[1] = XCB_STACK_MODE_ABOVE;
-            xcb_configure_window(connection, window->client.id,
+            x_backend->configure_window(window->client.id,
                     XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE,
                     general_values);
 
@@ -475,51 +727,115 @@ void update_window_layer(Window *window)
 /* Get the internal window that has the associated xcb window. */
 Window *get_window_of_xcb_window(xcb_window_t xcb_window)
 {
-    for (Window *window = first_window; window != NULL;
-            window = window->next) {
+    uint32_t mask;
+    uint32_t index;
+    Window *window;
+
+    if (window_map.count == 0) {
+        return NULL;
+    }
+
+    mask = window_map.capacity - 1;
+    index = hash_xcb_window(xcb_window) & mask;
+    while (window = window_map.buckets[index], window != NULL) {
         if (window->client.id == xcb_window) {
             return window;
         }
+        index = (index + 1) & mask;
     }
     return NULL;
 }
 
-/* Checks if @frame contains @window and checks this for all its children. */
-static Frame *find_frame_recursively(Frame *frame, const Window *window)
+/* Get a handle that refers to @window. */
+WindowHandle get_window_handle(const Window *window)
 {
-    if (frame->window == window) {
-        return frame;
+    WindowHandle handle;
+
+    if (window == NULL) {
+        return NULL_WINDOW_HANDLE;
     }
+    handle.number = window->number;
+    handle.generation = window_numbers.generations[window->number -
+        FIRST_WINDOW_NUMBER];
+    return handle;
+}
+
+/* Get the window @handle refers to. */
+Window *get_window_of_handle(WindowHandle handle)
+{
+    uint32_t index;
 
-    if (frame->left == NULL) {
+    if (handle.number < FIRST_WINDOW_NUMBER) {
         return NULL;
     }
-
-    Frame *const find = find_frame_recursively(frame->left, window);
-    if (find != NULL) {
-        return find;
+    index = handle.number - FIRST_WINDOW_NUMBER;
+    if (index >= window_numbers.capacity ||
+            window_numbers.generations[index] != handle.generation) {
+        return NULL;
     }
-    
-    return find_frame_recursively(frame->right, window);
+    return window_numbers.slots[index];
 }
 
 /* Get the frame this window is contained in. */
 Frame *get_frame_of_window(const Window *window)
 {
-    /* shortcut: only tiling windows are within a frame */
-    if (window->state.mode != WINDOW_MODE_TILING) {
-        return NULL;
+    return window->frame;
+}
+
+#ifdef DEBUG
+/* Check that all windows within @frame and its children point back to the
+ * frame they are in.
+ *
+ * @return the number of windows within @frame.
+ */
+static uint32_t check_inner_window_frames(Frame *frame)
+{
+    if (frame->left != NULL) {
+        return check_inner_window_frames(frame->left) +
+            check_inner_window_frames(frame->right);
+    }
+    if (frame->window == NULL) {
+        return 0;
+    }
+    if (frame->window->frame != frame) {
+        LOG_ERROR("window %W is in frame %F but points to %F\n",
+                frame->window, frame, frame->window->frame);
     }
+    return 1;
+}
+
+/* Check that the frame of each window matches the frame trees. */
+void check_window_frames(void)
+{
+    uint32_t tree_count = 0, window_count = 0;
 
     for (Monitor *monitor = first_monitor; monitor != NULL;
             monitor = monitor->next) {
-        Frame *const find = find_frame_recursively(monitor->frame, window);
-        if (find != NULL) {
-            return find;
+        tree_count += check_inner_window_frames(monitor->frame);
+    }
+
+    for (Window *window = first_window; window != NULL;
+            window = window->next) {
+        if (window->frame == NULL) {
+            continue;
+        }
+        window_count++;
+        if (window->frame->window != window) {
+            LOG_ERROR("window %W points to frame %F which does not contain "
+                        "it\n", window, window->frame);
+        }
+        if (window->state.mode != WINDOW_MODE_TILING) {
+            LOG_ERROR("window %W is not tiling but in frame %F\n", window,
+                    window->frame);
         }
     }
-    return NULL;
+
+    if (tree_count != window_count) {
+        LOG_ERROR("%" PRIu32 " windows are in the frame trees but %" PRIu32
+                    " windows point to a frame\n", tree_count, window_count);
+    }
 }
+#endif
 
 /* Check if @window accepts input focus. */
 bool does_window_accept_focus(Window *window)
@@ -528,7 +844,7 @@ bool does_window_accept_focus(Window *window)
         return false;
     }
 
-    if (supports_protocol(window, ATOM(WM_TAKE_FOCUS))) {
+    if (supports_protocol(window, WM_TAKE_FOCUS)) {
         return true;
     }
 
@@ -539,12 +855,13 @@ bool does_window_accept_focus(Window *window)
 /* Remove any focus indication from @window. */
 static inline void lose_focus(Window *window)
 {
-    xcb_atom_t state_atom;
+    uint32_t state;
 
     focus_window->border_color = configuration.border.color;
+    mark_window_dirty(focus_window, WINDOW_DIRTY_BORDER);
 
-    state_atom = ATOM(_NET_WM_STATE_FOCUSED);
-    remove_window_states(window, &state_atom, 1);
+    state = _NET_WM_STATE_FOCUSED;
+    remove_window_states(window, &state, 1);
 }
 
 /* Set the window that is in focus to @window. */
@@ -581,4 +898,5 @@ void set_focus_window(Window *window)
     focus_window = window;
 
     window->border_color = configuration.border.focus_color;
+    mark_window_dirty(window, WINDOW_DIRTY_BORDER);
 }
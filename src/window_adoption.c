@@ -0,0 +1,471 @@
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+
+#include "audit.h"
+#include "configuration.h"
+#include "event_capture.h"
+#include "frame.h"
+#include "log.h"
+#include "window.h"
+#include "window_adoption.h"
+#include "xalloc.h"
+
+/* Windows are adopted in stages so that the event loop never has to block:
+ * first the window attributes and geometry are requested to decide whether
+ * the window should be managed at all, then all properties are requested in a
+ * single wave and once those arrived, the window is created.
+ */
+
+/* the stage an adoption is in */
+typedef enum adoption_stage {
+    /* waiting for the window attributes and geometry */
+    ADOPTION_STAGE_ATTRIBUTES,
+    /* waiting for the window properties */
+    ADOPTION_STAGE_PROPERTIES,
+} adoption_stage_t;
+
+/* a window that is in the process of being adopted */
+struct adoption {
+    /* the X window that is adopted */
+    xcb_window_t xcb_window;
+    /* the current stage of the adoption */
+    adoption_stage_t stage;
+    /* if the window should be shown once it is adopted */
+    bool is_map_requested;
+    /* sequence numbers of the attributes and geometry requests */
+    uint32_t attributes_sequence;
+    uint32_t geometry_sequence;
+    /* if the attributes and geometry replies were received */
+    bool has_attributes;
+    bool has_geometry;
+    /* the received replies, NULL on error */
+    xcb_get_window_attributes_reply_t *attributes;
+    xcb_get_geometry_reply_t *geometry;
+    /* if the window was mapped or unmapped after the attributes were
+     * requested, the map state of the reply is outdated then
+     */
+    bool has_map_state;
+    /* if the last map notification said the window is mapped */
+    bool is_mapped;
+    /* the requested window properties */
+    PropertyWave wave;
+    /* the next adoption in the queue */
+    struct adoption *next;
+};
+
+/* the first and last adoption of the pending adoption queue */
+static struct adoption *first_adoption, *last_adoption;
+
+/* the number of windows that are currently being adopted */
+uint32_t number_of_adoptions;
+
+/* Find the pending adoption of @xcb_window.
+ *
+ * @return NULL if the window is not being adopted.
+ */
+static struct adoption *find_adoption(xcb_window_t xcb_window)
+{
+    for (struct adoption *adoption = first_adoption; adoption != NULL;
+            adoption = adoption->next) {
+        if (adoption->xcb_window == xcb_window) {
+            return adoption;
+        }
+    }
+    return NULL;
+}
+
+/* Start adopting the X window @xcb_window without blocking. */
+void adopt_window(xcb_window_t xcb_window, bool is_map_requested)
+{
+    struct adoption *adoption;
+
+    /* a replay has no server to answer, the adoptions are part of the
+     * capture instead
+     */
+    if (is_replaying_events) {
+        return;
+    }
+
+    adoption = find_adoption(xcb_window);
+    if (adoption != NULL) {
+        adoption->is_map_requested |= is_map_requested;
+        return;
+    }
+
+    adoption = xcalloc(1, sizeof(*adoption));
+    adoption->xcb_window = xcb_window;
+    adoption->stage = ADOPTION_STAGE_ATTRIBUTES;
+    adoption->is_map_requested = is_map_requested;
+    adoption->attributes_sequence =
+        x_backend->get_window_attributes(xcb_window);
+    adoption->geometry_sequence = x_backend->get_geometry(xcb_window);
+
+    /* append to the end of the queue so windows are adopted in order */
+    if (last_adoption == NULL) {
+        first_adoption = adoption;
+    } else {
+        last_adoption->next = adoption;
+    }
+    last_adoption = adoption;
+
+    number_of_adoptions++;
+
+    LOG("adopting window %w (%" PRIu32 " adoptions in flight)\n",
+            xcb_window, number_of_adoptions);
+}
+
+/* Remove @adoption from the queue and free all its resources.
+ *
+ * @previous is the adoption before @adoption in the queue.
+ */
+static void drop_adoption(struct adoption *adoption, struct adoption *previous)
+{
+    if (previous == NULL) {
+        first_adoption = adoption->next;
+    } else {
+        previous->next = adoption->next;
+    }
+    if (last_adoption == adoption) {
+        last_adoption = previous;
+    }
+
+    if (!adoption->has_attributes) {
+        x_backend->discard_reply(adoption->attributes_sequence);
+    }
+    if (!adoption->has_geometry) {
+        x_backend->discard_reply(adoption->geometry_sequence);
+    }
+    clear_property_wave(&adoption->wave);
+    free(adoption->attributes);
+    free(adoption->geometry);
+    free(adoption);
+
+    number_of_adoptions--;
+}
+
+/* Check if @sequence is not older than the request with @request_sequence.
+ *
+ * Event sequence numbers only have 16 bits so the comparison is done on the
+ * lower 16 bits.
+ */
+static inline bool is_sequence_after(uint16_t sequence,
+        unsigned request_sequence)
+{
+    return (uint16_t) (sequence - (uint16_t) request_sequence) < 0x8000;
+}
+
+/* Handle a property change of a window that is being adopted. */
+static void handle_property_notify(xcb_property_notify_event_t *event)
+{
+    struct adoption *adoption;
+    uint32_t properties;
+    uint32_t stale_properties = 0;
+
+    adoption = find_adoption(event->window);
+    /* the properties are not requested before the properties stage */
+    if (adoption == NULL || adoption->stage != ADOPTION_STAGE_PROPERTIES) {
+        return;
+    }
+
+    properties = get_properties_of_atom(event->atom);
+    /* check if the property changed after the server already replied to our
+     * request, in that case the reply is outdated
+     */
+    for (window_property_t i = 0; i < WINDOW_PROPERTY_MAX; i++) {
+        if ((properties & WINDOW_PROPERTY_BIT(i)) && is_sequence_after(
+                    event->sequence, adoption->wave.sequences[i])) {
+            stale_properties = properties;
+            break;
+        }
+    }
+
+    if (stale_properties != 0) {
+        LOG("property %a of adopted window %w changed, requesting again\n",
+                event->atom, event->window);
+        request_window_properties(&adoption->wave, event->window,
+                stale_properties);
+    }
+}
+
+/* Remember that the window of @adoption was mapped or unmapped if this
+ * happened after the attributes were requested.
+ */
+static void note_adoption_map_state(struct adoption *adoption,
+        uint16_t sequence, bool is_mapped)
+{
+    if (!is_sequence_after(sequence, adoption->attributes_sequence)) {
+        return;
+    }
+    adoption->has_map_state = true;
+    adoption->is_mapped = is_mapped;
+}
+
+/* Handle an incoming event for the windows that are being adopted. */
+void handle_adoption_event(xcb_generic_event_t *event)
+{
+    struct adoption *adoption, *previous = NULL;
+
+    if (first_adoption == NULL) {
+        return;
+    }
+
+    /* remove the most significant bit, this gets the actual event type */
+    switch ((event->response_type & ~0x80)) {
+    /* a window that is adopted does not want to be shown anymore */
+    case XCB_UNMAP_NOTIFY:
+        adoption = find_adoption(((xcb_unmap_notify_event_t*) event)->window);
+        if (adoption != NULL) {
+            adoption->is_map_requested = false;
+            note_adoption_map_state(adoption, event->sequence, false);
+        }
+        break;
+
+    /* a window that is adopted was shown by someone else */
+    case XCB_MAP_NOTIFY:
+        adoption = find_adoption(((xcb_map_notify_event_t*) event)->window);
+        if (adoption != NULL) {
+            note_adoption_map_state(adoption, event->sequence, true);
+        }
+        break;
+
+    /* a window that is adopted is gone */
+    case XCB_DESTROY_NOTIFY:
+        for (adoption = first_adoption; adoption != NULL;
+                adoption = adoption->next) {
+            if (adoption->xcb_window ==
+                    ((xcb_destroy_notify_event_t*) event)->window) {
+                LOG("window %w was destroyed while being adopted\n",
+                        adoption->xcb_window);
+                drop_adoption(adoption, previous);
+                break;
+            }
+            previous = adoption;
+        }
+        break;
+
+    /* a property of a window changed */
+    case XCB_PROPERTY_NOTIFY:
+        handle_property_notify((xcb_property_notify_event_t*) event);
+        break;
+    }
+}
+
+/* Check the @attributes and @geometry of @xcb_window and request all window
+ * properties if the window should be managed.
+ *
+ * @return false if the window should not be managed.
+ */
+static bool request_adoption_properties(xcb_window_t xcb_window,
+        const xcb_get_window_attributes_reply_t *attributes,
+        const xcb_get_geometry_reply_t *geometry, PropertyWave *wave)
+{
+    if (attributes == NULL) {
+        LOG_ERROR("could not get window attributes of %w\n", xcb_window);
+        return false;
+    }
+    /* override redirect is used by windows to indicate that our window manager
+     * should not tamper with them, we also check if the class is InputOnly
+     * which is not a case we want to handle
+     */
+    if (attributes->override_redirect ||
+            attributes->_class == XCB_WINDOW_CLASS_INPUT_ONLY) {
+        return false;
+    }
+
+    if (geometry == NULL) {
+        LOG_ERROR("could not get window geometry of %w\n", xcb_window);
+        return false;
+    }
+
+    /* set the border color */
+    general_values[0] = configuration.border.color;
+    /* we want to know if if any properties change */
+    general_values[1] = XCB_EVENT_MASK_PROPERTY_CHANGE;
+    x_backend->change_window_attributes(xcb_window,
+            XCB_CW_BORDER_PIXEL | XCB_CW_EVENT_MASK, general_values);
+
+    /* request all properties at once, properties that are not set simply get
+     * an empty reply
+     */
+    request_window_properties(wave, xcb_window, WINDOW_PROPERTY_ALL);
+    return true;
+}
+
+/* Create the window of @xcb_window from the received replies and show it if
+ * needed.
+ */
+void finish_window_adoption(xcb_window_t xcb_window, bool is_map_requested,
+        const xcb_get_window_attributes_reply_t *attributes,
+        const xcb_get_geometry_reply_t *geometry, PropertyWave *wave)
+{
+    Window *window;
+
+    /* the window might have been created through other means */
+    if (get_window_of_xcb_window(xcb_window) != NULL) {
+        return;
+    }
+
+    capture_adoption(xcb_window, is_map_requested, attributes, geometry, wave);
+
+    window = create_window(xcb_window, attributes, geometry, wave);
+
+    if (is_map_requested || window->client.is_mapped) {
+        show_window(window);
+        if (is_map_requested && does_window_accept_focus(window)) {
+            set_focus_window_with_frame(window);
+        }
+    }
+}
+
+/* Check for replies of @adoption without blocking and advance it.
+ *
+ * @return true if the adoption is done.
+ */
+static bool progress_adoption(struct adoption *adoption)
+{
+    void *reply;
+
+    switch (adoption->stage) {
+    case ADOPTION_STAGE_ATTRIBUTES:
+        if (!adoption->has_attributes && x_backend->poll_for_reply(
+                    adoption->attributes_sequence, &reply)) {
+            adoption->attributes = reply;
+            adoption->has_attributes = true;
+        }
+        if (!adoption->has_geometry && x_backend->poll_for_reply(
+                    adoption->geometry_sequence, &reply)) {
+            adoption->geometry = reply;
+            adoption->has_geometry = true;
+        }
+        if (!adoption->has_attributes || !adoption->has_geometry) {
+            return false;
+        }
+        if (!request_adoption_properties(adoption->xcb_window,
+                    adoption->attributes, adoption->geometry,
+                    &adoption->wave)) {
+            return true;
+        }
+        adoption->stage = ADOPTION_STAGE_PROPERTIES;
+        /* fall through */
+
+    case ADOPTION_STAGE_PROPERTIES:
+        if (!poll_window_properties(&adoption->wave)) {
+            return false;
+        }
+        /* the map notifications are newer than the reply */
+        if (adoption->has_map_state) {
+            adoption->attributes->map_state = adoption->is_mapped ?
+                XCB_MAP_STATE_VIEWABLE : XCB_MAP_STATE_UNMAPPED;
+        }
+        finish_window_adoption(adoption->xcb_window,
+                adoption->is_map_requested, adoption->attributes,
+                adoption->geometry, &adoption->wave);
+        return true;
+    }
+    return false;
+}
+
+/* Check for replies of the pending adoptions without blocking. */
+void process_pending_adoptions(void)
+{
+    struct adoption *adoption, *next, *previous = NULL;
+
+    for (adoption = first_adoption; adoption != NULL; adoption = next) {
+        next = adoption->next;
+        if (progress_adoption(adoption)) {
+            drop_adoption(adoption, previous);
+        } else {
+            previous = adoption;
+        }
+    }
+}
+
+/* Adopt all given X windows at once and wait until they are adopted. */
+void adopt_windows_now(const xcb_window_t *xcb_windows, uint32_t count)
+{
+    struct timespec start, end;
+    uint32_t *attributes_sequences;
+    uint32_t *geometry_sequences;
+    xcb_window_t *adopted_windows;
+    xcb_get_window_attributes_reply_t **attributes;
+    xcb_get_geometry_reply_t **geometries;
+    PropertyWave *waves;
+    Window **windows;
+    uint32_t number_of_adopted = 0;
+    uint64_t duration;
+
+    if (count == 0) {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* first wave: send the attributes and geometry requests of all windows */
+    attributes_sequences = xmalloc(sizeof(*attributes_sequences) * count);
+    geometry_sequences = xmalloc(sizeof(*geometry_sequences) * count);
+    for (uint32_t i = 0; i < count; i++) {
+        attributes_sequences[i] =
+            x_backend->get_window_attributes(xcb_windows[i]);
+        geometry_sequences[i] = x_backend->get_geometry(xcb_windows[i]);
+    }
+
+    /* collect them and send the property requests of all windows that should
+     * be managed, this is the second wave
+     */
+    adopted_windows = xmalloc(sizeof(*adopted_windows) * count);
+    attributes = xmalloc(sizeof(*attributes) * count);
+    geometries = xmalloc(sizeof(*geometries) * count);
+    waves = xcalloc(count, sizeof(*waves));
+    for (uint32_t i = 0; i < count; i++) {
+        attributes[number_of_adopted] = AUDIT_REPLY(attributes_sequences[i],
+                x_backend->wait_for_reply(attributes_sequences[i]));
+        geometries[number_of_adopted] = AUDIT_REPLY(geometry_sequences[i],
+                x_backend->wait_for_reply(geometry_sequences[i]));
+        if (get_window_of_xcb_window(xcb_windows[i]) == NULL &&
+                request_adoption_properties(xcb_windows[i],
+                    attributes[number_of_adopted],
+                    geometries[number_of_adopted],
+                    &waves[number_of_adopted])) {
+            adopted_windows[number_of_adopted] = xcb_windows[i];
+            number_of_adopted++;
+        } else {
+            free(attributes[number_of_adopted]);
+            free(geometries[number_of_adopted]);
+        }
+    }
+
+    for (uint32_t i = 0; i < number_of_adopted; i++) {
+        collect_window_properties(&waves[i]);
+        capture_adoption(adopted_windows[i], false, attributes[i],
+                geometries[i], &waves[i]);
+    }
+
+    /* create all windows and link them in one go */
+    windows = xmalloc(sizeof(*windows) * MAX(number_of_adopted, 1));
+    create_windows(number_of_adopted, adopted_windows, attributes, geometries,
+            waves, windows);
+
+    for (uint32_t i = 0; i < number_of_adopted; i++) {
+        if (windows[i]->client.is_mapped) {
+            show_window(windows[i]);
+        }
+        free(attributes[i]);
+        free(geometries[i]);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    duration = (end.tv_sec - start.tv_sec) * UINT64_C(1000000) +
+        (end.tv_nsec - start.tv_nsec) / 1000;
+    LOG("adopted %" PRIu32 " of %" PRIu32 " existing windows in "
+                "%" PRIu64 ".%03" PRIu64 " ms\n",
+            number_of_adopted, count, duration / 1000, duration % 1000);
+
+    free(windows);
+    free(waves);
+    free(geometries);
+    free(attributes);
+    free(adopted_windows);
+    free(geometry_sequences);
+    free(attributes_sequences);
+}
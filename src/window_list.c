@@ -6,6 +6,7 @@
 #include <X11/keysym.h>
 #include <xcb/xcb_keysyms.h>
 
+#include "audit.h"
 #include "configuration.h"
 #include "event.h"
 #include "fensterchef.h"
@@ -27,17 +28,16 @@ int initialize_window_list(void)
     xcb_generic_error_t *error;
     const char *window_list_name = "[fensterchef] window list";
 
-    window_list.client.id = xcb_generate_id(connection);
+    window_list.client.id = x_backend->generate_id();
     /* indicate to not manage the window */
     general_values[0] = true;
     /* get key press events, focus change events and expose events */
     general_values[1] = XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_EXPOSURE |
         XCB_EVENT_MASK_FOCUS_CHANGE;
-    error = xcb_request_check(connection, xcb_create_window_checked(connection,
-                XCB_COPY_FROM_PARENT, window_list.client.id,
-                screen->root, -1, -1, 1, 1, 0,
-                XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT,
-                XCB_CW_OVERRIDE_REDIRECT | XCB_CW_EVENT_MASK, general_values));
+    error = AUDIT(x_backend->create_window_checked(window_list.client.id,
+                -1, -1, 1, 1, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                XCB_CW_OVERRIDE_REDIRECT | XCB_CW_EVENT_MASK,
+                general_values));
     if (error != NULL) {
         LOG_ERROR("could not create window list window: %E\n", error);
         free(error);
@@ -47,7 +47,8 @@ int initialize_window_list(void)
     window_list.client.y = -1;
     window_list.client.width = 1;
     window_list.client.height = 1;
-    xcb_icccm_set_wm_name(connection, window_list.client.id,
+    mark_client_committed(&window_list.client);
+    x_backend->change_property(window_list.client.id, XCB_ATOM_WM_NAME,
             ATOM(UTF8_STRING), 8, strlen(window_list_name), window_list_name);
     return OK;
 }
@@ -83,10 +84,12 @@ static void render_window_list(void)
     xcb_rectangle_t         rectangle;
     xcb_render_color_t      background_color;
     xcb_render_picture_t    pen;
+    Window                  *selected;
 
     /* measure the maximum needed width and get the index of the currently
      * selected window
      */
+    selected = get_window_of_handle(window_list.selected);
     window_count = 0;
     measure.ascent = 12;
     measure.descent = -4;
@@ -96,7 +99,7 @@ static void render_window_list(void)
             continue;
         }
 
-        if (window_list.selected == window) {
+        if (selected == window) {
             index = window_count;
         }
 
@@ -143,6 +146,8 @@ static void render_window_list(void)
             max_width + configuration.notification.padding / 2,
             maximum_item * height_per_item,
             window_list.client.border_width);
+    /* the new size must be known before rendering */
+    commit_client(&window_list.client);
 
     /* render the items showing the window names */
     rectangle.x = 0;
@@ -166,7 +171,7 @@ static void render_window_list(void)
         }
 
         /* use normal or inverted colors */
-        if (window != window_list.selected) {
+        if (window != selected) {
             pen = stock_objects[STOCK_BLACK_PEN];
             convert_color_to_xcb_color(&background_color,
                     configuration.notification.background);
@@ -223,10 +228,13 @@ static Window *get_valid_window_after(Window *last_valid, Window *start)
 /* Handle a key press for the window list window. */
 static void handle_key_press(xcb_key_press_event_t *event)
 {
+    Window *selected;
+
     if (event->event != window_list.client.id) {
         return;
     }
 
+    selected = get_window_of_handle(window_list.selected);
     switch (get_keysym(event->detail)) {
     /* cancel selection */
     case XK_q:
@@ -238,13 +246,12 @@ static void handle_key_press(xcb_key_press_event_t *event)
     /* confirm selection */
     case XK_y:
     case XK_Return:
-        if (window_list.selected != NULL &&
-                window_list.selected != focus_window) {
+        if (selected != NULL && selected != focus_window) {
             /* put floating windows on the top */
-            update_window_layer(window_list.selected);
+            update_window_layer(selected);
 
-            show_window(window_list.selected);
-            set_focus_window_with_frame(window_list.selected);
+            show_window(selected);
+            set_focus_window_with_frame(selected);
 
             window_list.should_revert_focus = false;
         }
@@ -253,13 +260,12 @@ static void handle_key_press(xcb_key_press_event_t *event)
 
     /* go to the first item */
     case XK_Home:
-        window_list.selected = get_valid_window_after(NULL, first_window);
+        selected = get_valid_window_after(NULL, first_window);
         break;
 
     /* go to the last item */
     case XK_End:
-        window_list.selected = get_valid_window_before(window_list.selected,
-                first_window, NULL);
+        selected = get_valid_window_before(selected, first_window, NULL);
         break;
 
     /* go to the previous item */
@@ -267,8 +273,8 @@ static void handle_key_press(xcb_key_press_event_t *event)
     case XK_k:
     case XK_Left:
     case XK_Up:
-        window_list.selected = get_valid_window_before(window_list.selected,
-                first_window, window_list.selected);
+        selected = get_valid_window_before(selected, first_window,
+                selected);
         break;
 
     /* go to the next item */
@@ -276,10 +282,11 @@ static void handle_key_press(xcb_key_press_event_t *event)
     case XK_j:
     case XK_Right:
     case XK_Down:
-        window_list.selected = get_valid_window_after(window_list.selected,
-                window_list.selected->next);
+        selected = get_valid_window_after(selected,
+                selected == NULL ? first_window : selected->next);
         break;
     }
+    window_list.selected = get_window_handle(selected);
 }
 
 /* Handle a FocusOut event. */
@@ -299,8 +306,7 @@ static void handle_focus_out(xcb_focus_out_event_t *event)
     }
 
     /* refocus the window list */
-    xcb_set_input_focus(connection, XCB_INPUT_FOCUS_POINTER_ROOT,
-            window_list.client.id, XCB_CURRENT_TIME);
+    x_backend->set_input_focus(window_list.client.id);
 }
 
 /* Handle an UnmapNotify event. */
@@ -325,11 +331,12 @@ static void handle_destroy_notify(xcb_destroy_notify_event_t *event)
 
     Window *const window = get_window_of_xcb_window(
             ((xcb_unmap_notify_event_t*) event)->window);
+    Window *const selected = get_window_of_handle(window_list.selected);
     /* if the currently selected window is destroyed, select a different one */
-    if (window == window_list.selected) {
-        window_list.selected = get_valid_window_before(
-                get_valid_window_after(NULL, window_list.selected->next),
-                first_window, window_list.selected);
+    if (window != NULL && window == selected) {
+        window_list.selected = get_window_handle(get_valid_window_before(
+                get_valid_window_after(NULL, selected->next),
+                first_window, selected));
     }
 }
 
@@ -393,19 +400,20 @@ int show_window_list(void)
         return ERROR;
     }
 
-    window_list.selected = selected;
+    window_list.selected = get_window_handle(selected);
     window_list.should_revert_focus = true;
 
     /* show the window list window on screen */
     map_client(&window_list.client);
+    /* the window must be mapped before it can be focused */
+    commit_client(&window_list.client);
 
     /* raise the window */
     general_values[0] = XCB_STACK_MODE_ABOVE;
-    xcb_configure_window(connection, window_list.client.id,
+    x_backend->configure_window(window_list.client.id,
             XCB_CONFIG_WINDOW_STACK_MODE, general_values);
 
     /* focus the window list */
-    xcb_set_input_focus(connection, XCB_INPUT_FOCUS_POINTER_ROOT,
-            window_list.client.id, XCB_CURRENT_TIME);
+    x_backend->set_input_focus(window_list.client.id);
     return OK;
 }
@@ -224,95 +224,76 @@ static void synchronize_allowed_actions(Window *window)
         }
     }
 
-    xcb_change_property(connection, XCB_PROP_MODE_REPLACE,
-            window->client.id, ATOM(_NET_WM_ALLOWED_ACTIONS),
+    set_property(window->client.id, ATOM(_NET_WM_ALLOWED_ACTIONS),
             XCB_ATOM_ATOM, 32, list_length, list);
 }
 
-/* Add window states to the window properties. */
-void add_window_states(Window *window, xcb_atom_t *states,
-        uint32_t number_of_states)
+/* Write the known and unknown states of @window to `_NET_WM_STATE`. */
+static void synchronize_window_states(Window *window)
 {
-    uint32_t effective_count = 0;
-
-    /* for each state in `states`, either add it or filter it out */
-    for (uint32_t i = 0, j; i < number_of_states; i++) {
-        /* filter out the states already in the window properties */
-        if (has_state(window, states[i])) {
-            continue;
-        }
-
-        j = 0;
+    /* the atoms of the property value */
+    static struct {
+        /* the atom list */
+        xcb_atom_t *atoms;
+        /* the number of allocated atoms */
+        uint32_t capacity;
+    } list;
+
+    uint32_t length = 0;
+
+    if (list.capacity < ATOM_MAX + window->number_of_unknown_states) {
+        list.capacity = ATOM_MAX + window->number_of_unknown_states;
+        RESIZE(list.atoms, list.capacity);
+    }
 
-        /* add the state to the window properties */
-        if (window->states != NULL) {
-            /* find the number of elements */
-            for (; window->states[j] != XCB_NONE; j++) {
-                /* nothing */
-            }
+    for (uint32_t i = 0; i < ATOM_SET_WORDS; i++) {
+        for (uint64_t bits = window->states.bits[i]; bits != 0;
+                bits &= bits - 1) {
+            list.atoms[length++] = ATOM(i * 64 + __builtin_ctzll(bits));
         }
-
-        RESIZE(window->states, j + 2);
-        window->states[j] = states[i];
-        window->states[j + 1] = XCB_NONE;
-
-        states[effective_count++] = states[i];
     }
-
-    /* check if anything changed */
-    if (effective_count == 0) {
-        return;
+    for (uint32_t i = 0; i < window->number_of_unknown_states; i++) {
+        list.atoms[length++] = window->unknown_states[i];
     }
 
-    /* append the properties to the list in the X server */
-    xcb_change_property(connection, XCB_PROP_MODE_APPEND,
-            window->client.id, ATOM(_NET_WM_STATE),
-            XCB_ATOM_ATOM, 32, effective_count, states);
+    set_property(window->client.id, ATOM(_NET_WM_STATE), XCB_ATOM_ATOM, 32,
+            length, list.atoms);
 }
 
-/* Remove window states from the window properties. */
-void remove_window_states(Window *window, xcb_atom_t *states,
+/* Add window states to the window properties. */
+void add_window_states(Window *window, const uint32_t *states,
         uint32_t number_of_states)
 {
-    uint32_t i;
-    uint32_t effective_count = 0;
+    bool has_changed = false;
 
-    /* if no states are there, nothing can be removed */
-    if (window->states == NULL) {
-        return;
+    for (uint32_t i = 0; i < number_of_states; i++) {
+        if (!has_state(window, states[i])) {
+            add_to_atom_set(&window->states, states[i]);
+            has_changed = true;
+        }
     }
 
-    /* filter out all states in the window properties that are in `states` */
-    for (i = 0; window->states[i] != XCB_NONE; i++) {
-        uint32_t j;
+    if (has_changed) {
+        synchronize_window_states(window);
+    }
+}
 
-        /* check if the state exists in `states`... */
-        for (j = 0; j < number_of_states; j++) {
-            if (states[j] == window->states[i]) {
-                break;
-            }
-        }
+/* Remove window states from the window properties. */
+void remove_window_states(Window *window, const uint32_t *states,
+        uint32_t number_of_states)
+{
+    bool has_changed = false;
 
-        /* ...if not, add it */
-        if (j == number_of_states) {
-            window->states[effective_count++] =
-                window->states[i];
+    for (uint32_t i = 0; i < number_of_states; i++) {
+        if (has_state(window, states[i])) {
+            remove_from_atom_set(&window->states, states[i]);
+            has_changed = true;
         }
     }
 
-    /* check if anything changed */
-    if (effective_count == i) {
-        return;
+    if (has_changed) {
+        synchronize_window_states(window);
     }
-
-    /* terminate the end with `XCB_NONE` */
-    window->states[effective_count] = XCB_NONE;
-
-    /* replace the atom list on the X server */
-    xcb_change_property(connection, XCB_PROP_MODE_REPLACE,
-            window->client.id, ATOM(_NET_WM_STATE),
-            XCB_ATOM_ATOM, 32, effective_count,
-            window->states);
 }
 
 /* Changes the window state to given value and reconfigures the window only
@@ -320,7 +301,7 @@ void remove_window_states(Window *window, xcb_atom_t *states,
  */
 void set_window_mode(Window *window, window_mode_t mode)
 {
-    xcb_atom_t states[3];
+    uint32_t states[3];
 
     if (window->state.mode == mode) {
         return;
@@ -340,11 +321,9 @@ void set_window_mode(Window *window, window_mode_t mode)
     if (window->state.is_visible) {
         /* pop out from tiling layout */
         if (window->state.previous_mode == WINDOW_MODE_TILING) {
-            /* make sure no shortcut is taken in `get_frame_of_window()` */
-            window->state.mode = WINDOW_MODE_TILING;
-            Frame *const frame = get_frame_of_window(window);
-            window->state.mode = mode;
+            Frame *const frame = window->frame;
             frame->window = NULL;
+            window->frame = NULL;
             if (configuration.tiling.auto_fill_void) {
                 fill_void_with_stash(frame);
             }
@@ -355,6 +334,7 @@ void set_window_mode(Window *window, window_mode_t mode)
         case WINDOW_MODE_TILING:
             stash_frame(focus_frame);
             focus_frame->window = window;
+            window->frame = focus_frame;
             reload_frame(focus_frame);
             break;
 
@@ -381,14 +361,14 @@ void set_window_mode(Window *window, window_mode_t mode)
 
     /* update the window states */
     if (mode == WINDOW_MODE_FULLSCREEN) {
-        states[0] = ATOM(_NET_WM_STATE_FULLSCREEN);
-        states[1] = ATOM(_NET_WM_STATE_MAXIMIZED_HORZ);
-        states[2] = ATOM(_NET_WM_STATE_MAXIMIZED_VERT);
+        states[0] = _NET_WM_STATE_FULLSCREEN;
+        states[1] = _NET_WM_STATE_MAXIMIZED_HORZ;
+        states[2] = _NET_WM_STATE_MAXIMIZED_VERT;
         add_window_states(window, states, SIZE(states));
     } else if (window->state.previous_mode == WINDOW_MODE_FULLSCREEN) {
-        states[0] = ATOM(_NET_WM_STATE_FULLSCREEN);
-        states[1] = ATOM(_NET_WM_STATE_MAXIMIZED_HORZ);
-        states[2] = ATOM(_NET_WM_STATE_MAXIMIZED_VERT);
+        states[0] = _NET_WM_STATE_FULLSCREEN;
+        states[1] = _NET_WM_STATE_MAXIMIZED_HORZ;
+        states[2] = _NET_WM_STATE_MAXIMIZED_VERT;
         remove_window_states(window, states, SIZE(states));
     }
 
@@ -398,6 +378,7 @@ void set_window_mode(Window *window, window_mode_t mode)
     } else {
         window->border_size = 0;
     }
+    mark_window_dirty(window, WINDOW_DIRTY_BORDER);
 
     update_window_layer(window);
 
@@ -423,6 +404,7 @@ void show_window(Window *window)
         }
         stash_frame(focus_frame);
         focus_frame->window = window;
+        window->frame = focus_frame;
         reload_frame(focus_frame);
     } break;
 
@@ -447,6 +429,7 @@ void show_window(Window *window)
     }
 
     window->state.is_visible = true;
+    mark_window_dirty(window, WINDOW_DIRTY_VISIBILITY);
 }
 
 /* Hide @window and adjust the tiling and focus. */
@@ -515,6 +498,7 @@ void hide_window(Window *window)
     }
 
     window->state.is_visible = false;
+    mark_window_dirty(window, WINDOW_DIRTY_VISIBILITY);
 }
 
 /* Hide the window without touching the tiling or focus. */
@@ -526,6 +510,7 @@ void hide_window_abruptly(Window *window)
     }
 
     window->state.is_visible = false;
+    mark_window_dirty(window, WINDOW_DIRTY_VISIBILITY);
 
     /* make sure there is no invalid focus window */
     if (window == focus_window) {
@@ -1,9 +1,14 @@
 #include <inttypes.h>
 #include <string.h>
 
+#include <xcb/xcbext.h> // xcb_poll_for_reply
+
+#include "audit.h"
 #include "log.h"
 #include "fensterchef.h"
+#include "flight_recorder.h"
 #include "window.h"
+#include "window_adoption.h"
 #include "window_list.h"
 #include "x11_management.h"
 
@@ -44,12 +49,64 @@ xcb_window_t wm_check_window;
 /* user notification window */
 XClient notification;
 
+/* the number of requests that were not sent because a later change of the
+ * same client replaced them before committing
+ */
+uint64_t number_of_suppressed_requests;
+
+/* the number of property changes that were not sent */
+uint64_t number_of_suppressed_properties;
+
+/* the first client with changes that are not committed yet */
+static XClient *first_pending_client;
+
 struct x_atoms x_atoms[] = {
 #define X(atom) { #atom, 0 },
     DEFINE_ALL_ATOMS
 #undef X
 };
 
+/* the number of buckets of the atom index, this is a power of two that is
+ * more than twice as large as `ATOM_MAX`
+ */
+#define ATOM_INDEX_CAPACITY 256
+
+/* Hash map from atom identifiers to atom constants. It uses open addressing
+ * with linear probing, an empty bucket has the atom `XCB_NONE`.
+ */
+static struct atom_index_entry {
+    /* the atom identifier */
+    xcb_atom_t atom;
+    /* the atom constant */
+    uint32_t id;
+} atom_index[ATOM_INDEX_CAPACITY];
+
+/* Get the bucket @atom starts probing at. */
+static inline uint32_t hash_atom(xcb_atom_t atom)
+{
+    uint32_t hash;
+
+    hash = atom * UINT32_C(0x9e3779b1);
+    return (hash ^ (hash >> 16)) & (ATOM_INDEX_CAPACITY - 1);
+}
+
+/* Put @atom with its constant @id into the atom index. */
+static void add_atom_to_index(xcb_atom_t atom, uint32_t id)
+{
+    uint32_t index;
+
+    index = hash_atom(atom);
+    while (atom_index[index].atom != XCB_NONE) {
+        /* the same name was interned twice */
+        if (atom_index[index].atom == atom) {
+            return;
+        }
+        index = (index + 1) & (ATOM_INDEX_CAPACITY - 1);
+    }
+    atom_index[index].atom = atom;
+    atom_index[index].id = id;
+}
+
 /* Initialize the X server connection and the X atoms. */
 int initialize_x11(void)
 {
@@ -105,7 +162,8 @@ int initialize_x11(void)
      * server assigned for us
      */
     for (uint32_t i = 0; i < ATOM_MAX; i++) {
-        atom = xcb_intern_atom_reply(connection, atom_cookies[i], &error);
+        atom = AUDIT_XCB_REPLY(atom_cookies[i], &error,
+                xcb_intern_atom_reply(connection, atom_cookies[i], &error));
         if (atom == NULL) {
             LOG_ERROR("could not intern atom %s: %E", x_atoms[i].name, error);
             free(error);
@@ -113,10 +171,204 @@ int initialize_x11(void)
         }
         x_atoms[i].atom = atom->atom;
         free(atom);
+
+        add_atom_to_index(x_atoms[i].atom, i);
     }
     return OK;
 }
 
+/* Use @atoms as values of the X atoms instead of interning them. */
+void set_atoms(const xcb_atom_t *atoms)
+{
+    memset(atom_index, 0, sizeof(atom_index));
+    for (uint32_t i = 0; i < ATOM_MAX; i++) {
+        x_atoms[i].atom = atoms[i];
+        add_atom_to_index(atoms[i], i);
+    }
+}
+
+/* Get the atom constant of @atom. */
+uint32_t get_atom_id(xcb_atom_t atom)
+{
+    uint32_t index;
+
+    if (atom == XCB_NONE) {
+        return ATOM_MAX;
+    }
+
+    index = hash_atom(atom);
+    while (atom_index[index].atom != XCB_NONE) {
+        if (atom_index[index].atom == atom) {
+            return atom_index[index].id;
+        }
+        index = (index + 1) & (ATOM_INDEX_CAPACITY - 1);
+    }
+    return ATOM_MAX;
+}
+
+/* Get an identifier for a new resource from the server. */
+static uint32_t server_generate_id(void)
+{
+    return xcb_generate_id(connection);
+}
+
+/* Create a child window of the root on the server. */
+static xcb_generic_error_t *server_create_window_checked(xcb_window_t window,
+        int32_t x, int32_t y, uint32_t width, uint32_t height,
+        uint16_t window_class, uint32_t value_mask, const uint32_t *values)
+{
+    return xcb_request_check(connection, xcb_create_window_checked(connection,
+                XCB_COPY_FROM_PARENT, window, screen->root, x, y, width,
+                height, 0, window_class, XCB_COPY_FROM_PARENT, value_mask,
+                values));
+}
+
+/* Change the attributes of a window on the server. */
+static void server_change_window_attributes(xcb_window_t window,
+        uint32_t value_mask, const uint32_t *values)
+{
+    xcb_change_window_attributes(connection, window, value_mask, values);
+}
+
+/* Change the attributes of a window on the server and wait for it. */
+static xcb_generic_error_t *server_change_window_attributes_checked(
+        xcb_window_t window, uint32_t value_mask, const uint32_t *values)
+{
+    return xcb_request_check(connection,
+            xcb_change_window_attributes_checked(connection, window,
+                value_mask, values));
+}
+
+/* Configure a window on the server. */
+static void server_configure_window(xcb_window_t window, uint16_t value_mask,
+        const uint32_t *values)
+{
+    xcb_configure_window(connection, window, value_mask, values);
+}
+
+/* Map a window on the server. */
+static void server_map_window(xcb_window_t window)
+{
+    xcb_map_window(connection, window);
+}
+
+/* Unmap a window on the server. */
+static void server_unmap_window(xcb_window_t window)
+{
+    xcb_unmap_window(connection, window);
+}
+
+/* Replace a property on the server. */
+static void server_change_property(xcb_window_t window, xcb_atom_t property,
+        xcb_atom_t type, uint8_t format, uint32_t length, const void *data)
+{
+    xcb_change_property(connection, XCB_PROP_MODE_REPLACE, window, property,
+            type, format, length, data);
+}
+
+/* Set the input focus on the server. */
+static void server_set_input_focus(xcb_window_t window)
+{
+    xcb_set_input_focus(connection, XCB_INPUT_FOCUS_POINTER_ROOT, window,
+            XCB_CURRENT_TIME);
+}
+
+/* Send an event to a window through the server. */
+static void server_send_event(xcb_window_t window, const char *event)
+{
+    xcb_send_event(connection, false, window, XCB_EVENT_MASK_NO_EVENT, event);
+}
+
+/* Kill the client owning a window on the server. */
+static void server_kill_client(xcb_window_t window)
+{
+    xcb_kill_client(connection, window);
+}
+
+/* Request the attributes of a window from the server. */
+static uint32_t server_get_window_attributes(xcb_window_t window)
+{
+    return xcb_get_window_attributes(connection, window).sequence;
+}
+
+/* Request the geometry of a window from the server. */
+static uint32_t server_get_geometry(xcb_window_t window)
+{
+    return xcb_get_geometry(connection, window).sequence;
+}
+
+/* Request a property of a window from the server. */
+static uint32_t server_get_property(xcb_window_t window, xcb_atom_t property,
+        xcb_atom_t type, uint32_t length)
+{
+    return xcb_get_property(connection, false, window, property, type, 0,
+            length).sequence;
+}
+
+/* Request the children of a window from the server. */
+static uint32_t server_query_tree(xcb_window_t window)
+{
+    return xcb_query_tree(connection, window).sequence;
+}
+
+/* Check if the server replied to a request. */
+static bool server_poll_for_reply(uint32_t sequence, void **reply)
+{
+    return xcb_poll_for_reply(connection, sequence, reply, NULL) != 0;
+}
+
+/* Wait for the server to reply to a request. */
+static void *server_wait_for_reply(uint32_t sequence)
+{
+    return xcb_wait_for_reply(connection, sequence, NULL);
+}
+
+/* Drop the reply of the server to a request. */
+static void server_discard_reply(uint32_t sequence)
+{
+    xcb_discard_reply(connection, sequence);
+}
+
+/* Get the next event the server sent. */
+static xcb_generic_event_t *server_poll_for_event(void)
+{
+    return xcb_poll_for_event(connection);
+}
+
+/* Send all buffered requests to the server. */
+static void server_flush(void)
+{
+    xcb_flush(connection);
+}
+
+/* the backend talking to the X server over `connection` */
+const XBackend server_backend = {
+    .generate_id = server_generate_id,
+    .create_window_checked = server_create_window_checked,
+    .change_window_attributes = server_change_window_attributes,
+    .change_window_attributes_checked =
+        server_change_window_attributes_checked,
+    .configure_window = server_configure_window,
+    .map_window = server_map_window,
+    .unmap_window = server_unmap_window,
+    .change_property = server_change_property,
+    .set_input_focus = server_set_input_focus,
+    .send_event = server_send_event,
+    .kill_client = server_kill_client,
+    .get_window_attributes = server_get_window_attributes,
+    .get_geometry = server_get_geometry,
+    .get_property = server_get_property,
+    .query_tree = server_query_tree,
+    .poll_for_reply = server_poll_for_reply,
+    .wait_for_reply = server_wait_for_reply,
+    .discard_reply = server_discard_reply,
+    .poll_for_event = server_poll_for_event,
+    .flush = server_flush,
+};
+
+/* the backend all window management requests go through */
+const XBackend *x_backend = &server_backend;
+
 /* Create the check, notification and window list windows. */
 static int create_utility_windows(void)
 {
@@ -126,36 +378,31 @@ static int create_utility_windows(void)
     /* create the wm check window, this can be used by other applications to
      * identify our window manager, we also use it as fallback focus
      */
-    wm_check_window = xcb_generate_id(connection);
-    error = xcb_request_check(connection, xcb_create_window_checked(connection,
-                XCB_COPY_FROM_PARENT, wm_check_window,
-                screen->root, -1, -1, 1, 1, 0,
-                XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT,
-                0, NULL));
+    wm_check_window = x_backend->generate_id();
+    error = AUDIT(x_backend->create_window_checked(wm_check_window,
+                -1, -1, 1, 1, XCB_WINDOW_CLASS_INPUT_ONLY, 0, NULL));
     if (error != NULL) {
         LOG_ERROR("could not create check window: %E\n", error);
         free(error);
         return ERROR;
     }
     /* set the check window name to the name of fensterchef */
-    xcb_icccm_set_wm_name(connection, wm_check_window,
+    x_backend->change_property(wm_check_window, XCB_ATOM_WM_NAME,
             ATOM(UTF8_STRING), 8, strlen(FENSTERCHEF_NAME), FENSTERCHEF_NAME);
     /* the check window has itself as supporting wm check window */
-    xcb_change_property(connection, XCB_PROP_MODE_REPLACE,
-            wm_check_window, ATOM(_NET_SUPPORTING_WM_CHECK),
-            XCB_ATOM_WINDOW, 32, 1, &wm_check_window);
+    x_backend->change_property(wm_check_window,
+            ATOM(_NET_SUPPORTING_WM_CHECK), XCB_ATOM_WINDOW, 32, 1,
+            &wm_check_window);
 
     /* map the window so it can receive focus */
-    xcb_map_window(connection, wm_check_window);
+    x_backend->map_window(wm_check_window);
 
     /* create a notification window for showing the user messages */
-    notification.id = xcb_generate_id(connection);
+    notification.id = x_backend->generate_id();
     /* indicate to not manage the window */
     general_values[0] = true;
-    error = xcb_request_check(connection, xcb_create_window_checked(connection,
-                XCB_COPY_FROM_PARENT, notification.id,
-                screen->root, -1, -1, 1, 1, 0,
-                XCB_WINDOW_CLASS_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT,
+    error = AUDIT(x_backend->create_window_checked(notification.id,
+                -1, -1, 1, 1, XCB_WINDOW_CLASS_COPY_FROM_PARENT,
                 XCB_CW_OVERRIDE_REDIRECT, general_values));
     if (error != NULL) {
         LOG_ERROR("could not create notification window: %E\n", error);
@@ -166,7 +413,8 @@ static int create_utility_windows(void)
     notification.y = -1;
     notification.width = 1;
     notification.height = 1;
-    xcb_icccm_set_wm_name(connection, notification.id,
+    mark_client_committed(&notification);
+    x_backend->change_property(notification.id, XCB_ATOM_WM_NAME,
             ATOM(UTF8_STRING), 8, strlen(notification_name), notification_name);
 
     /* create the window list */
@@ -185,8 +433,7 @@ int take_control(void)
      * map requests
      */
     general_values[0] = ROOT_EVENT_MASK;
-    error = xcb_request_check(connection,
-            xcb_change_window_attributes_checked(connection, screen->root,
+    error = AUDIT(x_backend->change_window_attributes_checked(screen->root,
                 XCB_CW_EVENT_MASK, general_values));
     if (error != NULL) {
         LOG_ERROR("could not change root window mask: %E\n", error);
@@ -200,24 +447,22 @@ int take_control(void)
     }
 
     /* intialize the focus */
-    xcb_set_input_focus(connection, XCB_INPUT_FOCUS_POINTER_ROOT,
-            wm_check_window, XCB_CURRENT_TIME);
+    x_backend->set_input_focus(wm_check_window);
     return OK;
 }
 
 /* Go through all existing windows and manage them. */
 void query_existing_windows(void)
 {
-    xcb_query_tree_cookie_t tree_cookie;
+    uint32_t tree_sequence;
     xcb_query_tree_reply_t *tree;
     xcb_window_t *windows;
     int length;
-    Window *window;
 
     /* get a list of child windows of the root in bottom-to-top stacking order
      */
-    tree_cookie = xcb_query_tree(connection, screen->root);
-    tree = xcb_query_tree_reply(connection, tree_cookie, NULL);
+    tree_sequence = x_backend->query_tree(screen->root);
+    tree = AUDIT(x_backend->wait_for_reply(tree_sequence));
     /* not sure what this implies, maybe the connection is broken */
     if (tree == NULL) {
         return;
@@ -225,12 +470,7 @@ void query_existing_windows(void)
 
     windows = xcb_query_tree_children(tree);
     length = xcb_query_tree_children_length(tree);
-    for (int i = 0; i < length; i++) {
-        window = create_window(windows[i]);
-        if (window != NULL && window->client.is_mapped) {
-            show_window(window);
-        }
-    }
+    adopt_windows_now(windows, length);
 
     free(tree);
 }
@@ -297,27 +537,25 @@ void initialize_root_properties(void)
 
         ATOM(_NET_WM_FULLSCREEN_MONITORS),
     };
-    xcb_change_property(connection, XCB_PROP_MODE_REPLACE, screen->root,
-            ATOM(_NET_SUPPORTED), XCB_ATOM_ATOM, 32,
-            SIZE(supported_atoms), supported_atoms);
+    x_backend->change_property(screen->root, ATOM(_NET_SUPPORTED),
+            XCB_ATOM_ATOM, 32, SIZE(supported_atoms), supported_atoms);
 
     /* the wm check window */
-    xcb_change_property(connection, XCB_PROP_MODE_REPLACE,
-            screen->root, ATOM(_NET_SUPPORTING_WM_CHECK), XCB_ATOM_WINDOW,
-            32, 1, &wm_check_window);
+    x_backend->change_property(screen->root, ATOM(_NET_SUPPORTING_WM_CHECK),
+            XCB_ATOM_WINDOW, 32, 1, &wm_check_window);
 
 
     /* set the active window */
-    xcb_change_property(connection, XCB_PROP_MODE_REPLACE, screen->root,
-            ATOM(_NET_ACTIVE_WINDOW), XCB_ATOM_WINDOW, 32, 1, &screen->root);
+    set_property(screen->root, ATOM(_NET_ACTIVE_WINDOW), XCB_ATOM_WINDOW, 32,
+            1, &screen->root);
 
     /* set the work area */
     const Rectangle workarea = {
         0, 0,
         screen->width_in_pixels, screen->height_in_pixels
     };
-    xcb_change_property(connection, XCB_PROP_MODE_REPLACE, screen->root,
-            ATOM(_NET_WORKAREA), XCB_ATOM_CARDINAL, 32, 4, &workarea);
+    set_property(screen->root, ATOM(_NET_WORKAREA), XCB_ATOM_CARDINAL, 32, 4,
+            &workarea);
 }
 
 /* Set the input focus to @window. This window may be `NULL`. */
@@ -325,7 +563,7 @@ void set_input_focus(Window *window)
 {
     xcb_window_t focus_id = XCB_NONE;
     xcb_window_t active_id;
-    xcb_atom_t state_atom;
+    uint32_t state;
 
     if (window == NULL) {
         LOG("removed focus from all windows\n");
@@ -335,10 +573,13 @@ void set_input_focus(Window *window)
     } else {
         active_id = window->client.id;
 
-        state_atom = ATOM(_NET_WM_STATE_FOCUSED);
-        add_window_states(window, &state_atom, 1);
+        /* a window can only be focused when it is mapped */
+        commit_client(&window->client);
+
+        state = _NET_WM_STATE_FOCUSED;
+        add_window_states(window, &state, 1);
 
-        if (supports_protocol(window, ATOM(WM_TAKE_FOCUS))) {
+        if (supports_protocol(window, WM_TAKE_FOCUS)) {
             char event_data[32];
             xcb_client_message_event_t *event;
 
@@ -351,51 +592,74 @@ void set_input_focus(Window *window)
             memset(&event->data, 0, sizeof(event->data));
             event->data.data32[0] = ATOM(WM_TAKE_FOCUS);
             event->data.data32[1] = XCB_CURRENT_TIME;
-            xcb_send_event(connection, false, window->client.id,
-                    XCB_EVENT_MASK_NO_EVENT, event_data);
+            x_backend->send_event(window->client.id, event_data);
         } else {
             focus_id = window->client.id;
         }
     }
 
     if (focus_id != XCB_NONE) {
-        xcb_set_input_focus(connection, XCB_INPUT_FOCUS_POINTER_ROOT,
-                focus_id, XCB_CURRENT_TIME);
+        x_backend->set_input_focus(focus_id);
     }
 
-    xcb_change_property(connection, XCB_PROP_MODE_REPLACE, screen->root,
-            ATOM(_NET_ACTIVE_WINDOW), XCB_ATOM_WINDOW, 32, 1, &active_id);
+    set_property(screen->root, ATOM(_NET_ACTIVE_WINDOW), XCB_ATOM_WINDOW, 32,
+            1, &active_id);
+}
+
+/* Take the current state of @client as the state the server already has. */
+void mark_client_committed(XClient *client)
+{
+    client->committed.is_mapped = client->is_mapped;
+    client->committed.x = client->x;
+    client->committed.y = client->y;
+    client->committed.width = client->width;
+    client->committed.height = client->height;
+    client->committed.border_width = client->border_width;
+    client->committed.border_color = client->border_color;
+}
+
+/* Put @client into the pending client list and count the request it would
+ * have needed.
+ *
+ * The count is reverted when the request is actually sent, so what remains are
+ * the requests that were suppressed.
+ */
+static void record_client_change(XClient *client)
+{
+    number_of_suppressed_requests++;
+    if (client->is_pending) {
+        return;
+    }
+    client->is_pending = true;
+    client->next_pending = first_pending_client;
+    first_pending_client = client;
 }
 
-/* Show the client on the X server. */
+/* Show the client on the X server once it is committed. */
 void map_client(XClient *client)
 {
     if (client->is_mapped) {
         return;
     }
 
-    LOG("showing client %w\n", client->id);
-
     client->is_mapped = true;
 
-    xcb_map_window(connection, client->id);
+    record_client_change(client);
 }
 
-/* Hide the client on the X server. */
+/* Hide the client on the X server once it is committed. */
 void unmap_client(XClient *client)
 {
     if (!client->is_mapped) {
         return;
     }
 
-    LOG("hiding client %w\n", client->id);
-
     client->is_mapped = false;
 
-    xcb_unmap_window(connection, client->id);
+    record_client_change(client);
 }
 
-/* Set the size of a window associated to the X server. */
+/* Set the size of a window associated to the X server once it is committed. */
 void configure_client(XClient *client, int32_t x, int32_t y, uint32_t width,
         uint32_t height, uint32_t border_width)
 {
@@ -404,80 +668,640 @@ void configure_client(XClient *client, int32_t x, int32_t y, uint32_t width,
         return;
     }
 
-    LOG("configuring client %w to %R %" PRIu32 "\n", client->id,
-            x, y, width, height, border_width);
-
     client->x = x;
     client->y = y;
     client->width = width;
     client->height = height;
     client->border_width = border_width;
 
-    general_values[0] = x;
-    general_values[1] = y;
-    general_values[2] = width;
-    general_values[3] = height;
-    general_values[4] = border_width;
-    xcb_configure_window(connection, client->id,
-            XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y |
-            XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT |
-            XCB_CONFIG_WINDOW_BORDER_WIDTH, general_values);
+    record_client_change(client);
 }
 
-/* Set the client border color. */
+/* Set the client border color once it is committed. */
 void change_client_attributes(XClient *client, uint32_t border_color)
 {
     if (client->border_color == border_color) {
         return;
     }
+
     client->border_color = border_color;
 
-    LOG("changing attributes of client %w to %#x\n", client->id,
-            (unsigned) border_color);
+    record_client_change(client);
+}
+
+/* Take @client out of the pending client list. */
+static void unlink_pending_client(XClient *client)
+{
+    XClient **pointer;
+
+    if (!client->is_pending) {
+        return;
+    }
+
+    for (pointer = &first_pending_client; *pointer != client;
+            pointer = &(*pointer)->next_pending) {
+        /* nothing */
+    }
+    *pointer = client->next_pending;
+    client->is_pending = false;
+}
+
+/* Drop the changes of @client without sending anything to the server. */
+void drop_client(XClient *client)
+{
+    unlink_pending_client(client);
+    mark_client_committed(client);
+}
+
+/* Send the changes of @client to the server right away. */
+void commit_client(XClient *client)
+{
+    uint32_t mask = 0;
+    uint32_t count = 0;
+    bool has_changes = false;
+
+    unlink_pending_client(client);
+
+    /* hide the client before anything else so no intermediate state becomes
+     * visible
+     */
+    if (!client->is_mapped && client->committed.is_mapped) {
+        LOG("hiding client %w\n", client->id);
+        x_backend->unmap_window(client->id);
+        client->committed.is_mapped = false;
+        number_of_suppressed_requests--;
+        has_changes = true;
+    }
+
+    if (client->x != client->committed.x) {
+        mask |= XCB_CONFIG_WINDOW_X;
+        general_values[count++] = client->x;
+    }
+    if (client->y != client->committed.y) {
+        mask |= XCB_CONFIG_WINDOW_Y;
+        general_values[count++] = client->y;
+    }
+    if (client->width != client->committed.width) {
+        mask |= XCB_CONFIG_WINDOW_WIDTH;
+        general_values[count++] = client->width;
+    }
+    if (client->height != client->committed.height) {
+        mask |= XCB_CONFIG_WINDOW_HEIGHT;
+        general_values[count++] = client->height;
+    }
+    if (client->border_width != client->committed.border_width) {
+        mask |= XCB_CONFIG_WINDOW_BORDER_WIDTH;
+        general_values[count++] = client->border_width;
+    }
+    if (mask != 0) {
+        LOG("configuring client %w to %R %" PRIu32 "\n", client->id,
+                client->x, client->y, client->width, client->height,
+                client->border_width);
+        x_backend->configure_window(client->id, mask, general_values);
+        client->committed.x = client->x;
+        client->committed.y = client->y;
+        client->committed.width = client->width;
+        client->committed.height = client->height;
+        client->committed.border_width = client->border_width;
+        number_of_suppressed_requests--;
+        has_changes = true;
+    }
+
+    if (client->border_color != client->committed.border_color) {
+        LOG("changing attributes of client %w to %#x\n", client->id,
+                (unsigned) client->border_color);
+        general_values[0] = client->border_color;
+        x_backend->change_window_attributes(client->id, XCB_CW_BORDER_PIXEL,
+                general_values);
+        client->committed.border_color = client->border_color;
+        number_of_suppressed_requests--;
+        has_changes = true;
+    }
+
+    /* show the client last so it appears with its new size */
+    if (client->is_mapped && !client->committed.is_mapped) {
+        LOG("showing client %w\n", client->id);
+        x_backend->map_window(client->id);
+        client->committed.is_mapped = true;
+        number_of_suppressed_requests--;
+        has_changes = true;
+    }
+
+    if (has_changes) {
+        record_commit(client);
+    }
+}
+
+/* Commit all clients with changes. */
+void commit_clients(void)
+{
+    uint32_t count = 0;
+
+    if (first_pending_client == NULL) {
+        return;
+    }
+
+    while (first_pending_client != NULL) {
+        commit_client(first_pending_client);
+        count++;
+    }
+
+    LOG_VERBOSE("committed %" PRIu32 " clients, "
+                "%" PRIu64 " requests and %" PRIu64 " property changes "
+                "suppressed so far\n",
+            count, number_of_suppressed_requests,
+            number_of_suppressed_properties);
+}
+
+/* the initial number of buckets of the property cache */
+#define PROPERTY_CACHE_INITIAL_CAPACITY 64
+
+/* a value of a property */
+struct property_value {
+    /* the type of the value */
+    xcb_atom_t type;
+    /* the size of the elements in bits, 0 when the value is unknown */
+    uint8_t format;
+    /* the number of elements */
+    uint32_t length;
+    /* the bytes of the value */
+    char *data;
+    /* the number of allocated bytes */
+    uint32_t capacity;
+};
+
+/* the values set for a single property of a window */
+struct cached_property {
+    /* the window the property is on */
+    xcb_window_t window;
+    /* the property atom */
+    xcb_atom_t property;
+    /* the value that should be on the server */
+    struct property_value wanted;
+    /* the value that is on the server */
+    struct property_value sent;
+    /* the number of PropertyNotify events the changes sent by fensterchef
+     * still cause, any further event is a change by someone else
+     */
+    uint32_t number_of_echoes;
+    /* if this property is in the dirty linked list */
+    bool is_dirty;
+    /* the next property in the bucket */
+    struct cached_property *next;
+    /* the next property that might need to be sent */
+    struct cached_property *next_dirty;
+};
+
+/* Shadow of the properties set by fensterchef. All properties of a window are
+ * within the same bucket so they can be dropped in one go.
+ */
+static struct {
+    /* the buckets, each is a linked list */
+    struct cached_property **buckets;
+    /* the number of buckets, this is always a power of two */
+    uint32_t capacity;
+    /* the number of cached properties */
+    uint32_t count;
+    /* the first property that was set since the last flush */
+    struct cached_property *first_dirty;
+} property_cache;
+
+/* Get the bucket index of @window within the property cache. */
+static inline uint32_t get_property_bucket(xcb_window_t window)
+{
+    uint32_t hash;
+
+    hash = window * UINT32_C(0x9e3779b1);
+    return (hash ^ (hash >> 16)) & (property_cache.capacity - 1);
+}
+
+/* Double the number of buckets of the property cache. */
+static void grow_property_cache(void)
+{
+    struct cached_property **old_buckets;
+    uint32_t old_capacity;
+    struct cached_property *cached, *next;
+    uint32_t index;
+
+    old_buckets = property_cache.buckets;
+    old_capacity = property_cache.capacity;
+
+    property_cache.capacity = old_capacity == 0 ?
+            PROPERTY_CACHE_INITIAL_CAPACITY : old_capacity * 2;
+    property_cache.buckets = xcalloc(property_cache.capacity,
+            sizeof(*property_cache.buckets));
+
+    /* rehash all properties into the new buckets */
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        for (cached = old_buckets[i]; cached != NULL; cached = next) {
+            next = cached->next;
+            index = get_property_bucket(cached->window);
+            cached->next = property_cache.buckets[index];
+            property_cache.buckets[index] = cached;
+        }
+    }
+    free(old_buckets);
+}
+
+/* Find the cache entry for @property of @window.
+ *
+ * @return NULL if the property is not cached.
+ */
+static struct cached_property *find_cached_property(xcb_window_t window,
+        xcb_atom_t property)
+{
+    struct cached_property *cached;
+
+    if (property_cache.capacity == 0) {
+        return NULL;
+    }
+
+    for (cached = property_cache.buckets[get_property_bucket(window)];
+            cached != NULL; cached = cached->next) {
+        if (cached->window == window && cached->property == property) {
+            return cached;
+        }
+    }
+    return NULL;
+}
+
+/* Get the cache entry for @property of @window, create it if it does not
+ * exist yet.
+ */
+static struct cached_property *get_cached_property(xcb_window_t window,
+        xcb_atom_t property)
+{
+    struct cached_property *cached;
+    uint32_t index;
+
+    cached = find_cached_property(window, property);
+    if (cached != NULL) {
+        return cached;
+    }
+
+    /* keep the buckets short */
+    if (property_cache.count >= property_cache.capacity) {
+        grow_property_cache();
+    }
+
+    cached = xcalloc(1, sizeof(*cached));
+    cached->window = window;
+    cached->property = property;
+    index = get_property_bucket(window);
+    cached->next = property_cache.buckets[index];
+    property_cache.buckets[index] = cached;
+    property_cache.count++;
+    return cached;
+}
+
+/* Copy the value into @value. */
+static void store_property_value(struct property_value *value,
+        xcb_atom_t type, uint8_t format, uint32_t length, const void *data)
+{
+    const uint32_t size = length * (format / 8);
+
+    if (size > value->capacity) {
+        value->capacity = size;
+        RESIZE(value->data, value->capacity);
+    }
+    value->type = type;
+    value->format = format;
+    value->length = length;
+    if (size > 0) {
+        memcpy(value->data, data, size);
+    }
+}
+
+/* Check if @value equals given value. */
+static bool is_property_value_equal(const struct property_value *value,
+        xcb_atom_t type, uint8_t format, uint32_t length, const void *data)
+{
+    if (value->type != type || value->format != format ||
+            value->length != length) {
+        return false;
+    }
+    return length == 0 || memcmp(value->data, data, length * (format / 8)) == 0;
+}
+
+/* Set @property of @window to given value once the properties are flushed. */
+void set_property(xcb_window_t window, xcb_atom_t property, xcb_atom_t type,
+        uint8_t format, uint32_t length, const void *data)
+{
+    struct cached_property *cached;
+
+    number_of_suppressed_properties++;
+
+    cached = get_cached_property(window, property);
+    if (cached->wanted.format != 0 && is_property_value_equal(&cached->wanted,
+                type, format, length, data)) {
+        return;
+    }
+
+    store_property_value(&cached->wanted, type, format, length, data);
+    if (!cached->is_dirty) {
+        cached->is_dirty = true;
+        cached->next_dirty = property_cache.first_dirty;
+        property_cache.first_dirty = cached;
+    }
+}
+
+/* Remember that @property of @window has given value on the server. */
+void note_property(xcb_window_t window, xcb_atom_t property, xcb_atom_t type,
+        uint8_t format, uint32_t length, const void *data)
+{
+    struct cached_property *cached;
+
+    cached = get_cached_property(window, property);
+    store_property_value(&cached->sent, type, format, length, data);
+    /* an unsent value stays wanted and is compared again when flushing */
+    if (!cached->is_dirty) {
+        store_property_value(&cached->wanted, type, format, length, data);
+    }
+}
+
+/* Take note that @property of @window changed on the server. */
+void notice_property_change(xcb_window_t window, xcb_atom_t property)
+{
+    struct cached_property *cached;
+
+    cached = find_cached_property(window, property);
+    if (cached == NULL) {
+        return;
+    }
+
+    /* the change was made by fensterchef */
+    if (cached->number_of_echoes > 0) {
+        cached->number_of_echoes--;
+        return;
+    }
+
+    /* someone else changed the property so the remembered value is stale, an
+     * unsent value stays wanted and is sent on the next flush
+     */
+    cached->sent.format = 0;
+    if (!cached->is_dirty) {
+        cached->wanted.format = 0;
+    }
+}
+
+/* Forget all properties remembered for @window. */
+void forget_properties(xcb_window_t window)
+{
+    struct cached_property **pointer, *cached;
+
+    if (property_cache.capacity == 0) {
+        return;
+    }
+
+    /* take the properties of @window out of the dirty list */
+    for (pointer = &property_cache.first_dirty; *pointer != NULL; ) {
+        cached = *pointer;
+        if (cached->window == window) {
+            *pointer = cached->next_dirty;
+        } else {
+            pointer = &cached->next_dirty;
+        }
+    }
+
+    for (pointer = &property_cache.buckets[get_property_bucket(window)];
+            *pointer != NULL; ) {
+        cached = *pointer;
+        if (cached->window != window) {
+            pointer = &cached->next;
+            continue;
+        }
+        *pointer = cached->next;
+        free(cached->wanted.data);
+        free(cached->sent.data);
+        free(cached);
+        property_cache.count--;
+    }
+}
+
+/* Send all properties whose value differs from the last sent value. */
+void flush_properties(void)
+{
+    struct cached_property *cached;
+    struct property_value *wanted;
+
+    while (property_cache.first_dirty != NULL) {
+        cached = property_cache.first_dirty;
+        property_cache.first_dirty = cached->next_dirty;
+        cached->is_dirty = false;
+
+        wanted = &cached->wanted;
+        if (cached->sent.format != 0 && is_property_value_equal(&cached->sent,
+                    wanted->type, wanted->format, wanted->length,
+                    wanted->data)) {
+            continue;
+        }
+
+        x_backend->change_property(cached->window, cached->property,
+                wanted->type, wanted->format, wanted->length, wanted->data);
+        store_property_value(&cached->sent, wanted->type, wanted->format,
+                wanted->length, wanted->data);
+        /* property changes are not selected on the root, there is no echo */
+        if (cached->window != screen->root) {
+            cached->number_of_echoes++;
+        }
+        number_of_suppressed_properties--;
+    }
+}
+
+/* Get the atom, type and length (in 32-bit units) to request @property with.
+ */
+static void get_window_property_request(window_property_t property,
+        xcb_atom_t *atom, xcb_atom_t *type, uint32_t *length)
+{
+    *type = XCB_GET_PROPERTY_TYPE_ANY;
+    *length = UINT32_MAX;
+    switch (property) {
+    case WINDOW_PROPERTY_NET_WM_NAME:
+        *atom = ATOM(_NET_WM_NAME);
+        break;
+
+    case WINDOW_PROPERTY_WM_NAME:
+        *atom = XCB_ATOM_WM_NAME;
+        break;
+
+    case WINDOW_PROPERTY_WM_NORMAL_HINTS:
+        *atom = XCB_ATOM_WM_NORMAL_HINTS;
+        *type = XCB_ATOM_WM_SIZE_HINTS;
+        *length = XCB_ICCCM_NUM_WM_SIZE_HINTS_ELEMENTS;
+        break;
+
+    case WINDOW_PROPERTY_WM_HINTS:
+        *atom = XCB_ATOM_WM_HINTS;
+        *type = XCB_ATOM_WM_HINTS;
+        *length = XCB_ICCCM_NUM_WM_HINTS_ELEMENTS;
+        break;
+
+    case WINDOW_PROPERTY_NET_WM_STRUT_PARTIAL:
+        *atom = ATOM(_NET_WM_STRUT_PARTIAL);
+        *type = XCB_ATOM_CARDINAL;
+        *length = sizeof(wm_strut_partial_t) / sizeof(uint32_t);
+        break;
+
+    case WINDOW_PROPERTY_NET_WM_STRUT:
+        *atom = ATOM(_NET_WM_STRUT);
+        *type = XCB_ATOM_CARDINAL;
+        *length = sizeof(Extents) / sizeof(uint32_t);
+        break;
+
+    case WINDOW_PROPERTY_WM_TRANSIENT_FOR:
+        *atom = XCB_ATOM_WM_TRANSIENT_FOR;
+        *type = XCB_ATOM_WINDOW;
+        *length = 1;
+        break;
+
+    case WINDOW_PROPERTY_WM_PROTOCOLS:
+        *atom = ATOM(WM_PROTOCOLS);
+        *type = XCB_ATOM_ATOM;
+        break;
+
+    case WINDOW_PROPERTY_NET_WM_FULLSCREEN_MONITORS:
+        *atom = ATOM(_NET_WM_FULLSCREEN_MONITORS);
+        *type = XCB_ATOM_CARDINAL;
+        *length = sizeof(Extents) / sizeof(uint32_t);
+        break;
+
+    case WINDOW_PROPERTY_MOTIF_WM_HINTS:
+        *atom = ATOM(_MOTIF_WM_HINTS);
+        *type = ATOM(_MOTIF_WM_HINTS);
+        *length = sizeof(motif_wm_hints_t) / sizeof(uint32_t);
+        break;
+
+    case WINDOW_PROPERTY_NET_WM_STATE:
+        *atom = ATOM(_NET_WM_STATE);
+        *type = XCB_ATOM_ATOM;
+        break;
+
+    case WINDOW_PROPERTY_NET_WM_WINDOW_TYPE:
+        *atom = ATOM(_NET_WM_WINDOW_TYPE);
+        *type = XCB_ATOM_ATOM;
+        break;
+
+    /* not a real property */
+    case WINDOW_PROPERTY_MAX:
+        *atom = XCB_NONE;
+        break;
+    }
+}
+
+/* Send the requests for all properties within @properties without waiting for
+ * any reply.
+ */
+void request_window_properties(PropertyWave *wave, xcb_window_t window,
+        uint32_t properties)
+{
+    xcb_atom_t atom, type;
+    uint32_t length;
+
+    wave->window = window;
+    for (window_property_t i = 0; i < WINDOW_PROPERTY_MAX; i++) {
+        if (!(properties & WINDOW_PROPERTY_BIT(i))) {
+            continue;
+        }
+
+        /* drop a request that is still in flight */
+        if ((wave->properties & ~wave->received & WINDOW_PROPERTY_BIT(i))) {
+            x_backend->discard_reply(wave->sequences[i]);
+        }
+        free(wave->replies[i]);
+        wave->replies[i] = NULL;
+
+        get_window_property_request(i, &atom, &type, &length);
+        wave->sequences[i] = x_backend->get_property(window, atom, type,
+                length);
+    }
+    wave->properties |= properties;
+    wave->received &= ~properties;
+}
+
+/* Check for replies of @wave without blocking. */
+bool poll_window_properties(PropertyWave *wave)
+{
+    void *reply;
+
+    for (window_property_t i = 0; i < WINDOW_PROPERTY_MAX; i++) {
+        if (!(wave->properties & ~wave->received & WINDOW_PROPERTY_BIT(i))) {
+            continue;
+        }
+        if (!x_backend->poll_for_reply(wave->sequences[i], &reply)) {
+            continue;
+        }
+        wave->replies[i] = reply;
+        wave->received |= WINDOW_PROPERTY_BIT(i);
+    }
+    return wave->received == wave->properties;
+}
+
+/* Wait for the replies of all requests within @wave. */
+void collect_window_properties(PropertyWave *wave)
+{
+    for (window_property_t i = 0; i < WINDOW_PROPERTY_MAX; i++) {
+        if ((wave->properties & ~wave->received & WINDOW_PROPERTY_BIT(i))) {
+            wave->replies[i] = AUDIT_REPLY(wave->sequences[i],
+                    x_backend->wait_for_reply(wave->sequences[i]));
+        }
+    }
+    wave->received = wave->properties;
+}
 
-    general_values[0] = border_color;
-    xcb_change_window_attributes(connection, client->id,
-            XCB_CW_BORDER_PIXEL, general_values);
+/* Free all replies within @wave and discard the outstanding replies. */
+void clear_property_wave(PropertyWave *wave)
+{
+    for (window_property_t i = 0; i < WINDOW_PROPERTY_MAX; i++) {
+        if ((wave->properties & ~wave->received & WINDOW_PROPERTY_BIT(i))) {
+            x_backend->discard_reply(wave->sequences[i]);
+        }
+        free(wave->replies[i]);
+        wave->replies[i] = NULL;
+    }
+    wave->properties = 0;
+    wave->received = 0;
 }
 
-/* Wrapper around getting a cookie and reply for a GetProperty request. */
-static inline xcb_get_property_reply_t *get_property(xcb_window_t window,
-        xcb_atom_t property, xcb_atom_t type, uint8_t format, uint32_t length,
-        xcb_generic_error_t **error)
+/* Get the reply of @property within @wave.
+ *
+ * @return NULL if the property is not set or not in the needed format.
+ */
+static xcb_get_property_reply_t *get_wave_property(PropertyWave *wave,
+        window_property_t property, uint8_t format, uint32_t length)
 {
-    xcb_get_property_cookie_t cookie;
     xcb_get_property_reply_t *reply;
+    xcb_atom_t atom, type;
+    uint32_t request_length;
 
-    cookie = xcb_get_property(connection, false, window, property, type, 0,
-            length);
-    reply = xcb_get_property_reply(connection, cookie, error);
-    if (reply == NULL) {
+    reply = wave->replies[property];
+    /* the property is not set at all */
+    if (reply == NULL || reply->type == XCB_NONE) {
         return NULL;
     }
     /* check if the property is in the needed format and if it is long enough */
     if (reply->format != format || (length != UINT32_MAX &&
                 (uint32_t) xcb_get_property_value_length(reply) <
                 length * format / 8)) {
-        LOG("window %w has misformatted property %a\n", window, property);
-        free(reply);
+        get_window_property_request(property, &atom, &type, &request_length);
+        LOG("window %w has misformatted property %a\n", wave->window, atom);
         return NULL;
     }
     return reply;
 }
 
-/* Update the name within @properties. */
-static void update_window_name(Window *window)
+/* Update the name within @window. */
+static void update_window_name(Window *window, PropertyWave *wave)
 {
     xcb_get_property_reply_t *name;
 
     free(window->name);
 
-    name = get_property(window->client.id, ATOM(_NET_WM_NAME),
-            XCB_GET_PROPERTY_TYPE_ANY, 8, UINT32_MAX, NULL);
+    name = get_wave_property(wave, WINDOW_PROPERTY_NET_WM_NAME, 8,
+            UINT32_MAX);
     if (name == NULL) {
         /* fall back to `WM_NAME` */
-        name = get_property(window->client.id, XCB_ATOM_WM_NAME,
-                XCB_GET_PROPERTY_TYPE_ANY, 8, UINT32_MAX, NULL);
+        name = get_wave_property(wave, WINDOW_PROPERTY_WM_NAME, 8,
+                UINT32_MAX);
         if (name == NULL) {
             window->name = NULL;
             return;
@@ -487,53 +1311,48 @@ static void update_window_name(Window *window)
     window->name = (utf8_t*) xstrndup(
             xcb_get_property_value(name),
             xcb_get_property_value_length(name));
-
-    free(name);
 }
 
-/* Update the size_hints within @properties. */
-static void update_window_size_hints(Window *window)
+/* Update the size_hints within @window. */
+static void update_window_size_hints(Window *window, PropertyWave *wave)
 {
-    xcb_get_property_cookie_t size_hints_cookie;
+    xcb_get_property_reply_t *size_hints;
 
-    size_hints_cookie = xcb_icccm_get_wm_size_hints(connection,
-            window->client.id, XCB_ATOM_WM_NORMAL_HINTS);
-    if (!xcb_icccm_get_wm_size_hints_reply(connection, size_hints_cookie,
-                &window->size_hints, NULL)) {
+    size_hints = wave->replies[WINDOW_PROPERTY_WM_NORMAL_HINTS];
+    if (size_hints == NULL || !xcb_icccm_get_wm_size_hints_from_reply(
+                &window->size_hints, size_hints)) {
         window->size_hints.flags = 0;
     }
 }
 
-/* Update the hints within @properties. */
-static void update_window_hints(Window *window)
+/* Update the hints within @window. */
+static void update_window_hints(Window *window, PropertyWave *wave)
 {
-    xcb_get_property_cookie_t hints_cookie;
+    xcb_get_property_reply_t *hints;
 
-    hints_cookie = xcb_icccm_get_wm_hints(connection, window->client.id);
-    if (!xcb_icccm_get_wm_hints_reply(connection, hints_cookie,
-                &window->hints, NULL)) {
+    hints = wave->replies[WINDOW_PROPERTY_WM_HINTS];
+    if (hints == NULL || !xcb_icccm_get_wm_hints_from_reply(&window->hints,
+                hints)) {
         window->hints.flags = 0;
     }
 }
 
-/* Update the strut partial property within @properties. */
-static void update_window_strut(Window *window)
+/* Update the strut partial property within @window. */
+static void update_window_strut(Window *window, PropertyWave *wave)
 {
     wm_strut_partial_t new_strut;
     xcb_get_property_reply_t *strut;
 
     memset(&new_strut, 0, sizeof(new_strut));
 
-    strut = get_property(window->client.id,
-            ATOM(_NET_WM_STRUT_PARTIAL), XCB_ATOM_CARDINAL, 32,
-            sizeof(wm_strut_partial_t) / sizeof(uint32_t), NULL);
+    strut = get_wave_property(wave, WINDOW_PROPERTY_NET_WM_STRUT_PARTIAL, 32,
+            sizeof(wm_strut_partial_t) / sizeof(uint32_t));
     if (strut == NULL) {
         /* `_NET_WM_STRUT` is older than `_NET_WM_STRUT_PARTIAL`, fall back to
          * it when there is no strut partial
          */
-        strut = get_property(window->client.id,
-                ATOM(_NET_WM_STRUT), XCB_ATOM_CARDINAL, 32,
-                sizeof(Extents) / sizeof(uint32_t), NULL);
+        strut = get_wave_property(wave, WINDOW_PROPERTY_NET_WM_STRUT, 32,
+                sizeof(Extents) / sizeof(uint32_t));
         if (strut == NULL) {
             return;
         }
@@ -542,189 +1361,264 @@ static void update_window_strut(Window *window)
         new_strut = *(wm_strut_partial_t*) xcb_get_property_value(strut);
     }
 
-    free(strut);
-
     window->strut = new_strut;
+    mark_window_dirty(window, WINDOW_DIRTY_STRUT);
 }
 
-/* Get a window property as list of atoms. */
-static inline xcb_atom_t *get_atom_list(xcb_window_t window, xcb_atom_t atom)
+/* Put the atoms of @property within @wave into @set.
+ *
+ * The atoms that are not within `DEFINE_ALL_ATOMS` are put into @unknown if it
+ * is not NULL.
+ *
+ * @return the number of unknown atoms.
+ */
+static uint32_t get_atom_set(PropertyWave *wave, window_property_t property,
+        AtomSet *set, xcb_atom_t **unknown)
 {
-    xcb_get_property_cookie_t cookie;
     xcb_get_property_reply_t *reply;
-    xcb_atom_t *atoms;
+    const xcb_atom_t *atoms = NULL;
+    uint32_t length;
+    uint32_t id;
+    uint32_t number_of_unknown = 0;
 
-    cookie = xcb_get_property(connection, 0, window, atom, XCB_ATOM_ATOM,
-            0, UINT32_MAX);
-    reply = xcb_get_property_reply(connection, cookie, NULL);
+    memset(set, 0, sizeof(*set));
+
+    reply = get_wave_property(wave, property, 32, UINT32_MAX);
     if (reply == NULL) {
-        return NULL;
+        length = 0;
+    } else {
+        atoms = xcb_get_property_value(reply);
+        length = xcb_get_property_value_length(reply) / sizeof(*atoms);
+    }
+
+    if (unknown != NULL) {
+        RESIZE(*unknown, length);
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+        id = get_atom_id(atoms[i]);
+        if (id != ATOM_MAX) {
+            add_to_atom_set(set, id);
+        } else if (unknown != NULL) {
+            (*unknown)[number_of_unknown++] = atoms[i];
+        }
+    }
+
+    /* most windows only have known atoms, this frees the list for those */
+    if (unknown != NULL) {
+        RESIZE(*unknown, number_of_unknown);
     }
-    atoms = xmalloc(xcb_get_property_value_length(reply) + sizeof(*atoms));
-    memcpy(atoms, xcb_get_property_value(reply),
-            xcb_get_property_value_length(reply));
-    atoms[xcb_get_property_value_length(reply) / sizeof(xcb_atom_t)] = XCB_NONE;
-    free(reply);
-    return atoms;
+    return number_of_unknown;
 }
 
-/* Update the `transient_for` property within @properties. */
-static void update_window_transient_for(Window *window)
+/* Update the `transient_for` property within @window. */
+static void update_window_transient_for(Window *window, PropertyWave *wave)
 {
-    xcb_get_property_cookie_t transient_for_cookie;
+    xcb_get_property_reply_t *transient_for;
 
-    transient_for_cookie = xcb_icccm_get_wm_transient_for(connection,
-            window->client.id);
-    if (!xcb_icccm_get_wm_transient_for_reply(connection, transient_for_cookie,
-                &window->transient_for, NULL)) {
+    transient_for = wave->replies[WINDOW_PROPERTY_WM_TRANSIENT_FOR];
+    if (transient_for == NULL || !xcb_icccm_get_wm_transient_for_from_reply(
+                &window->transient_for, transient_for)) {
         window->transient_for = XCB_NONE;
     }
 }
 
-/* Update the `protocols` property within @properties. */
-static void update_window_protocols(Window *window)
+/* Update the `protocols` property within @window. */
+static void update_window_protocols(Window *window, PropertyWave *wave)
 {
-    free(window->protocols);
-    window->protocols = get_atom_list(window->client.id,
-            ATOM(WM_PROTOCOLS));
+    get_atom_set(wave, WINDOW_PROPERTY_WM_PROTOCOLS, &window->protocols, NULL);
 }
 
-/* Update the `fullscreen_monitors` property within @properties. */
-static void update_window_fullscreen_monitors(Window *window)
+/* Update the `fullscreen_monitors` property within @window. */
+static void update_window_fullscreen_monitors(Window *window,
+        PropertyWave *wave)
 {
     xcb_get_property_reply_t *monitors;
 
-    monitors = get_property(window->client.id,
-            ATOM(_NET_WM_FULLSCREEN_MONITORS), XCB_ATOM_CARDINAL, 32,
-            sizeof(window->fullscreen_monitors) / sizeof(uint32_t), NULL);
+    monitors = get_wave_property(wave,
+            WINDOW_PROPERTY_NET_WM_FULLSCREEN_MONITORS, 32,
+            sizeof(window->fullscreen_monitors) / sizeof(uint32_t));
     if (monitors == NULL) {
         memset(&window->fullscreen_monitors, 0,
                 sizeof(window->fullscreen_monitors));
     } else {
         window->fullscreen_monitors =
             *(Extents*) xcb_get_property_value(monitors);
-        free(monitors);
     }
 }
 
-/* Update the `motif_wm_hints` within @properties. */
-static void update_motif_wm_hints(Window *window)
+/* Update the `motif_wm_hints` within @window. */
+static void update_motif_wm_hints(Window *window, PropertyWave *wave)
 {
     xcb_get_property_reply_t *motif_wm_hints;
 
-    motif_wm_hints = get_property(window->client.id,
-            ATOM(_MOTIF_WM_HINTS), ATOM(_MOTIF_WM_HINTS), 32,
-            sizeof(window->motif_wm_hints) / sizeof(uint32_t), NULL);
+    motif_wm_hints = get_wave_property(wave, WINDOW_PROPERTY_MOTIF_WM_HINTS, 32,
+            sizeof(window->motif_wm_hints) / sizeof(uint32_t));
     if (motif_wm_hints == NULL) {
         window->motif_wm_hints.flags = 0;
     } else {
         window->motif_wm_hints =
             *(motif_wm_hints_t*) xcb_get_property_value(motif_wm_hints);
-        free(motif_wm_hints);
     }
 }
 
-/* Update the property within @window corresponding to given atom. */
-bool cache_window_property(Window *window, xcb_atom_t atom)
+/* Update the `states` property within @window. */
+static void update_window_states(Window *window, PropertyWave *wave)
 {
-    /* this is spaced out because it was very difficult to read with the eyes */
-    if (atom == XCB_ATOM_WM_NAME || atom == ATOM(_NET_WM_NAME)) {
-
-        update_window_name(window);
-
-    } else if (atom == XCB_ATOM_WM_NORMAL_HINTS ||
-            atom == XCB_ATOM_WM_SIZE_HINTS) {
-
-        update_window_size_hints(window);
-
-    } else if (atom == XCB_ATOM_WM_HINTS) {
-
-        update_window_hints(window);
-
-    } else if (atom == ATOM(_NET_WM_STRUT) ||
-            atom == ATOM(_NET_WM_STRUT_PARTIAL)) {
-
-        update_window_strut(window);
+    xcb_get_property_reply_t *states;
+
+    window->number_of_unknown_states = get_atom_set(wave,
+            WINDOW_PROPERTY_NET_WM_STATE, &window->states,
+            &window->unknown_states);
+
+    /* this is what the server has now, future changes compare against it */
+    states = get_wave_property(wave, WINDOW_PROPERTY_NET_WM_STATE, 32,
+            UINT32_MAX);
+    if (states == NULL) {
+        note_property(window->client.id, ATOM(_NET_WM_STATE), XCB_ATOM_ATOM,
+                32, 0, NULL);
+    } else {
+        note_property(window->client.id, ATOM(_NET_WM_STATE), XCB_ATOM_ATOM,
+                32, xcb_get_property_value_length(states) / sizeof(xcb_atom_t),
+                xcb_get_property_value(states));
+    }
+}
 
-    } else if (atom == XCB_ATOM_WM_TRANSIENT_FOR) {
+/* Update the `types` property within @window. */
+static void update_window_types(Window *window, PropertyWave *wave)
+{
+    get_atom_set(wave, WINDOW_PROPERTY_NET_WM_WINDOW_TYPE, &window->types,
+            NULL);
+}
 
-        update_window_transient_for(window);
+/* Put the properties received in @wave into @window. */
+static void apply_window_properties(Window *window, PropertyWave *wave)
+{
+    /* the functions that update the window properties */
+    static const struct {
+        /* the properties the function reads from the wave */
+        uint32_t properties;
+        /* the function to call when any of the properties is in the wave */
+        void (*update)(Window *window, PropertyWave *wave);
+    } updaters[] = {
+        { WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_NAME) |
+                WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_NAME),
+            update_window_name },
+        { WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_NORMAL_HINTS),
+            update_window_size_hints },
+        { WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_HINTS),
+            update_window_hints },
+        { WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_STRUT_PARTIAL) |
+                WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_STRUT),
+            update_window_strut },
+        { WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_TRANSIENT_FOR),
+            update_window_transient_for },
+        { WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_PROTOCOLS),
+            update_window_protocols },
+        { WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_FULLSCREEN_MONITORS),
+            update_window_fullscreen_monitors },
+        { WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_MOTIF_WM_HINTS),
+            update_motif_wm_hints },
+        { WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_STATE),
+            update_window_states },
+        { WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_WINDOW_TYPE),
+            update_window_types },
+    };
 
-    } else if (atom == ATOM(WM_PROTOCOLS)) {
+    const uint32_t properties = wave->properties;
 
-        update_window_protocols(window);
+    for (uint32_t i = 0; i < SIZE(updaters); i++) {
+        if ((properties & updaters[i].properties)) {
+            updaters[i].update(window, wave);
+        }
+    }
+}
 
-    } else if (atom == ATOM(_NET_WM_FULLSCREEN_MONITORS)) {
+/* Get the properties that need to be fetched again when @atom changes. */
+uint32_t get_properties_of_atom(xcb_atom_t atom)
+{
+    /* the properties of the predefined atoms */
+    static const uint32_t predefined_properties[] = {
+        [XCB_ATOM_WM_NAME] = WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_NAME) |
+            WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_NAME),
+        [XCB_ATOM_WM_NORMAL_HINTS] =
+            WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_NORMAL_HINTS),
+        [XCB_ATOM_WM_SIZE_HINTS] =
+            WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_NORMAL_HINTS),
+        [XCB_ATOM_WM_HINTS] = WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_HINTS),
+        [XCB_ATOM_WM_TRANSIENT_FOR] =
+            WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_TRANSIENT_FOR),
+    };
 
-        update_window_fullscreen_monitors(window);
+    /* the properties of the atoms within `DEFINE_ALL_ATOMS` */
+    static const uint32_t atom_properties[ATOM_MAX] = {
+        [_NET_WM_NAME] = WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_NAME) |
+            WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_NAME),
+        [_NET_WM_STRUT] =
+            WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_STRUT_PARTIAL) |
+            WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_STRUT),
+        [_NET_WM_STRUT_PARTIAL] =
+            WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_STRUT_PARTIAL) |
+            WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_STRUT),
+        [WM_PROTOCOLS] = WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_WM_PROTOCOLS),
+        [_NET_WM_FULLSCREEN_MONITORS] =
+            WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_NET_WM_FULLSCREEN_MONITORS),
+        [_MOTIF_WM_HINTS] = WINDOW_PROPERTY_BIT(WINDOW_PROPERTY_MOTIF_WM_HINTS),
+    };
 
-    } else if (atom == ATOM(_MOTIF_WM_HINTS)) {
+    uint32_t id;
 
-        update_motif_wm_hints(window);
+    if (atom < SIZE(predefined_properties)) {
+        return predefined_properties[atom];
+    }
 
-    } else {
-        return false;
+    id = get_atom_id(atom);
+    if (id == ATOM_MAX) {
+        return 0;
     }
-    return true;
+    return atom_properties[id];
 }
 
-/* Check if an atom is within the given list of atoms. */
-static bool is_atom_included(const xcb_atom_t *atoms, xcb_atom_t atom)
+/* Update the property within @window corresponding to given atom. */
+bool cache_window_property(Window *window, xcb_atom_t atom)
 {
-    if (atoms == NULL) {
+    uint32_t properties;
+    PropertyWave wave;
+
+    properties = get_properties_of_atom(atom);
+    if (properties == 0) {
         return false;
     }
-    for (; atoms[0] != XCB_NONE; atoms++) {
-        if (atoms[0] == atom) {
-            return true;
-        }
-    }
-    return false;
+
+    memset(&wave, 0, sizeof(wave));
+    request_window_properties(&wave, window->client.id, properties);
+    collect_window_properties(&wave);
+    apply_window_properties(window, &wave);
+    clear_property_wave(&wave);
+    return true;
 }
 
-/* Initialize all properties within @properties. */
-window_mode_t initialize_window_properties(Window *window)
+/* Guess the mode @window should initially be in from its properties. */
+static window_mode_t guess_window_mode(Window *window, PropertyWave *wave)
 {
-    xcb_list_properties_cookie_t list_properties_cookie;
-    xcb_list_properties_reply_t *list_properties;
-    xcb_atom_t *atoms;
-    int atom_count;
-    xcb_atom_t *states = NULL;
-    xcb_atom_t *types = NULL;
-    window_mode_t predicted_mode = WINDOW_MODE_TILING;
+    bool has_types;
+    window_mode_t mode = WINDOW_MODE_TILING;
 
-    /* get a list of properties currently set on the window */
-    list_properties_cookie = xcb_list_properties(connection, window->client.id);
-    list_properties = xcb_list_properties_reply(connection,
-            list_properties_cookie, NULL);
-    if (list_properties == NULL) {
-        return predicted_mode;
-    }
-
-    /* cache all properties */
-    atoms = xcb_list_properties_atoms(list_properties);
-    atom_count = xcb_list_properties_atoms_length(list_properties);
-    for (int i = 0; i < atom_count; i++) {
-        if (atoms[i] == ATOM(_NET_WM_STATE)) {
-            states = get_atom_list(window->client.id, ATOM(_NET_WM_STATE));
-        } else if (atoms[i] == ATOM(_NET_WM_WINDOW_TYPE)) {
-            types = get_atom_list(window->client.id, ATOM(_NET_WM_WINDOW_TYPE));
-        } else {
-            cache_window_property(window, atoms[i]);
-        }
-    }
+    /* the window might only have types unknown to fensterchef */
+    has_types = get_wave_property(wave, WINDOW_PROPERTY_NET_WM_WINDOW_TYPE,
+            32, UINT32_MAX) != NULL;
 
     /* these are two direct checks */
-    if (is_atom_included(states, ATOM(_NET_WM_STATE_FULLSCREEN))) {
-        predicted_mode = WINDOW_MODE_FULLSCREEN;
-    } else if (is_atom_included(types, ATOM(_NET_WM_WINDOW_TYPE_DOCK))) {
-        predicted_mode = WINDOW_MODE_DOCK;
+    if (has_state(window, _NET_WM_STATE_FULLSCREEN)) {
+        mode = WINDOW_MODE_FULLSCREEN;
+    } else if (is_in_atom_set(&window->types, _NET_WM_WINDOW_TYPE_DOCK)) {
+        mode = WINDOW_MODE_DOCK;
     /* if this window has strut, it must be a dock window */
     } else if (!is_strut_empty(&window->strut)) {
-        predicted_mode = WINDOW_MODE_DOCK;
+        mode = WINDOW_MODE_DOCK;
     /* transient windows are floating windows */
     } else if (window->transient_for != 0) {
-        predicted_mode = WINDOW_MODE_FLOATING;
+        mode = WINDOW_MODE_FLOATING;
     /* floating windows have an equal minimum and maximum size */
     } else if ((window->size_hints.flags &
                 (XCB_ICCCM_SIZE_HINT_P_MIN_SIZE |
@@ -735,29 +1629,36 @@ window_mode_t initialize_window_properties(Window *window)
                 window->size_hints.max_width ||
             window->size_hints.min_height ==
                 window->size_hints.max_height)) {
-        predicted_mode = WINDOW_MODE_FLOATING;
+        mode = WINDOW_MODE_FLOATING;
     /* floating windows have a window type that is not the normal window type */
-    } else if (types != NULL &&
-            !is_atom_included(types, ATOM(_NET_WM_WINDOW_TYPE_NORMAL))) {
-        predicted_mode = WINDOW_MODE_FLOATING;
+    } else if (has_types &&
+            !is_in_atom_set(&window->types, _NET_WM_WINDOW_TYPE_NORMAL)) {
+        mode = WINDOW_MODE_FLOATING;
     }
 
-    window->states = states;
+    return mode;
+}
+
+/* Initialize all properties within @window using the replies within @wave. */
+window_mode_t initialize_window_properties(Window *window, PropertyWave *wave)
+{
+    window_mode_t mode;
 
-    free(types);
-    free(list_properties);
+    apply_window_properties(window, wave);
+    mode = guess_window_mode(window, wave);
 
-    return predicted_mode;
+    clear_property_wave(wave);
+    return mode;
 }
 
-/* Check if @properties includes @protocol. */
-bool supports_protocol(Window *window, xcb_atom_t protocol)
+/* Check if @window supports the protocol with the atom constant @protocol. */
+bool supports_protocol(const Window *window, uint32_t protocol)
 {
-    return is_atom_included(window->protocols, protocol);
+    return is_in_atom_set(&window->protocols, protocol);
 }
 
-/* Check if @properties includes @state. */
-bool has_state(Window *window, xcb_atom_t state)
+/* Check if @window has the state with the atom constant @state. */
+bool has_state(const Window *window, uint32_t state)
 {
-    return is_atom_included(window->states, state);
+    return is_in_atom_set(&window->states, state);
 }
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "log.h"
 #include "utility.h"
 #include "xalloc.h"
 
@@ -141,3 +142,63 @@ char *xasprintf(const char *format, ...)
     va_end(list);
     return result;
 }
+
+/* Add a slab to @pool and put all its objects into the free list. */
+static void grow_object_pool(struct object_pool *pool)
+{
+    char *slab;
+    void **object;
+
+    slab = xreallocarray(NULL, pool->objects_per_slab, pool->object_size);
+    RESIZE(pool->slabs, pool->number_of_slabs + 1);
+    pool->slabs[pool->number_of_slabs] = slab;
+    pool->number_of_slabs++;
+
+    /* link the objects in reverse so the lowest address is handed out first */
+    for (size_t i = pool->objects_per_slab; i > 0; i--) {
+        object = (void**) &slab[(i - 1) * pool->object_size];
+        *object = pool->first_free_object;
+        pool->first_free_object = object;
+    }
+
+    log_object_pool(pool);
+}
+
+/* Get a zeroed object from @pool. */
+void *allocate_pool_object(struct object_pool *pool)
+{
+    void *object;
+
+    if (pool->first_free_object == NULL) {
+        grow_object_pool(pool);
+    }
+
+    object = pool->first_free_object;
+    pool->first_free_object = *(void**) object;
+    pool->number_of_used_objects++;
+
+    memset(object, 0, pool->object_size);
+    return object;
+}
+
+/* Put @object back into @pool. */
+void free_pool_object(struct object_pool *pool, void *object)
+{
+    if (object == NULL) {
+        return;
+    }
+
+    *(void**) object = pool->first_free_object;
+    pool->first_free_object = object;
+    pool->number_of_used_objects--;
+}
+
+/* Log the occupancy of @pool. */
+void log_object_pool(const struct object_pool *pool)
+{
+    const size_t capacity = pool->number_of_slabs * pool->objects_per_slab;
+
+    LOG("pool %s: %zu/%zu objects used in %zu slabs (%zu bytes)\n",
+            pool->name, pool->number_of_used_objects, capacity,
+            pool->number_of_slabs, capacity * pool->object_size);
+}